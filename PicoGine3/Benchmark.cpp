@@ -0,0 +1,180 @@
+#include "pch.h"
+#include "Benchmark.h"
+
+#include <fstream>
+
+#pragma warning(push)
+#pragma warning(disable:26495)
+#pragma warning(disable:26819)
+#include <nlohmann/json.hpp>
+#pragma warning(pop)
+
+#include "Settings.h"
+
+using namespace std::chrono;
+
+namespace
+{
+	nlohmann::json ComputeStatistics(std::vector<double> samples)
+	{
+		if (samples.empty())
+			return nlohmann::json::object();
+
+		std::ranges::sort(samples);
+
+		// Nearest-rank percentile
+		auto percentile = [&samples](double p) -> double
+		{
+			const size_t rank{ static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size()))) };
+			return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+		};
+
+		double sum{};
+		for (const double sample : samples)
+			sum += sample;
+
+		return {
+			{ "min", samples.front() },
+			{ "avg", sum / static_cast<double>(samples.size()) },
+			{ "p50", percentile(50.0) },
+			{ "p95", percentile(95.0) },
+			{ "p99", percentile(99.0) },
+			{ "max", samples.back() },
+		};
+	}
+}
+
+void Benchmark::Initialize()
+{
+	const auto& settings{ Settings::Get() };
+
+	m_IsEnabled = settings.IsBenchmarkEnabled();
+	m_WarmupFrames = settings.GetBenchmarkWarmupFrames();
+
+	if (m_IsEnabled)
+	{
+		const size_t numFrames{ settings.GetFrameCount() };
+		m_FrameSamples.reserve(numFrames);
+		for (auto& phaseSamples : m_PhaseSamples)
+			phaseSamples.reserve(numFrames);
+	}
+
+	m_IsInitialized = true;
+}
+
+bool Benchmark::IsInitialized() const
+{
+	return m_IsInitialized;
+}
+
+bool Benchmark::IsEnabled() const
+{
+	return m_IsEnabled;
+}
+
+void Benchmark::BeginFrame()
+{
+	if (!m_IsEnabled)
+		return;
+
+	m_FrameBeginTime = Clock::now();
+	m_LastPhaseEndTime = m_FrameBeginTime;
+	m_CurrentFramePhases.fill(0.0);
+}
+
+void Benchmark::EndPhase(FramePhase phase)
+{
+	if (!m_IsEnabled)
+		return;
+
+	const Clock::time_point now{ Clock::now() };
+	m_CurrentFramePhases[static_cast<size_t>(phase)] = duration<double, std::milli>(now - m_LastPhaseEndTime).count();
+	m_LastPhaseEndTime = now;
+}
+
+void Benchmark::SkipPhase(FramePhase phase)
+{
+	if (!m_IsEnabled)
+		return;
+
+	m_CurrentFramePhases[static_cast<size_t>(phase)] = 0.0;
+	m_LastPhaseEndTime = Clock::now();
+}
+
+void Benchmark::EndFrame()
+{
+	if (!m_IsEnabled)
+		return;
+
+	const Clock::time_point now{ Clock::now() };
+
+	// First frames pay for pipeline creation, uploads and cache warmup, keep them out of the statistics
+	if (m_FrameIndex++ < m_WarmupFrames)
+		return;
+
+	m_FrameSamples.emplace_back(duration<double, std::milli>(now - m_FrameBeginTime).count());
+
+	for (size_t i{}; i < sk_NumPhases; ++i)
+		m_PhaseSamples[i].emplace_back(m_CurrentFramePhases[i]);
+}
+
+void Benchmark::RecordGpuRegion(const std::string& name, double durationMs)
+{
+	if (!m_IsEnabled || m_FrameIndex <= m_WarmupFrames)
+		return;
+
+	m_GpuRegionSamples[name].emplace_back(durationMs);
+}
+
+void Benchmark::SetCounter(const std::string& name, uint64_t value)
+{
+	if (!m_IsEnabled)
+		return;
+
+	m_Counters[name] = value;
+}
+
+void Benchmark::WriteReport() const
+{
+	if (!m_IsEnabled)
+		return;
+
+	const auto& settings{ Settings::Get() };
+
+	nlohmann::json report
+	{
+		{ "frames", m_FrameSamples.size() },
+		{ "warmupFrames", m_WarmupFrames },
+		{ "headless", settings.IsHeadless() },
+		{ "vsync", settings.IsVSyncEnabled() },
+		{ "frameCap", settings.IsFrameCapEnabled() },
+		{ "threadedRender", settings.IsThreadedRenderEnabled() },
+		{ "frameTimeMs", ComputeStatistics(m_FrameSamples) },
+	};
+
+	nlohmann::json phases{ nlohmann::json::object() };
+	for (size_t i{}; i < sk_NumPhases; ++i)
+		phases[sk_PhaseNames[i]] = ComputeStatistics(m_PhaseSamples[i]);
+
+	report["phasesMs"] = std::move(phases);
+
+	// "Frame" is the whole command buffer, compare it with frameTimeMs to tell CPU- from GPU-bound runs
+	nlohmann::json gpuRegions{ nlohmann::json::object() };
+	for (const auto& [name, samples] : m_GpuRegionSamples)
+		gpuRegions[name] = ComputeStatistics(samples);
+
+	report["gpuRegionsMs"] = std::move(gpuRegions);
+	report["counters"] = m_Counters;
+
+	const std::wstring& reportPath{ settings.GetBenchmarkReportPath() };
+	std::ofstream file{ reportPath };
+	if (!file.is_open())
+	{
+		Logger::Get().LogWarning(std::format(L"Could not open benchmark report file {}", reportPath));
+		return;
+	}
+
+	file << report.dump(4);
+
+	Logger::Get().LogInfo(std::format(L"Benchmark report written to {} ({} frames)", reportPath, m_FrameSamples.size()));
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <atomic>
+#include <chrono>
+
+#include "Singleton.h"
+
+enum class FramePhase : uint8_t
+{
+	MessagePump,
+	Input,
+	FixedUpdate,
+	Update,
+	LateUpdate,
+	Render,
+	DrawFrame,
+
+	Count
+};
+
+class Benchmark final : public Singleton<Benchmark>
+{
+	friend class Singleton<Benchmark>;
+	explicit Benchmark() = default;
+
+public:
+	~Benchmark() override = default;
+
+	Benchmark(const Benchmark&) noexcept = delete;
+	Benchmark& operator=(const Benchmark&) noexcept = delete;
+	Benchmark(Benchmark&&) noexcept = delete;
+	Benchmark& operator=(Benchmark&&) noexcept = delete;
+
+	void Initialize();
+	[[nodiscard]] bool IsInitialized() const;
+	[[nodiscard]] bool IsEnabled() const;
+
+	// Phases are timed back to back: EndPhase() closes the given phase and opens the next one
+	void BeginFrame();
+	void EndPhase(FramePhase phase);
+	void SkipPhase(FramePhase phase);
+	void EndFrame();
+
+	// GPU timings come back a few frames late, once their submit has retired
+	void RecordGpuRegion(const std::string& name, double durationMs);
+
+	// Last value wins, for totals that only make sense at the end of a run (memory usage, allocation counts)
+	void SetCounter(const std::string& name, uint64_t value);
+
+	void WriteReport() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t sk_NumPhases{ static_cast<size_t>(FramePhase::Count) };
+	static constexpr const char* sk_PhaseNames[sk_NumPhases]
+	{
+		"MessagePump",
+		"Input",
+		"FixedUpdate",
+		"Update",
+		"LateUpdate",
+		"Render",
+		"DrawFrame",
+	};
+
+	bool m_IsInitialized{};
+	bool m_IsEnabled{};
+
+	std::atomic<uint32_t> m_FrameIndex{}; // Also read by the render thread recording GPU regions
+	uint32_t m_WarmupFrames{};
+
+	Clock::time_point m_FrameBeginTime{};
+	Clock::time_point m_LastPhaseEndTime{};
+
+	std::array<double, sk_NumPhases> m_CurrentFramePhases{};
+	std::array<std::vector<double>, sk_NumPhases> m_PhaseSamples{};
+	std::vector<double> m_FrameSamples{};
+	std::map<std::string, std::vector<double>> m_GpuRegionSamples{};
+	std::map<std::string, uint64_t> m_Counters{};
+};
+
+#endif //BENCHMARK_H
\ No newline at end of file
@@ -175,8 +175,8 @@ namespace Components
 		uint32_t m_MaterialID{};
 
 	public:
-		Mesh(const std::wstring& filename, uint32_t materialID = 0) :
-			m_MeshDataID{ ResourceManager::Get().LoadMesh(filename) },
+		Mesh(const std::wstring& filename, uint32_t materialID = 0, VertexFormat vertexFormat = VertexFormat::Full) :
+			m_MeshDataID{ ResourceManager::Get().LoadMeshAsync(filename, vertexFormat) },
 			m_MaterialID{ materialID }
 		{}
 
@@ -1,7 +1,11 @@
 #include "pch.h"
 #include "CoreSystems.h"
 
+#include "Benchmark.h"
 #include "InputManager.h"
+#include "JobSystem.h"
+#include "MicroBenchmarks.h"
+#include "Profiler.h"
 #include "Renderer.h"
 #include "ResourceManager.h"
 #include "SceneManager.h"
@@ -10,13 +14,20 @@
 #include "WindowManager.h"
 
 
-void CoreSystems::Initialize()
+void CoreSystems::Initialize(const wchar_t* commandLine)
 {
 	m_AppHinstance = GetModuleHandle(nullptr);
 
-	Settings::Get().Initialize();
-	WindowManager::Get().Initialize();
+	auto& settings{ Settings::Get() };
+	settings.Initialize(commandLine);
+
+	if (!settings.IsHeadless())
+		WindowManager::Get().Initialize();
+
+	Benchmark::Get().Initialize();
+	Profiler::Get().Initialize();
 	TimeManager::Get().Initialize();
+	JobSystem::Get().Initialize();
 	ResourceManager::Get().Initialize();
 	InputManager::Get().Initialize();
 	Renderer::Get().Initialize();
@@ -26,8 +37,11 @@ void CoreSystems::Initialize()
 bool CoreSystems::IsInitialized()
 {
 	return Settings::Get().IsInitialized()
-		&& WindowManager::Get().IsInitialized()
+		&& (Settings::Get().IsHeadless() || WindowManager::Get().IsInitialized())
+		&& Benchmark::Get().IsInitialized()
+		&& Profiler::Get().IsInitialized()
 		&& TimeManager::Get().IsInitialized()
+		&& JobSystem::Get().IsInitialized()
 		&& ResourceManager::Get().IsInitialized()
 		&& InputManager::Get().IsInitialized()
 		&& Renderer::Get().IsInitialized()
@@ -46,29 +60,54 @@ HRESULT CoreSystems::CoreLoop() const
 	auto& input{ InputManager::Get() };
 	auto& renderer{ Renderer::Get() };
 	auto& sceneManager{ SceneManager::Get() };
+	auto& benchmark{ Benchmark::Get() };
+	auto& profiler{ Profiler::Get() };
 
 	time.SetTargetFPS(settings.GetMaxFPS());
 	const float fixedUpdateStep{ time.GetFixedTimeStep() };
 	float fixedUpdateLag{};
 
+	const bool isHeadless{ settings.IsHeadless() };
+	const uint32_t frameCount{ settings.GetFrameCount() };
+	uint32_t frameIndex{};
+
+	PROFILE_THREAD_NAME("Main");
+
+	if (settings.IsMicroBenchmarkEnabled())
+	{
+		MicroBenchmarks::Run(settings.GetMicroBenchmarkReportPath());
+		profiler.WriteTrace();
+		return S_OK;
+	}
+
 	MSG msg;
 	ZeroMemory(&msg, sizeof(MSG));
 	do
 	{
+		PROFILE_SCOPE("Frame");
+
 		// Start frame timer and update DeltaTime
 		time.Update();
+		benchmark.BeginFrame();
 
-		// Windows message pump
-		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		// Windows message pump (no window in headless mode)
+		while (!isHeadless && PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 			if (msg.message == WM_QUIT)
+			{
+				renderer.WaitForRenderThread();
+				benchmark.WriteReport();
+				profiler.WriteTrace();
 				return static_cast<HRESULT>(msg.wParam);
+			}
 		}
+		benchmark.EndPhase(FramePhase::MessagePump);
 
         // Update inputs and exec commands
 		input.UpdateAndExec();
+		benchmark.EndPhase(FramePhase::Input);
 
 		// Scene FixedUpdate
 		fixedUpdateLag += time.GetElapsedTime();
@@ -77,29 +116,50 @@ HRESULT CoreSystems::CoreLoop() const
 			sceneManager.FixedUpdate();
 			fixedUpdateLag -= fixedUpdateStep;
 		}
+		benchmark.EndPhase(FramePhase::FixedUpdate);
 
         // Scene Update
 		sceneManager.Update();
+		benchmark.EndPhase(FramePhase::Update);
 
 		// Scene LateUpdate
 		sceneManager.LateUpdate();
+		benchmark.EndPhase(FramePhase::LateUpdate);
 
         // Render scene (only if not minimized)
 		if (!m_AppMinimized)
 		{
 			sceneManager.Render();
+			benchmark.EndPhase(FramePhase::Render);
+
 			renderer.DrawFrame();
+			benchmark.EndPhase(FramePhase::DrawFrame);
+		}
+		else
+		{
+			benchmark.SkipPhase(FramePhase::Render);
+			benchmark.SkipPhase(FramePhase::DrawFrame);
 		}
 
 		// Clear current frame keys up/down buffer in InputManager
 		input.EndFrame();
+		benchmark.EndFrame();
 
 		// End frame timer and sleep for frame cap
 		if (settings.IsFrameCapEnabled())
 			std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::milliseconds>(time.GetTimeToNextFrame()));
 
+		// Fixed length runs (headless / benchmarking)
+		if (frameCount != 0 && ++frameIndex >= frameCount)
+			break;
+
 	} while (msg.message != WM_QUIT);
 
+	// The last frame handed over may still be recording its counters
+	renderer.WaitForRenderThread();
+	benchmark.WriteReport();
+	profiler.WriteTrace();
+
     return S_OK;
 }
 
@@ -14,7 +14,7 @@ public:
 	CoreSystems(CoreSystems&&) noexcept = delete;
 	CoreSystems& operator=(CoreSystems&&) noexcept = delete;
 
-	void Initialize();
+	void Initialize(const wchar_t* commandLine = nullptr);
 	[[nodiscard]] static bool IsInitialized();
 
 	[[nodiscard]] HINSTANCE GetAppHinstance() const;
@@ -2,6 +2,7 @@
 #include "GfxCommandBuffer.h"
 
 #include "GfxStructs.h"
+#include "GfxGpuTimer.h"
 #include "GfxImmediateCommands.h"
 #include "GraphicsAPI.h"
 
@@ -11,6 +12,15 @@ GfxCommandBuffer::GfxCommandBuffer(GraphicsAPI* pGraphicsAPI) :
 {
 }
 
+GfxCommandBuffer::GfxCommandBuffer(GraphicsAPI* pGraphicsAPI, GfxImmediateCommands* pImmediateCommands) :
+	m_pGraphicsAPI{ pGraphicsAPI },
+	m_pWrapper{ &pImmediateCommands->Acquire() }
+{
+	// Graphics stages are not supported by compute only queues, they cannot appear in this buffer's barriers
+	if (pImmediateCommands != m_pGraphicsAPI->GetGfxImmediateCommands())
+		m_ShaderStages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+}
+
 GfxCommandBuffer::~GfxCommandBuffer()
 {
 	assert(!m_IsRendering && L"Forgot EndRendering before deleting this buffer !");
@@ -45,7 +55,13 @@ void GfxCommandBuffer::PushDebugGroupLabel(const char* label, uint32_t colorRGBA
 {
 	assert(label && "Cannot set unnamed debug event label");
 
-	if (!label || !vkCmdBeginDebugUtilsLabelEXT)
+	if (!label)
+		return;
+
+	// Debug groups double as GPU timing regions, even when debug utils are not available
+	m_pGraphicsAPI->GetGfxGpuTimer()->BeginRegion(*this, label);
+
+	if (!vkCmdBeginDebugUtilsLabelEXT)
 		return;
 
 	const VkDebugUtilsLabelEXT utilsLabel
@@ -85,6 +101,8 @@ void GfxCommandBuffer::InsertDebugEventLabel(const char* label, uint32_t colorRG
 
 void GfxCommandBuffer::PopDebugGroupLabel() const
 {
+	m_pGraphicsAPI->GetGfxGpuTimer()->EndRegion(*this);
+
 	if (!vkCmdEndDebugUtilsLabelEXT)
 		return;
 	
@@ -289,6 +307,8 @@ void GfxCommandBuffer::BeginRendering(const RenderPass& renderPass, const Frameb
 		vkCmdSetDepthCompareOp(m_pWrapper->m_CmdBuffer, VK_COMPARE_OP_ALWAYS);
 		vkCmdSetDepthBiasEnable(m_pWrapper->m_CmdBuffer, VK_FALSE);
 
+		m_pGraphicsAPI->GetGfxGpuTimer()->BeginRegion(*this, frameBuffer.m_DebugName ? frameBuffer.m_DebugName : "Rendering");
+
 		vkCmdBeginRendering(m_pWrapper->m_CmdBuffer, &renderingInfo);
 	}
 }
@@ -299,6 +319,8 @@ void GfxCommandBuffer::EndRendering()
 
 	vkCmdEndRendering(m_pWrapper->m_CmdBuffer);
 
+	m_pGraphicsAPI->GetGfxGpuTimer()->EndRegion(*this);
+
 	m_FrameBuffer = {};
 }
 
@@ -326,6 +348,54 @@ void GfxCommandBuffer::BindScissorRect(const ScissorRect& scissor) const
 	vkCmdSetScissor(m_pWrapper->m_CmdBuffer, 0, 1, &scissorRect);
 }
 
+void GfxCommandBuffer::BindComputePipeline(ComputePipelineHandle pipeline)
+{
+	assert(!m_IsRendering && L"Compute pipelines cannot be bound inside a render pass.");
+
+	const GfxComputePipeline* pPipeline{ m_pGraphicsAPI->GetComputePipeline(pipeline) };
+	if (!pPipeline)
+	{
+		Logger::Get().LogError(L"Cannot bind an empty compute pipeline handle.");
+		return;
+	}
+
+	// Always bound, passes recording raw Vulkan commands in between may have bound another one
+	vkCmdBindPipeline(m_pWrapper->m_CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPipeline->m_VkPipeline);
+	m_BoundComputePipeline = pipeline;
+}
+
+void GfxCommandBuffer::BindComputeDescriptorSets(const VkDescriptorSet* pDescriptorSets, uint32_t numDescriptorSets, uint32_t firstSet) const
+{
+	const GfxComputePipeline* pPipeline{ GetBoundComputePipeline() };
+	assert(pPipeline && L"No compute pipeline bound.");
+
+	vkCmdBindDescriptorSets(m_pWrapper->m_CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPipeline->m_VkPipelineLayout, firstSet, numDescriptorSets, pDescriptorSets, 0, nullptr);
+}
+
+void GfxCommandBuffer::DispatchThreadGroups(const Dimensions& threadGroupCount, const Dependencies& dependencies)
+{
+	assert(!m_BoundComputePipeline.Empty() && L"No compute pipeline bound.");
+
+	for (GfxImage* texture : dependencies.m_Textures)
+	{
+		if (!texture)
+			break;
+
+		UseComputeTexture(texture, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+	}
+
+	for (GfxBuffer* buffer : dependencies.m_Buffers)
+	{
+		if (!buffer)
+			break;
+
+		// Covers writes from earlier dispatches as well as from the graphics stages when the queue has them
+		BufferBarrier(buffer, m_ShaderStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+	}
+
+	vkCmdDispatch(m_pWrapper->m_CmdBuffer, threadGroupCount.m_Width, threadGroupCount.m_Height, threadGroupCount.m_Depth);
+}
+
 void GfxCommandBuffer::BindRenderPipeline(const GfxRenderPipeline& pipeline)
 {
 }
@@ -344,10 +414,31 @@ void GfxCommandBuffer::BindIndexBuffer(GfxBuffer* buffer, IndexFormat indexForma
 
 void GfxCommandBuffer::BindPushConstants(const void* data, size_t size, size_t offset)
 {
+	// Render pipelines are not wrapped yet, only the bound compute pipeline takes push constants
+	const GfxComputePipeline* pPipeline{ GetBoundComputePipeline() };
+	if (!pPipeline)
+	{
+		Logger::Get().LogError(L"No pipeline bound to push constants to.");
+		return;
+	}
+
+	assert(offset + size <= pPipeline->m_PushConstantsSize && L"Push constants out of the pipeline's range.");
+
+	vkCmdPushConstants(m_pWrapper->m_CmdBuffer, pPipeline->m_VkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, static_cast<uint32_t>(offset), static_cast<uint32_t>(size), data);
 }
 
 void GfxCommandBuffer::FillBuffer(GfxBuffer* buffer, size_t bufferOffset, size_t size, uint32_t data)
 {
+	assert(!m_IsRendering && L"Buffers cannot be filled inside a render pass.");
+
+	vkCmdFillBuffer(m_pWrapper->m_CmdBuffer, buffer->m_VkBuffer, bufferOffset, size, data);
+
+	// Stages the graphics and async compute families both support
+	VkPipelineStageFlags2 dstStage{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT };
+	if (buffer->m_VkUsageFlags & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+		dstStage |= VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+
+	BufferBarrier(buffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, dstStage);
 }
 
 void GfxCommandBuffer::UpdateBuffer(GfxBuffer* buffer, size_t bufferOffset, size_t size, const void* data)
@@ -376,6 +467,33 @@ void GfxCommandBuffer::DrawIndexedIndirect(GfxBuffer* indirectBuffer, size_t ind
 void GfxCommandBuffer::DrawIndexedIndirectCount(GfxBuffer* indirectBuffer, size_t indirectBufferOffset,
 	GfxBuffer* countBuffer, size_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
 {
+	assert(indirectBuffer && countBuffer && L"Invalid indirect draw buffers.");
+
+	vkCmdDrawIndexedIndirectCount(m_pWrapper->m_CmdBuffer,
+		indirectBuffer->m_VkBuffer,
+		indirectBufferOffset,
+		countBuffer->m_VkBuffer,
+		countBufferOffset,
+		maxDrawCount,
+		stride ? stride : sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GfxCommandBuffer::ResetQueryPool(QueryPoolHandle pool, uint32_t firstQuery, uint32_t queryCount) const
+{
+	const GfxQueryPool* queryPool{ m_pGraphicsAPI->GetQueryPool(pool) };
+	assert(queryPool && L"Invalid query pool handle.");
+	assert(firstQuery + queryCount <= queryPool->m_NumQueries && L"Query range out of bounds.");
+
+	vkCmdResetQueryPool(m_pWrapper->m_CmdBuffer, queryPool->m_VkQueryPool, firstQuery, queryCount);
+}
+
+void GfxCommandBuffer::WriteTimestamp(QueryPoolHandle pool, uint32_t query, VkPipelineStageFlags2 stage) const
+{
+	const GfxQueryPool* queryPool{ m_pGraphicsAPI->GetQueryPool(pool) };
+	assert(queryPool && L"Invalid query pool handle.");
+	assert(query < queryPool->m_NumQueries && L"Query index out of bounds.");
+
+	vkCmdWriteTimestamp2(m_pWrapper->m_CmdBuffer, stage, queryPool->m_VkQueryPool, query);
 }
 
 void GfxCommandBuffer::ClearColorImage(GfxImage* tex, const ClearColorValue& value, const TextureLayers& layers)
@@ -391,6 +509,11 @@ void GfxCommandBuffer::GenerateMipmap(GfxImage* texture)
 {
 }
 
+const GfxComputePipeline* GfxCommandBuffer::GetBoundComputePipeline() const
+{
+	return m_pGraphicsAPI->GetComputePipeline(m_BoundComputePipeline);
+}
+
 void GfxCommandBuffer::UseComputeTexture(GfxImage* texture, VkPipelineStageFlags2 dstStage) const
 {
 	if (!texture->IsStorageImage())
@@ -415,7 +538,7 @@ void GfxCommandBuffer::BufferBarrier(GfxBuffer* buffer, VkPipelineStageFlags2 sr
 	  .dstAccessMask = 0,
 	  .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
 	  .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-	  .buffer = buffer->GetBuffer(),
+	  .buffer = buffer->m_VkBuffer,
 	  .offset = 0,
 	  .size = VK_WHOLE_SIZE,
 	};
@@ -433,7 +556,7 @@ void GfxCommandBuffer::BufferBarrier(GfxBuffer* buffer, VkPipelineStageFlags2 sr
 	if (dstStage & VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT)
 		barrier.dstAccessMask |= VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
 	
-	if (buffer->GetBufferUsageFlags() & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+	if (buffer->m_VkUsageFlags & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
 		barrier.dstAccessMask |= VK_ACCESS_2_INDEX_READ_BIT;
 
 	const VkDependencyInfo depInfo
@@ -5,6 +5,7 @@
 
 #include "GfxStructs.h"
 class GraphicsAPI;
+class GfxImmediateCommands;
 struct CommandBufferWrapper;
 
 class GfxCommandBuffer final
@@ -12,6 +13,8 @@ class GfxCommandBuffer final
 public:
 	explicit GfxCommandBuffer() = default;
 	explicit GfxCommandBuffer(GraphicsAPI* pGraphicsAPI);
+	// Acquired from another queue than the graphics one, submitted through the same pImmediateCommands
+	explicit GfxCommandBuffer(GraphicsAPI* pGraphicsAPI, GfxImmediateCommands* pImmediateCommands);
 	~GfxCommandBuffer();
 
 	GfxCommandBuffer(const GfxCommandBuffer&) noexcept = delete;
@@ -31,8 +34,10 @@ public:
 
 	//void BindRayTracingPipeline(const GfxRayTracingPipeline& pipeline);
 
-	//void BindComputePipeline(const GfxComputePipeline& pipeline);
-	//void DispatchThreadGroups(const ThreadGroupDimensions& dimensions, const Dependencies& dependencies = {});
+	void BindComputePipeline(ComputePipelineHandle pipeline);
+	void BindComputeDescriptorSets(const VkDescriptorSet* pDescriptorSets, uint32_t numDescriptorSets, uint32_t firstSet = 0) const;
+	// The dependencies are made visible to the compute shader stage before the dispatch
+	void DispatchThreadGroups(const Dimensions& threadGroupCount, const Dependencies& dependencies = {});
 
 	void BeginRendering(const RenderPass& renderPass, const Framebuffer& frameBuffer, const Dependencies& dependencies = {});
 	void EndRendering();
@@ -49,7 +54,7 @@ public:
 	template<typename Struct>
 	void PushConstants(const Struct& data, size_t offset = 0)
 	{
-		this->PushConstants(&data, sizeof(Struct), offset);
+		this->BindPushConstants(&data, sizeof(Struct), offset);
 	}
 
 	void FillBuffer(GfxBuffer* buffer, size_t bufferOffset, size_t size, uint32_t data);
@@ -76,8 +81,8 @@ public:
 	//void SetDepthBias(float constantFactor, float slopeFactor, float clamp = 0.0f);
 	//void SetDepthBiasEnable(bool enable);
 
-	//void ResetQueryPool(QueryPoolHandle pool, uint32_t firstQuery, uint32_t queryCount);
-	//void WriteTimestamp(QueryPoolHandle pool, uint32_t query);
+	void ResetQueryPool(QueryPoolHandle pool, uint32_t firstQuery, uint32_t queryCount) const;
+	void WriteTimestamp(QueryPoolHandle pool, uint32_t query, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) const;
 
 	void ClearColorImage(GfxImage* tex, const ClearColorValue& value, const TextureLayers& layers = {});
 	void CopyImage(GfxImage* src, GfxImage* dst, const Dimensions& extent, const Offset3D& srcOffset = {}, const Offset3D& dstOffset = {}, const TextureLayers& srcLayers = {}, const TextureLayers& dstLayers = {});
@@ -90,7 +95,12 @@ private:
 
 	bool m_IsRendering{};
 	Framebuffer m_FrameBuffer{};
+	// Resolved on use, the pool may reallocate its storage while the buffer is recorded
+	ComputePipelineHandle m_BoundComputePipeline{};
+	// Shader stages the queue supports, source of the barriers guarding shader reads and writes
+	VkPipelineStageFlags2 m_ShaderStages{ VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT };
 
+	[[nodiscard]] const GfxComputePipeline* GetBoundComputePipeline() const;
 	void UseComputeTexture(GfxImage* texture, VkPipelineStageFlags2 dstStage) const;
 	void BufferBarrier(GfxBuffer* buffer, VkPipelineStageFlags2 srcStage, VkPipelineStageFlags2 dstStage);
 	void TransitionToColorAttachment(GfxImage* texture) const;
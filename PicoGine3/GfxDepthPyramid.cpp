@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "GfxDepthPyramid.h"
+
+#include <bit>
+
+#include "GraphicsAPI.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxDepthPyramid::GfxDepthPyramid(GraphicsAPI* pGraphicsAPI, VkExtent2D depthExtent) :
+	m_pGraphicsAPI{ pGraphicsAPI }
+{
+	CreatePipeline();
+	CreateResources(depthExtent);
+}
+
+GfxDepthPyramid::~GfxDepthPyramid()
+{
+	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
+
+	ReleaseResources();
+
+	vkDestroyPipeline(device, m_VkReducePipeline, nullptr);
+	vkDestroyPipelineLayout(device, m_VkReducePipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_VkReduceDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_VkDescriptorSetLayout, nullptr);
+}
+
+void GfxDepthPyramid::Resize(VkExtent2D depthExtent)
+{
+	if (depthExtent.width == m_DepthExtent.width && depthExtent.height == m_DepthExtent.height)
+		return;
+
+	ReleaseResources();
+	CreateResources(depthExtent);
+}
+
+void GfxDepthPyramid::Build(const GfxCommandBuffer& cmdBuffer, VkImageView depthImageView)
+{
+	PROFILE_FUNCTION();
+
+	// The previous build using this slot belongs to a frame that has retired
+	const VkDescriptorSet depthDescriptorSet{ m_VkDepthReduceDescriptorSets[m_BuildCount++ % GfxSwapchain::sk_MaxFramesInFlight] };
+
+	const VkDescriptorImageInfo depthImageInfo{ VK_NULL_HANDLE, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = depthDescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &depthImageInfo;
+
+	vkUpdateDescriptorSets(m_pGraphicsAPI->GetGfxDevice()->GetDevice(), 1, &descriptorWrite, 0, nullptr);
+
+	const VkCommandBuffer vkCmdBuffer{ cmdBuffer.GetCmdBuffer() };
+	vkCmdBindPipeline(vkCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkReducePipeline);
+
+	VkExtent2D sourceExtent{ m_DepthExtent };
+	for (uint32_t level{}; level < m_LevelCount; ++level)
+	{
+		const VkExtent2D levelExtent{ std::max(m_Extent.width >> level, 1u), std::max(m_Extent.height >> level, 1u) };
+		const VkDescriptorSet descriptorSet{ level == 0 ? depthDescriptorSet : m_VkLevelReduceDescriptorSets[level - 1] };
+		const ReducePushConstants pushConstants{ sourceExtent.width, sourceExtent.height, levelExtent.width, levelExtent.height };
+
+		vkCmdBindDescriptorSets(vkCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkReducePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		vkCmdPushConstants(vkCmdBuffer, m_VkReducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstants), &pushConstants);
+		vkCmdDispatch(vkCmdBuffer, (levelExtent.width + sk_ReduceGroupSize - 1) / sk_ReduceGroupSize, (levelExtent.height + sk_ReduceGroupSize - 1) / sk_ReduceGroupSize, 1);
+
+		// The next level reads what was just written
+		if (level + 1 < m_LevelCount)
+			LevelBarrier(vkCmdBuffer);
+
+		sourceExtent = levelExtent;
+	}
+
+	m_IsValid = true;
+}
+
+bool GfxDepthPyramid::IsValid() const
+{
+	return m_IsValid;
+}
+
+GfxImage* GfxDepthPyramid::GetImage() const
+{
+	return m_pGraphicsAPI->GetTexture(m_Texture);
+}
+
+VkDescriptorSetLayout GfxDepthPyramid::GetDescriptorSetLayout() const
+{
+	return m_VkDescriptorSetLayout;
+}
+
+VkDescriptorSet GfxDepthPyramid::GetDescriptorSet() const
+{
+	return m_VkDescriptorSet;
+}
+
+void GfxDepthPyramid::CreatePipeline()
+{
+	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
+
+	VkDescriptorSetLayoutBinding pyramidLayoutBinding{};
+	pyramidLayoutBinding.binding = 0;
+	pyramidLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	pyramidLayoutBinding.descriptorCount = 1;
+	pyramidLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pyramidLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &pyramidLayoutBinding;
+
+	HandleVkResult(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_VkDescriptorSetLayout));
+
+	// Reduction: source level at binding 0, destination level at binding 1
+	VkDescriptorSetLayoutBinding destinationLayoutBinding{ pyramidLayoutBinding };
+	destinationLayoutBinding.binding = 1;
+	destinationLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+	const std::array<VkDescriptorSetLayoutBinding, 2> reduceBindings{ pyramidLayoutBinding, destinationLayoutBinding };
+	layoutInfo.bindingCount = static_cast<uint32_t>(reduceBindings.size());
+	layoutInfo.pBindings = reduceBindings.data();
+
+	HandleVkResult(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_VkReduceDescriptorSetLayout));
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ReducePushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_VkReduceDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	HandleVkResult(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_VkReducePipelineLayout));
+
+	const ShaderModule computeShaderModule{ m_pGraphicsAPI->GetShaderModulePool()->GetShaderModule(L"Shaders/DepthReduce_CS.spv") };
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = computeShaderModule.m_ShaderModule;
+	pipelineInfo.stage.pName = "CSMain";
+	pipelineInfo.layout = m_VkReducePipelineLayout;
+
+	HandleVkResult(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkReducePipeline));
+}
+
+void GfxDepthPyramid::CreateResources(VkExtent2D depthExtent)
+{
+	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
+
+	// Power of two below the depth extent, so every level past the first halves exactly
+	m_DepthExtent = depthExtent;
+	m_Extent = VkExtent2D{ std::max(std::bit_floor(depthExtent.width), 1u), std::max(std::bit_floor(depthExtent.height), 1u) };
+	m_LevelCount = static_cast<uint32_t>(std::bit_width(std::max(m_Extent.width, m_Extent.height)));
+	m_IsValid = false;
+
+	const TextureDesc textureDesc{
+		.m_Type = TextureType_2D,
+		.m_Format = R32_SFloat,
+		.m_Dimensions = { m_Extent.width, m_Extent.height, 1 },
+		.m_Usage = TextureUsageBits_Sampled | TextureUsageBits_Storage,
+		.m_NumMipLevels = m_LevelCount,
+		.m_DebugName = "Depth pyramid"
+	};
+	m_Texture = m_pGraphicsAPI->AcquireTexture(textureDesc);
+
+	// Written and sampled within the same frame, the render graph moves it to GENERAL on first use and leaves it there
+	GfxImage* pImage{ m_pGraphicsAPI->GetTexture(m_Texture) };
+
+	const uint32_t reduceSetCount{ GfxSwapchain::sk_MaxFramesInFlight + m_LevelCount - 1 };
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[0].descriptorCount = reduceSetCount + 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = reduceSetCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = reduceSetCount + 1;
+
+	HandleVkResult(vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_VkDescriptorPool));
+
+	std::vector<VkDescriptorSetLayout> layouts(reduceSetCount + 1, m_VkReduceDescriptorSetLayout);
+	layouts[0] = m_VkDescriptorSetLayout;
+
+	std::vector<VkDescriptorSet> descriptorSets(layouts.size());
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_VkDescriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
+
+	HandleVkResult(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()));
+
+	m_VkDescriptorSet = descriptorSets[0];
+	std::copy_n(descriptorSets.begin() + 1, GfxSwapchain::sk_MaxFramesInFlight, m_VkDepthReduceDescriptorSets.begin());
+	m_VkLevelReduceDescriptorSets.assign(descriptorSets.begin() + 1 + GfxSwapchain::sk_MaxFramesInFlight, descriptorSets.end());
+
+	// Single level views, the reduction reads one level and writes the next
+	std::vector<VkDescriptorImageInfo> levelInfos(m_LevelCount);
+	for (uint32_t level{}; level < m_LevelCount; ++level)
+		levelInfos[level] = VkDescriptorImageInfo{ VK_NULL_HANDLE, pImage->GetOrCreateVkImageViewForFramebuffer(static_cast<uint8_t>(level), 0), VK_IMAGE_LAYOUT_GENERAL };
+
+	const VkDescriptorImageInfo pyramidInfo{ VK_NULL_HANDLE, pImage->m_ImageView, VK_IMAGE_LAYOUT_GENERAL };
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites{};
+	descriptorWrites.reserve(1 + GfxSwapchain::sk_MaxFramesInFlight + 2 * m_LevelCount);
+
+	const auto addWrite = [&descriptorWrites](VkDescriptorSet descriptorSet, uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo* pImageInfo)
+	{
+		VkWriteDescriptorSet& descriptorWrite{ descriptorWrites.emplace_back() };
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = descriptorSet;
+		descriptorWrite.dstBinding = binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = type;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = pImageInfo;
+	};
+
+	addWrite(m_VkDescriptorSet, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &pyramidInfo);
+
+	// The depth source of the first level is written by Build()
+	for (const VkDescriptorSet descriptorSet : m_VkDepthReduceDescriptorSets)
+		addWrite(descriptorSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &levelInfos[0]);
+
+	for (uint32_t level{ 1 }; level < m_LevelCount; ++level)
+	{
+		addWrite(m_VkLevelReduceDescriptorSets[level - 1], 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &levelInfos[level - 1]);
+		addWrite(m_VkLevelReduceDescriptorSets[level - 1], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &levelInfos[level]);
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void GfxDepthPyramid::ReleaseResources()
+{
+	if (m_VkDescriptorPool == VK_NULL_HANDLE)
+		return;
+
+	// Frames in flight may still be reading the pyramid
+	m_pGraphicsAPI->Destroy(m_Texture);
+	m_pGraphicsAPI->AddDeferredTask(std::packaged_task<void()>([device = m_pGraphicsAPI->GetGfxDevice()->GetDevice(), pool = m_VkDescriptorPool]()
+	{
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}));
+
+	m_Texture = {};
+	m_VkDescriptorPool = VK_NULL_HANDLE;
+	m_VkDescriptorSet = VK_NULL_HANDLE;
+	m_VkDepthReduceDescriptorSets = {};
+	m_VkLevelReduceDescriptorSets.clear();
+	m_DepthExtent = {};
+	m_IsValid = false;
+}
+
+void GfxDepthPyramid::LevelBarrier(VkCommandBuffer cmdBuffer)
+{
+	const VkMemoryBarrier2 barrier
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+	};
+	const VkDependencyInfo dependency
+	{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &barrier,
+	};
+	vkCmdPipelineBarrier2(cmdBuffer, &dependency);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef GFXDEPTHPYRAMID_H
+#define GFXDEPTHPYRAMID_H
+
+#include "GfxStructs.h"
+#include "GfxSwapchain.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GfxCommandBuffer;
+class GraphicsAPI;
+
+// Hierarchical depth for occlusion culling, every texel holds the farthest depth of the area it covers in the level above
+class GfxDepthPyramid final
+{
+public:
+	explicit GfxDepthPyramid(GraphicsAPI* pGraphicsAPI, VkExtent2D depthExtent);
+	~GfxDepthPyramid();
+
+	GfxDepthPyramid(const GfxDepthPyramid&) noexcept = delete;
+	GfxDepthPyramid& operator=(const GfxDepthPyramid&) noexcept = delete;
+	GfxDepthPyramid(GfxDepthPyramid&&) noexcept = delete;
+	GfxDepthPyramid& operator=(GfxDepthPyramid&&) noexcept = delete;
+
+	// Recreates the pyramid when the depth extent changed, before the frame's render graph imports it
+	void Resize(VkExtent2D depthExtent);
+	// Outside of a render pass, with the depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL and the pyramid in GENERAL.
+	// Only the levels are synchronized with each other, the render graph orders the build with the rest of the frame
+	void Build(const GfxCommandBuffer& cmdBuffer, VkImageView depthImageView);
+
+	// False until the first build after a (re)creation, the contents are undefined until then
+	[[nodiscard]] bool IsValid() const;
+
+	// Kept in GENERAL, the layout the descriptor sets expect
+	[[nodiscard]] GfxImage* GetImage() const;
+
+	// Whole pyramid at binding 0 as a sampled image in VK_IMAGE_LAYOUT_GENERAL, for the culling pipelines
+	[[nodiscard]] VkDescriptorSetLayout GetDescriptorSetLayout() const;
+	[[nodiscard]] VkDescriptorSet GetDescriptorSet() const;
+
+private:
+	struct ReducePushConstants
+	{
+		uint32_t m_SourceWidth;
+		uint32_t m_SourceHeight;
+		uint32_t m_DestinationWidth;
+		uint32_t m_DestinationHeight;
+	};
+
+	static constexpr uint32_t sk_ReduceGroupSize{ 8 };
+
+	GraphicsAPI* m_pGraphicsAPI;
+	VkExtent2D m_DepthExtent{};
+	VkExtent2D m_Extent{};
+	uint32_t m_LevelCount{};
+	Handle<GfxImage> m_Texture{};
+	bool m_IsValid{};
+	uint64_t m_BuildCount{};
+
+	VkDescriptorSetLayout m_VkDescriptorSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSetLayout m_VkReduceDescriptorSetLayout{ VK_NULL_HANDLE };
+	VkPipelineLayout m_VkReducePipelineLayout{ VK_NULL_HANDLE };
+	VkPipeline m_VkReducePipeline{ VK_NULL_HANDLE };
+
+	VkDescriptorPool m_VkDescriptorPool{ VK_NULL_HANDLE };
+	VkDescriptorSet m_VkDescriptorSet{ VK_NULL_HANDLE };
+	// The first level reads the frame's depth, rewritten on every build so one set per frame in flight
+	std::array<VkDescriptorSet, GfxSwapchain::sk_MaxFramesInFlight> m_VkDepthReduceDescriptorSets{};
+	// Set i writes level i + 1 from level i
+	std::vector<VkDescriptorSet> m_VkLevelReduceDescriptorSets{};
+
+	void CreatePipeline();
+	void CreateResources(VkExtent2D depthExtent);
+	void ReleaseResources();
+
+	static void LevelBarrier(VkCommandBuffer cmdBuffer);
+};
+
+#endif
+
+#endif //GFXDEPTHPYRAMID_H
\ No newline at end of file
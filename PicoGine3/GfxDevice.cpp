@@ -5,7 +5,9 @@
 #include <format>
 
 #include "CoreSystems.h"
+#include "GfxMemoryAllocator.h"
 #include "GraphicsAPI.h"
+#include "Settings.h"
 #include "WindowManager.h"
 
 
@@ -13,12 +15,15 @@
 
 #elif defined(_VK)
 
-GfxDevice::GfxDevice()
+GfxDevice::GfxDevice() :
+	m_IsHeadless{ Settings::Get().IsHeadless() }
 {
 	HandleVkResult(volkInitialize());
 
 	CreateVkInstance();
-	CreateSurface();
+
+	if (!m_IsHeadless)
+		CreateSurface();
 
 #if defined(_DEBUG)
 
@@ -28,10 +33,14 @@ GfxDevice::GfxDevice()
 
 	SelectPhysicalDevice();
 	CreateLogicalDevice();
+
+	m_pMemoryAllocator = std::make_unique<GfxMemoryAllocator>(this);
 }
 
 GfxDevice::~GfxDevice()
 {
+	m_pMemoryAllocator.reset();
+
 	vkDestroyDevice(m_VkDevice, nullptr);
 
 #if defined(_DEBUG)
@@ -40,7 +49,9 @@ GfxDevice::~GfxDevice()
 
 #endif //defined(_DEBUG)
 
-	vkDestroySurfaceKHR(m_VkInstance, m_VkSurface, nullptr);
+	if (m_VkSurface != VK_NULL_HANDLE)
+		vkDestroySurfaceKHR(m_VkInstance, m_VkSurface, nullptr);
+
 	vkDestroyInstance(m_VkInstance, nullptr);
 }
 
@@ -79,6 +90,33 @@ DeviceQueueInfo GfxDevice::GetDeviceQueueInfo() const
 	return m_DeviceQueueInfo;
 }
 
+bool GfxDevice::IsHeadless() const
+{
+	return m_IsHeadless;
+}
+
+bool GfxDevice::IsDrawIndirectCountSupported() const
+{
+	// Requested at device creation whenever it is available
+	return m_VkFeatures12.drawIndirectCount == VK_TRUE;
+}
+
+uint32_t GfxDevice::GetTimestampValidBits(uint32_t queueFamilyIndex) const
+{
+	uint32_t queueFamilyCount{};
+	vkGetPhysicalDeviceQueueFamilyProperties(m_VkPhysicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_VkPhysicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	return queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+}
+
+GfxMemoryAllocator* GfxDevice::GetMemoryAllocator() const
+{
+	return m_pMemoryAllocator.get();
+}
+
 SwapChainSupportDetails GfxDevice::SwapChainSupport() const
 {
 	return QuerySwapChainSupport(m_VkPhysicalDevice);
@@ -188,7 +226,7 @@ VkSemaphore GfxDevice::CreateVkSemaphoreTimeline(uint64_t initValue, const char*
 	return semaphore;
 }
 
-void GfxDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) const
+void GfxDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GfxAllocation& bufferAllocation) const
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -201,24 +239,21 @@ void GfxDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemo
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(m_VkDevice, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-	HandleVkResult(vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &bufferMemory));
+	bufferAllocation = m_pMemoryAllocator->Allocate(memRequirements, properties, true);
 
-	vkBindBufferMemory(m_VkDevice, buffer, bufferMemory, 0);
+	HandleVkResult(vkBindBufferMemory(m_VkDevice, buffer, bufferAllocation.m_VkMemory, bufferAllocation.m_Offset));
 }
 
-void GfxDevice::CopyBuffer(VkCommandBuffer cmdBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const
+void GfxDevice::CopyBuffer(VkCommandBuffer cmdBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) const
 {
 	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(cmdBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 }
 
-void GfxDevice::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) const
+void GfxDevice::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, GfxAllocation& imageAllocation) const
 {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -240,14 +275,9 @@ void GfxDevice::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels,
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(m_VkDevice, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-	HandleVkResult(vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &imageMemory));
+	imageAllocation = m_pMemoryAllocator->Allocate(memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
 
-	vkBindImageMemory(m_VkDevice, image, imageMemory, 0);
+	HandleVkResult(vkBindImageMemory(m_VkDevice, image, imageAllocation.m_VkMemory, imageAllocation.m_Offset));
 }
 
 VkImageView GfxDevice::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) const
@@ -269,10 +299,10 @@ VkImageView GfxDevice::CreateImageView(VkImage image, VkFormat format, VkImageAs
 	return imageView;
 }
 
-void GfxDevice::CopyBufferToImage(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) const
+void GfxDevice::CopyBufferToImage(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset) const
 {
 	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
+	region.bufferOffset = bufferOffset;
 	region.bufferRowLength = 0;
 	region.bufferImageHeight = 0;
 	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -383,11 +413,15 @@ void GfxDevice::CreateVkInstance()
 	}
 #endif//defined(_DEBUG)
 
-	std::vector<const char*> instanceExtensionNames
+	std::vector<const char*> instanceExtensionNames;
+
+	if (!m_IsHeadless)
 	{
-		VK_KHR_SURFACE_EXTENSION_NAME,
-		VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
-	};
+		instanceExtensionNames.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+		instanceExtensionNames.emplace_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif //defined(VK_USE_PLATFORM_WIN32_KHR)
+	}
 
 	if (HasExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME, extensionProperties))
 		instanceExtensionNames.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -398,7 +432,7 @@ void GfxDevice::CreateVkInstance()
 
 #endif//defined(_DEBUG)
 
-	if (HasExtension(VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME, extensionProperties))
+	if (!m_IsHeadless && HasExtension(VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME, extensionProperties))
 	{
 		m_HasEXTSwapchainColorspace = true;
 		instanceExtensionNames.emplace_back(VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME);
@@ -486,12 +520,16 @@ void GfxDevice::CreateVkInstance()
 
 void GfxDevice::CreateSurface()
 {
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
 	VkWin32SurfaceCreateInfoKHR createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
 	createInfo.hwnd = WindowManager::Get().GetHWnd();
 	createInfo.hinstance = CoreSystems::Get().GetAppHinstance();
 
 	HandleVkResult(vkCreateWin32SurfaceKHR(m_VkInstance, &createInfo, nullptr, &m_VkSurface));
+#else
+	Logger::Get().LogError(L"No surface support on this platform, run with --headless.");
+#endif //defined(VK_USE_PLATFORM_WIN32_KHR)
 }
 
 void GfxDevice::SelectPhysicalDevice()
@@ -507,24 +545,43 @@ void GfxDevice::SelectPhysicalDevice()
 
 	for (const auto& device : devices)
 	{
-		if (IsDeviceSuitable(device))
+		if (IsDeviceSuitable(device, true))
 		{
 			m_VkPhysicalDevice = device;
 			return;
 		}
 	}
 
+	// Headless runs also accept integrated / software implementations (e.g. lavapipe on CI machines)
+	if (m_IsHeadless)
+	{
+		for (const auto& device : devices)
+		{
+			if (IsDeviceSuitable(device, false))
+			{
+				m_VkPhysicalDevice = device;
+				return;
+			}
+		}
+	}
+
 	Logger::Get().LogError(L"Failed to find any suitable physical device.");
 }
 
-bool GfxDevice::IsDeviceSuitable(VkPhysicalDevice device) const
+bool GfxDevice::IsDeviceSuitable(VkPhysicalDevice device, bool requireDiscreteGPU) const
 {
 	VkPhysicalDeviceProperties deviceProperties;
 	vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
-	if (deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_3)
 		return false;
 
+	if (requireDiscreteGPU && deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+		return false;
+
+	if (m_IsHeadless)
+		return true;
+
 	const SwapChainSupportDetails swapChainSupport{ QuerySwapChainSupport(device) };
 	if (swapChainSupport.m_Formats.empty() || swapChainSupport.m_PresentModes.empty())
 		return false;
@@ -532,7 +589,7 @@ bool GfxDevice::IsDeviceSuitable(VkPhysicalDevice device) const
 	return true;
 }
 
-uint32_t GfxDevice::FindQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlags flags)
+uint32_t GfxDevice::FindQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlags flags, uint32_t excludedFamily)
 {
 	uint32_t queueFamilyCount{};
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
@@ -540,10 +597,13 @@ uint32_t GfxDevice::FindQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlags f
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-	auto findDedicatedQueueFamilyIndex = [&queueFamilies](VkQueueFlags require, VkQueueFlags avoid) -> uint32_t
+	auto findDedicatedQueueFamilyIndex = [&queueFamilies, excludedFamily](VkQueueFlags require, VkQueueFlags avoid) -> uint32_t
 	{
 		for (uint32_t i{}; i < queueFamilies.size(); ++i)
 		{
+			if (i == excludedFamily)
+				continue;
+
 			const bool isSuitable{ (queueFamilies[i].queueFlags & require) == require };
 			const bool isDedicated{ (queueFamilies[i].queueFlags & avoid) == 0 };
 			if (queueFamilies[i].queueCount && isSuitable && isDedicated)
@@ -560,10 +620,14 @@ uint32_t GfxDevice::FindQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlags f
 			return q;
 	}
 
-	// dedicated queue for transfer
+	// dedicated queue for transfer, copy engines first (transfer only families), then async compute families
 	if (flags & VK_QUEUE_TRANSFER_BIT)
 	{
-		const uint32_t q{ findDedicatedQueueFamilyIndex(flags, VK_QUEUE_GRAPHICS_BIT) };
+		uint32_t q{ findDedicatedQueueFamilyIndex(flags, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) };
+		if (q != DeviceQueueInfo::sk_Invalid)
+			return q;
+
+		q = findDedicatedQueueFamilyIndex(flags, VK_QUEUE_GRAPHICS_BIT);
 		if (q != DeviceQueueInfo::sk_Invalid)
 			return q;
 	}
@@ -605,30 +669,37 @@ void GfxDevice::CreateLogicalDevice()
 
 	m_DeviceQueueInfo.m_GraphicsFamily = FindQueueFamilyIndex(m_VkPhysicalDevice, VK_QUEUE_GRAPHICS_BIT);
 	m_DeviceQueueInfo.m_ComputeFamily = FindQueueFamilyIndex(m_VkPhysicalDevice, VK_QUEUE_COMPUTE_BIT);
+	// Only one queue is created per family, a transfer family shared with async compute would have both submitting to the same VkQueue
+	const bool isAsyncCompute{ m_DeviceQueueInfo.m_ComputeFamily != m_DeviceQueueInfo.m_GraphicsFamily };
+	m_DeviceQueueInfo.m_TransferFamily = FindQueueFamilyIndex(m_VkPhysicalDevice, VK_QUEUE_TRANSFER_BIT, isAsyncCompute ? m_DeviceQueueInfo.m_ComputeFamily : DeviceQueueInfo::sk_Invalid);
+
+	// Graphics and compute families implicitly support transfers, fall back to the graphics queue
+	if (m_DeviceQueueInfo.m_TransferFamily == DeviceQueueInfo::sk_Invalid)
+		m_DeviceQueueInfo.m_TransferFamily = m_DeviceQueueInfo.m_GraphicsFamily;
+
+	logger.LogInfo(std::format(L"Queue families: graphics {}, compute {}, transfer {}\n", m_DeviceQueueInfo.m_GraphicsFamily, m_DeviceQueueInfo.m_ComputeFamily, m_DeviceQueueInfo.m_TransferFamily), false);
 
 	constexpr float queuePriority{ 1.0f };
-	const std::vector<VkDeviceQueueCreateInfo> queueCreateInfos
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
+	for (const uint32_t family : { m_DeviceQueueInfo.m_GraphicsFamily, m_DeviceQueueInfo.m_ComputeFamily, m_DeviceQueueInfo.m_TransferFamily })
 	{
-		{
-			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			.queueFamilyIndex = m_DeviceQueueInfo.m_GraphicsFamily,
-			.queueCount = 1,
-			.pQueuePriorities = &queuePriority
-		},
-		{
+		if (std::ranges::any_of(queueCreateInfos, [family](const VkDeviceQueueCreateInfo& info) { return info.queueFamilyIndex == family; }))
+			continue;
+
+		queueCreateInfos.emplace_back(VkDeviceQueueCreateInfo{
 			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			.queueFamilyIndex = m_DeviceQueueInfo.m_ComputeFamily,
+			.queueFamilyIndex = family,
 			.queueCount = 1,
 			.pQueuePriorities = &queuePriority
-		}
-	};
-	
-	const uint32_t numQueues{ queueCreateInfos[0].queueFamilyIndex == queueCreateInfos[1].queueFamilyIndex ? 1u : 2u };
+		});
+	}
 
-	std::vector<const char*> deviceExtensionNames
-	{
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-	};
+	const uint32_t numQueues{ static_cast<uint32_t>(queueCreateInfos.size()) };
+
+	std::vector<const char*> deviceExtensionNames;
+
+	if (!m_IsHeadless)
+		deviceExtensionNames.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
 	//TODO: Add extra features here (optional)
 
@@ -877,6 +948,7 @@ void GfxDevice::CreateLogicalDevice()
 
 	vkGetDeviceQueue(m_VkDevice, m_DeviceQueueInfo.m_GraphicsFamily, 0, &m_DeviceQueueInfo.m_GraphicsQueue);
 	vkGetDeviceQueue(m_VkDevice, m_DeviceQueueInfo.m_ComputeFamily, 0, &m_DeviceQueueInfo.m_ComputeQueue);
+	vkGetDeviceQueue(m_VkDevice, m_DeviceQueueInfo.m_TransferFamily, 0, &m_DeviceQueueInfo.m_TransferQueue);
 }
 
 SwapChainSupportDetails GfxDevice::QuerySwapChainSupport(VkPhysicalDevice device) const
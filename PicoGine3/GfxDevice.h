@@ -29,9 +29,11 @@ struct DeviceQueueInfo
 	static constexpr uint32_t sk_Invalid{ 0xffffffff };
 	uint32_t m_GraphicsFamily{ sk_Invalid };
 	uint32_t m_ComputeFamily{ sk_Invalid };
+	uint32_t m_TransferFamily{ sk_Invalid }; // same as m_GraphicsFamily when the device has no dedicated transfer family
 	//uint32_t m_PresentFamily{ sk_Invalid };
 	VkQueue m_GraphicsQueue{ VK_NULL_HANDLE };
 	VkQueue m_ComputeQueue{ VK_NULL_HANDLE };
+	VkQueue m_TransferQueue{ VK_NULL_HANDLE };
 	//VkQueue m_PresentQueue{ VK_NULL_HANDLE };
 
 	[[nodiscard]] bool IsComplete() const	
@@ -48,6 +50,8 @@ struct SwapChainSupportDetails
 };
 
 class GraphicsAPI;
+class GfxMemoryAllocator;
+struct GfxAllocation;
 
 class GfxDevice final
 {
@@ -67,6 +71,10 @@ public:
 	[[nodiscard]] const VkPhysicalDeviceLimits& GetPhysicalDeviceLimits() const;
 	[[nodiscard]] VkSurfaceKHR GetSurface() const;
 	[[nodiscard]] DeviceQueueInfo GetDeviceQueueInfo() const;
+	[[nodiscard]] bool IsHeadless() const;
+	[[nodiscard]] bool IsDrawIndirectCountSupported() const;
+	[[nodiscard]] uint32_t GetTimestampValidBits(uint32_t queueFamilyIndex) const;
+	[[nodiscard]] GfxMemoryAllocator* GetMemoryAllocator() const;
 
 	[[nodiscard]] SwapChainSupportDetails SwapChainSupport() const;
 	[[nodiscard]] uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
@@ -79,11 +87,11 @@ public:
 	[[nodiscard]] VkSemaphore CreateVkSemaphore(const char* name = nullptr) const;
 	[[nodiscard]] VkSemaphore CreateVkSemaphoreTimeline(uint64_t initValue, const char* name = nullptr) const;
 
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) const;
-	void CopyBuffer(VkCommandBuffer cmdBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const;
-	void CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) const;
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GfxAllocation& bufferAllocation) const;
+	void CopyBuffer(VkCommandBuffer cmdBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0) const;
+	void CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, GfxAllocation& imageAllocation) const;
 	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) const;
-	void CopyBufferToImage(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) const;
+	void CopyBufferToImage(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0) const;
 
 private:
 
@@ -96,7 +104,7 @@ private:
 
 	VkInstance m_VkInstance;
 
-	VkSurfaceKHR m_VkSurface;
+	VkSurfaceKHR m_VkSurface{ VK_NULL_HANDLE };
 
 	VkPhysicalDevice m_VkPhysicalDevice;
 	VkPhysicalDeviceDepthStencilResolveProperties m_VkPhysicalDeviceDepthStencilResolveProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES, nullptr };
@@ -111,9 +119,12 @@ private:
 	DeviceQueueInfo m_DeviceQueueInfo;
 	VkDevice m_VkDevice;
 
+	std::unique_ptr<GfxMemoryAllocator> m_pMemoryAllocator{};
+
 	uint32_t m_KhronosValidationVersion{};
 	bool m_HasEXTSwapchainColorspace{ false };
 	bool m_UseStaging{ false };
+	bool m_IsHeadless{ false };
 
 	static bool HasExtension(const char* ext, const std::vector<VkExtensionProperties>& extensionProperties);
 	static bool IsHostVisibleSingleHeapMemory(VkPhysicalDevice physicalDevice);
@@ -122,8 +133,9 @@ private:
 	void CreateVkInstance();
 	void CreateSurface();
 	void SelectPhysicalDevice();
-	bool IsDeviceSuitable(VkPhysicalDevice device) const;
-	static uint32_t FindQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlags flags);
+	bool IsDeviceSuitable(VkPhysicalDevice device, bool requireDiscreteGPU) const;
+	// excludedFamily is never returned, used to keep two submitters off the same queue
+	static uint32_t FindQueueFamilyIndex(VkPhysicalDevice device, VkQueueFlags flags, uint32_t excludedFamily = DeviceQueueInfo::sk_Invalid);
 	void CreateLogicalDevice();
 	SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device) const;
 
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "GfxGeometryArena.h"
+
+#include "GraphicsAPI.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxGeometryArena::GfxGeometryArena(GraphicsAPI* pGraphicsAPI, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity, const char* debugName) :
+	m_pGraphicsAPI{ pGraphicsAPI },
+	m_VertexStride{ vertexStride },
+	m_Vertices{ vertexCapacity },
+	m_Indices{ indexCapacity }
+{
+	const BufferDesc vbDesc{
+		.m_Usage = BufferUsageBits_Storage | BufferUsageBits_Vertex,
+		.m_Storage = StorageType_Device,
+		.m_Size = static_cast<size_t>(vertexStride) * vertexCapacity,
+		.m_DebugName = debugName
+	};
+	m_VertexBuffer = m_pGraphicsAPI->AcquireBuffer(vbDesc);
+
+	const BufferDesc ibDesc{
+		.m_Usage = BufferUsageBits_Storage | BufferUsageBits_Index,
+		.m_Storage = StorageType_Device,
+		.m_Size = sizeof(uint32_t) * static_cast<size_t>(indexCapacity),
+		.m_DebugName = debugName
+	};
+	m_IndexBuffer = m_pGraphicsAPI->AcquireBuffer(ibDesc);
+
+	assert(m_pGraphicsAPI->GetBuffer(m_VertexBuffer) && m_pGraphicsAPI->GetBuffer(m_IndexBuffer) && L"Unable to create geometry arena buffers");
+}
+
+GfxGeometryArena::~GfxGeometryArena()
+{
+	m_pGraphicsAPI->Destroy(m_VertexBuffer);
+	m_pGraphicsAPI->Destroy(m_IndexBuffer);
+}
+
+GeometryRange GfxGeometryArena::Allocate(uint32_t vertexCount, uint32_t indexCount)
+{
+	assert(vertexCount > 0 && indexCount > 0 && L"Empty geometry allocation.");
+
+	GeometryRange range{ .m_VertexCount = vertexCount, .m_IndexCount = indexCount };
+
+	if (!m_Vertices.Allocate(vertexCount, range.m_FirstVertex))
+		return {};
+
+	if (!m_Indices.Allocate(indexCount, range.m_FirstIndex))
+	{
+		m_Vertices.Release(range.m_FirstVertex, vertexCount);
+		return {};
+	}
+
+	return range;
+}
+
+void GfxGeometryArena::Free(const GeometryRange& range)
+{
+	if (range.Empty())
+		return;
+
+	m_pGraphicsAPI->AddDeferredTask(std::packaged_task<void()>([this, range]()
+	{
+		m_Vertices.Release(range.m_FirstVertex, range.m_VertexCount);
+		m_Indices.Release(range.m_FirstIndex, range.m_IndexCount);
+	}));
+}
+
+Handle<GfxBuffer> GfxGeometryArena::GetVertexBuffer() const
+{
+	return m_VertexBuffer;
+}
+
+Handle<GfxBuffer> GfxGeometryArena::GetIndexBuffer() const
+{
+	return m_IndexBuffer;
+}
+
+uint32_t GfxGeometryArena::GetVertexStride() const
+{
+	return m_VertexStride;
+}
+
+GfxGeometryArena::RangeAllocator::RangeAllocator(uint32_t capacity)
+{
+	m_FreeBlocks.emplace(0, capacity);
+}
+
+bool GfxGeometryArena::RangeAllocator::Allocate(uint32_t count, uint32_t& offset)
+{
+	const auto it{ std::ranges::find_if(m_FreeBlocks, [count](const auto& block) { return block.second >= count; }) };
+	if (it == m_FreeBlocks.end())
+		return false;
+
+	offset = it->first;
+	const uint32_t remaining{ it->second - count };
+	m_FreeBlocks.erase(it);
+
+	if (remaining > 0)
+		m_FreeBlocks.emplace(offset + count, remaining);
+
+	return true;
+}
+
+void GfxGeometryArena::RangeAllocator::Release(uint32_t offset, uint32_t count)
+{
+	auto next{ m_FreeBlocks.lower_bound(offset) };
+
+	if (next != m_FreeBlocks.begin())
+	{
+		const auto previous{ std::prev(next) };
+		assert(previous->first + previous->second <= offset && L"Geometry range released twice.");
+
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			count += previous->second;
+			m_FreeBlocks.erase(previous);
+		}
+	}
+
+	if (next != m_FreeBlocks.end() && offset + count == next->first)
+	{
+		count += next->second;
+		m_FreeBlocks.erase(next);
+	}
+
+	m_FreeBlocks.emplace(offset, count);
+}
+
+#endif
\ No newline at end of file
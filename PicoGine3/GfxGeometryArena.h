@@ -0,0 +1,67 @@
+#ifndef GFXGEOMETRYARENA_H
+#define GFXGEOMETRYARENA_H
+
+#include "GfxStructs.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GraphicsAPI;
+
+// Element ranges, not bytes, so they map directly onto vkCmdDrawIndexed's vertexOffset and firstIndex
+struct GeometryRange final
+{
+	uint32_t m_FirstVertex{};
+	uint32_t m_VertexCount{};
+	uint32_t m_FirstIndex{};
+	uint32_t m_IndexCount{};
+	[[nodiscard]] bool Empty() const { return m_VertexCount == 0; }
+};
+
+// One vertex and one index buffer shared by every mesh of a vertex format, so draws of different meshes never rebind geometry
+class GfxGeometryArena final
+{
+public:
+	explicit GfxGeometryArena(GraphicsAPI* pGraphicsAPI, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity, const char* debugName);
+	~GfxGeometryArena();
+
+	GfxGeometryArena(const GfxGeometryArena&) noexcept = delete;
+	GfxGeometryArena& operator=(const GfxGeometryArena&) noexcept = delete;
+	GfxGeometryArena(GfxGeometryArena&&) noexcept = delete;
+	GfxGeometryArena& operator=(GfxGeometryArena&&) noexcept = delete;
+
+	// Returns an empty range when either stream is out of space
+	[[nodiscard]] GeometryRange Allocate(uint32_t vertexCount, uint32_t indexCount);
+	// The range is reused once the command buffer being recorded has retired
+	void Free(const GeometryRange& range);
+
+	[[nodiscard]] Handle<GfxBuffer> GetVertexBuffer() const;
+	[[nodiscard]] Handle<GfxBuffer> GetIndexBuffer() const;
+	[[nodiscard]] uint32_t GetVertexStride() const;
+
+private:
+	// First fit over free blocks keyed by offset, neighbours are merged on release
+	class RangeAllocator final
+	{
+	public:
+		explicit RangeAllocator(uint32_t capacity);
+
+		[[nodiscard]] bool Allocate(uint32_t count, uint32_t& offset);
+		void Release(uint32_t offset, uint32_t count);
+
+	private:
+		std::map<uint32_t, uint32_t> m_FreeBlocks{};
+	};
+
+	GraphicsAPI* m_pGraphicsAPI;
+	uint32_t m_VertexStride;
+	Handle<GfxBuffer> m_VertexBuffer{};
+	Handle<GfxBuffer> m_IndexBuffer{};
+	RangeAllocator m_Vertices;
+	RangeAllocator m_Indices;
+};
+
+#endif
+
+#endif //GFXGEOMETRYARENA_H
\ No newline at end of file
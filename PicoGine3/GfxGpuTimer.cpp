@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "GfxGpuTimer.h"
+
+#include "Benchmark.h"
+#include "GraphicsAPI.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxGpuTimer::GfxGpuTimer(GraphicsAPI* pGraphicsAPI) :
+	m_pGraphicsAPI{ pGraphicsAPI }
+{
+	const GfxDevice* pDevice{ m_pGraphicsAPI->GetGfxDevice() };
+	const uint32_t validBits{ pDevice->GetTimestampValidBits(pDevice->GetDeviceQueueInfo().m_GraphicsFamily) };
+
+	// Only the benchmark report consumes GPU timings for now
+	m_IsEnabled = Benchmark::Get().IsEnabled() && validBits > 0;
+
+	if (Benchmark::Get().IsEnabled() && validBits == 0)
+		Logger::Get().LogWarning(L"Graphics queue does not support timestamps, GPU timings are disabled.");
+
+	if (!m_IsEnabled)
+		return;
+
+	m_TimestampPeriodMs = static_cast<double>(pDevice->GetPhysicalDeviceLimits().timestampPeriod) / 1'000'000.0;
+	m_TimestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{ 1 } << validBits) - 1;
+
+	for (auto& slot : m_FrameSlots)
+	{
+		slot.m_QueryPool = m_pGraphicsAPI->AcquireQueryPool({ .m_NumQueries = sk_MaxQueriesPerFrame, .m_DebugName = "GfxGpuTimer::m_FrameSlots" });
+		slot.m_Regions.reserve(sk_MaxQueriesPerFrame / 2);
+	}
+}
+
+GfxGpuTimer::~GfxGpuTimer()
+{
+	for (auto& slot : m_FrameSlots)
+		m_pGraphicsAPI->Destroy(slot.m_QueryPool);
+}
+
+bool GfxGpuTimer::IsEnabled() const
+{
+	return m_IsEnabled;
+}
+
+void GfxGpuTimer::BeginFrame(const GfxCommandBuffer& cmdBuffer)
+{
+	if (!m_IsEnabled)
+		return;
+
+	FrameSlot& slot{ m_FrameSlots[m_FrameIndex++ % sk_NumFrameSlots] };
+	m_pCurrentSlot = nullptr;
+	m_OpenRegions.clear();
+
+	if (slot.m_IsPending)
+	{
+		// Never wait on the GPU for timings, drop this frame instead if the slot is still in flight
+		if (!m_pGraphicsAPI->GetGfxImmediateCommands()->IsReady(slot.m_SubmitHandle))
+			return;
+
+		ResolveSlot(slot);
+	}
+
+	cmdBuffer.ResetQueryPool(slot.m_QueryPool, 0, sk_MaxQueriesPerFrame);
+	slot.m_Regions.clear();
+	slot.m_NumQueries = 0;
+	slot.m_SubmitHandle = {};
+
+	m_pCurrentSlot = &slot;
+	BeginRegion(cmdBuffer, "Frame");
+}
+
+void GfxGpuTimer::EndFrame(const GfxCommandBuffer& cmdBuffer)
+{
+	if (!m_pCurrentSlot)
+		return;
+
+	while (!m_OpenRegions.empty())
+		EndRegion(cmdBuffer);
+}
+
+void GfxGpuTimer::SetFrameSubmitHandle(SubmitHandle handle)
+{
+	if (!m_pCurrentSlot)
+		return;
+
+	m_pCurrentSlot->m_SubmitHandle = handle;
+	m_pCurrentSlot->m_IsPending = true;
+	m_pCurrentSlot = nullptr;
+}
+
+void GfxGpuTimer::BeginRegion(const GfxCommandBuffer& cmdBuffer, const char* name)
+{
+	if (!m_pCurrentSlot)
+		return;
+
+	// Keep room for the end query of every open region
+	if (m_pCurrentSlot->m_NumQueries + m_OpenRegions.size() + 2 > sk_MaxQueriesPerFrame)
+	{
+		m_OpenRegions.emplace_back(std::numeric_limits<uint32_t>::max());
+		return;
+	}
+
+	const uint32_t query{ m_pCurrentSlot->m_NumQueries++ };
+	cmdBuffer.WriteTimestamp(m_pCurrentSlot->m_QueryPool, query);
+
+	m_OpenRegions.emplace_back(static_cast<uint32_t>(m_pCurrentSlot->m_Regions.size()));
+	m_pCurrentSlot->m_Regions.emplace_back(Region{ name, query, query });
+}
+
+void GfxGpuTimer::EndRegion(const GfxCommandBuffer& cmdBuffer)
+{
+	if (!m_pCurrentSlot || m_OpenRegions.empty())
+		return;
+
+	const uint32_t regionIndex{ m_OpenRegions.back() };
+	m_OpenRegions.pop_back();
+
+	if (regionIndex == std::numeric_limits<uint32_t>::max())
+		return;
+
+	const uint32_t query{ m_pCurrentSlot->m_NumQueries++ };
+	cmdBuffer.WriteTimestamp(m_pCurrentSlot->m_QueryPool, query);
+	m_pCurrentSlot->m_Regions[regionIndex].m_EndQuery = query;
+}
+
+void GfxGpuTimer::ResolveSlot(FrameSlot& slot) const
+{
+	slot.m_IsPending = false;
+
+	if (slot.m_NumQueries == 0)
+		return;
+
+	std::array<uint64_t, sk_MaxQueriesPerFrame> timestamps{};
+	if (!m_pGraphicsAPI->GetQueryPoolResults(slot.m_QueryPool, 0, slot.m_NumQueries, timestamps.data()))
+		return;
+
+	auto& benchmark{ Benchmark::Get() };
+	for (const Region& region : slot.m_Regions)
+	{
+		if (region.m_EndQuery == region.m_BeginQuery)
+			continue;
+
+		const uint64_t ticks{ (timestamps[region.m_EndQuery] - timestamps[region.m_BeginQuery]) & m_TimestampMask };
+		benchmark.RecordGpuRegion(region.m_Name, static_cast<double>(ticks) * m_TimestampPeriodMs);
+	}
+}
+
+#endif
\ No newline at end of file
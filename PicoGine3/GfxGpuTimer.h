@@ -0,0 +1,72 @@
+#ifndef GFXGPUTIMER_H
+#define GFXGPUTIMER_H
+
+#include "GfxImmediateCommands.h"
+#include "GfxStructs.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GfxCommandBuffer;
+class GraphicsAPI;
+
+// Nested GPU timing regions written as timestamp queries, read back without stalling once the frame's submit has retired
+class GfxGpuTimer final
+{
+public:
+	explicit GfxGpuTimer(GraphicsAPI* pGraphicsAPI);
+	~GfxGpuTimer();
+
+	GfxGpuTimer(const GfxGpuTimer&) noexcept = delete;
+	GfxGpuTimer& operator=(const GfxGpuTimer&) noexcept = delete;
+	GfxGpuTimer(GfxGpuTimer&&) noexcept = delete;
+	GfxGpuTimer& operator=(GfxGpuTimer&&) noexcept = delete;
+
+	[[nodiscard]] bool IsEnabled() const;
+
+	// Must be called outside of a render pass, query resets are not allowed inside one
+	void BeginFrame(const GfxCommandBuffer& cmdBuffer);
+	void EndFrame(const GfxCommandBuffer& cmdBuffer);
+	void SetFrameSubmitHandle(SubmitHandle handle);
+
+	void BeginRegion(const GfxCommandBuffer& cmdBuffer, const char* name);
+	void EndRegion(const GfxCommandBuffer& cmdBuffer);
+
+private:
+	struct Region final
+	{
+		std::string m_Name{};
+		uint32_t m_BeginQuery{};
+		uint32_t m_EndQuery{};
+	};
+
+	struct FrameSlot final
+	{
+		QueryPoolHandle m_QueryPool{};
+		std::vector<Region> m_Regions{};
+		SubmitHandle m_SubmitHandle{};
+		uint32_t m_NumQueries{};
+		bool m_IsPending{};
+	};
+
+	// One more slot than frames in flight so a slot's submit has normally retired by the time it comes back around
+	static constexpr uint32_t sk_NumFrameSlots{ 4 };
+	static constexpr uint32_t sk_MaxQueriesPerFrame{ 128 };
+
+	GraphicsAPI* m_pGraphicsAPI;
+	bool m_IsEnabled{};
+	double m_TimestampPeriodMs{};
+	uint64_t m_TimestampMask{};
+
+	std::array<FrameSlot, sk_NumFrameSlots> m_FrameSlots{};
+	FrameSlot* m_pCurrentSlot{};
+	uint64_t m_FrameIndex{};
+	std::vector<uint32_t> m_OpenRegions{};
+
+	void ResolveSlot(FrameSlot& slot) const;
+};
+
+#endif
+
+#endif //GFXGPUTIMER_H
\ No newline at end of file
@@ -19,13 +19,26 @@ uint64_t SubmitHandle::Handle() const
 	return (static_cast<uint64_t>(m_SubmitId) << 32) + m_BufferIndex;
 }
 
-GfxImmediateCommands::GfxImmediateCommands(GfxDevice* pDevice, const char* debugName) :
+GfxImmediateCommands::GfxImmediateCommands(GfxDevice* pDevice, QueueType queueType, const char* debugName) :
 	m_pDevice{ pDevice },
 	m_DebugName{ debugName }
 {
 	const auto& queueInfo{ m_pDevice->GetDeviceQueueInfo() };
-	m_QueueFamilyIndex = queueInfo.m_GraphicsFamily;
-	m_Queue = queueInfo.m_GraphicsQueue;
+	switch (queueType)
+	{
+	case QueueType_Graphics:
+		m_QueueFamilyIndex = queueInfo.m_GraphicsFamily;
+		m_Queue = queueInfo.m_GraphicsQueue;
+		break;
+	case QueueType_Compute:
+		m_QueueFamilyIndex = queueInfo.m_ComputeFamily;
+		m_Queue = queueInfo.m_ComputeQueue;
+		break;
+	case QueueType_Transfer:
+		m_QueueFamilyIndex = queueInfo.m_TransferFamily;
+		m_Queue = queueInfo.m_TransferQueue;
+		break;
+	}
 
 	const auto& device{ m_pDevice->GetDevice() };
 
@@ -49,18 +62,23 @@ GfxImmediateCommands::GfxImmediateCommands(GfxDevice* pDevice, const char* debug
 	for (uint32_t i{}; i < sk_MaxCommandBuffers; ++i)
 	{
 		CommandBufferWrapper& buf{ m_CmdBuffers[i] };
-		char fenceName[256]{ 0 };
 		char semaphoreName[256]{ 0 };
 		if (debugName)
-		{
-			snprintf(fenceName, sizeof(fenceName) - 1, "Fence: %s (CmdBuf %u)", debugName, i);
 			snprintf(semaphoreName, sizeof(semaphoreName) - 1, "Semaphore: %s (CmdBuf %u)", debugName, i);
-		}
+
 		buf.m_Semaphore = m_pDevice->CreateVkSemaphore(semaphoreName);
-		buf.m_Fence = m_pDevice->CreateVkFence(fenceName);
 		HandleVkResult(vkAllocateCommandBuffers(device, &bufferAllocInfo, &buf.m_CmdBufferAllocated));
 		m_CmdBuffers[i].m_Handle.m_BufferIndex = i;
+
+		// Popped from the back, the lowest indices go first
+		m_FreeBufferIndices[sk_MaxCommandBuffers - 1 - i] = i;
 	}
+
+	char timelineName[256]{ 0 };
+	if (debugName)
+		snprintf(timelineName, sizeof(timelineName) - 1, "Timeline Semaphore: %s", debugName);
+
+	m_TimelineSemaphore = m_pDevice->CreateVkSemaphoreTimeline(0, timelineName);
 }
 
 GfxImmediateCommands::~GfxImmediateCommands()
@@ -70,42 +88,29 @@ GfxImmediateCommands::~GfxImmediateCommands()
 	const auto& device{ m_pDevice->GetDevice() };
 
 	for (const CommandBufferWrapper& buf : m_CmdBuffers)
-	{
-		// lifetimes of all VkFence objects are managed explicitly we do not use deferredTask() for them
-		vkDestroyFence(device, buf.m_Fence, nullptr);
 		vkDestroySemaphore(device, buf.m_Semaphore, nullptr);
-	}
 
+	vkDestroySemaphore(device, m_TimelineSemaphore, nullptr);
 	vkDestroyCommandPool(device, m_CommandPool, nullptr);
 }
 
 const CommandBufferWrapper& GfxImmediateCommands::Acquire()
 {
-	auto& logger{ Logger::Get() };
+	// A single counter read, it also keeps the completion seen by IsReady()'s fast check current
+	Purge();
 
+	// Every buffer is either encoding or in flight, block until the oldest submit completes instead of polling
 	if (!m_NumAvailableCommandBuffers)
-		Purge();
-
-	while (!m_NumAvailableCommandBuffers)
 	{
-		logger.LogInfo(L"Waiting for command buffers...\n");
+		assert(m_NumInFlight && L"Every command buffer is being encoded, none can ever be freed.");
+
+		WaitTimelineValue(m_CmdBuffers[m_InFlightBufferIndices[m_FirstInFlight]].m_TimelineValue);
 		Purge();
 	}
 
-	CommandBufferWrapper* current{};
-
-	// we are ok with any available buffer
-	for (CommandBufferWrapper& buffer : m_CmdBuffers)
-	{
-		if (buffer.m_CmdBuffer == VK_NULL_HANDLE)
-		{
-			current = &buffer;
-			break;
-		}
-	}
+	CommandBufferWrapper* current{ &m_CmdBuffers[m_FreeBufferIndices[--m_NumAvailableCommandBuffers]] };
 
 	current->m_Handle.m_SubmitId = m_SubmitCounter;
-	--m_NumAvailableCommandBuffers;
 
 	current->m_CmdBuffer = current->m_CmdBufferAllocated;
 	current->m_IsEncoding = true;
@@ -127,52 +132,51 @@ SubmitHandle GfxImmediateCommands::Submit(const CommandBufferWrapper& buffer)
 {
 	HandleVkResult(vkEndCommandBuffer(buffer.m_CmdBuffer));
 
-	VkSemaphoreSubmitInfo waitSemaphores[]{ {}, {} };
-	uint32_t numWaitSemaphores{};
-	if (m_WaitSemaphore.semaphore)
-		waitSemaphores[numWaitSemaphores++] = m_WaitSemaphore;
+	assert(m_NumBatchedSubmits < sk_MaxCommandBuffers && L"More queued submits than command buffers.");
+	BatchedSubmit& submit{ m_BatchedSubmits[m_NumBatchedSubmits++] };
+
+	submit.m_NumWaitSemaphores = 0;
+	for (uint32_t i{}; i < m_NumWaitSemaphores; ++i)
+		submit.m_WaitSemaphores[submit.m_NumWaitSemaphores++] = m_WaitSemaphores[i];
 	
+	// Signaled by the previous entry of the same batch is fine, entries execute in order
 	if (m_LastSubmitSemaphore.semaphore)
-		waitSemaphores[numWaitSemaphores++] = m_LastSubmitSemaphore;
+		submit.m_WaitSemaphores[submit.m_NumWaitSemaphores++] = m_LastSubmitSemaphore;
 	
-	VkSemaphoreSubmitInfo signalSemaphores[]
+	const uint64_t timelineValue{ ++m_LastSubmitTimelineValue };
+
+	submit.m_SignalSemaphores[0] = VkSemaphoreSubmitInfo
 	{
-		{
-			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-			.semaphore = buffer.m_Semaphore,
-			.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
-		},
-		{},
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = buffer.m_Semaphore,
+		.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+	};
+	submit.m_SignalSemaphores[1] = VkSemaphoreSubmitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = m_TimelineSemaphore,
+		.value = timelineValue,
+		.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
 	};
-	uint32_t numSignalSemaphores{ 1 };
+	submit.m_NumSignalSemaphores = 2;
 	if (m_SignalSemaphore.semaphore)
-		signalSemaphores[numSignalSemaphores++] = m_SignalSemaphore;
+		submit.m_SignalSemaphores[submit.m_NumSignalSemaphores++] = m_SignalSemaphore;
 
-	const VkCommandBufferSubmitInfo bufferSubmitInfo
+	submit.m_CmdBufferInfo = VkCommandBufferSubmitInfo
 	{
 	  .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
 	  .commandBuffer = buffer.m_CmdBuffer,
 	};
 
-	const VkSubmitInfo2 submitInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-		.waitSemaphoreInfoCount = numWaitSemaphores,
-		.pWaitSemaphoreInfos = waitSemaphores,
-		.commandBufferInfoCount = 1u,
-		.pCommandBufferInfos = &bufferSubmitInfo,
-		.signalSemaphoreInfoCount = numSignalSemaphores,
-		.pSignalSemaphoreInfos = signalSemaphores,
-	};
-
-	HandleVkResult(vkQueueSubmit2(m_Queue, 1u, &submitInfo, buffer.m_Fence));
-
 	m_LastSubmitSemaphore.semaphore = buffer.m_Semaphore;
 	m_LastSubmitHandle = buffer.m_Handle;
-	m_WaitSemaphore.semaphore = VK_NULL_HANDLE;
+	m_NumWaitSemaphores = 0;
 	m_SignalSemaphore.semaphore = VK_NULL_HANDLE;
 
-	const_cast<CommandBufferWrapper&>(buffer).m_IsEncoding = false;
+	CommandBufferWrapper& submitted{ const_cast<CommandBufferWrapper&>(buffer) };
+	submitted.m_IsEncoding = false;
+	submitted.m_TimelineValue = timelineValue;
+	m_InFlightBufferIndices[(m_FirstInFlight + m_NumInFlight++) % sk_MaxCommandBuffers] = submitted.m_Handle.m_BufferIndex;
 	++m_SubmitCounter;
 
 	// skip the 0 value when uint32_t wraps around (null SubmitHandle)
@@ -182,9 +186,46 @@ SubmitHandle GfxImmediateCommands::Submit(const CommandBufferWrapper& buffer)
 	return m_LastSubmitHandle;
 }
 
-void GfxImmediateCommands::WaitSemaphore(VkSemaphore semaphore)
+void GfxImmediateCommands::FlushSubmits()
 {
-	m_WaitSemaphore.semaphore = semaphore;
+	if (!m_NumBatchedSubmits)
+		return;
+
+	PROFILE_FUNCTION();
+
+	VkSubmitInfo2 submitInfos[sk_MaxCommandBuffers]{};
+	for (uint32_t i{}; i < m_NumBatchedSubmits; ++i)
+	{
+		const BatchedSubmit& submit{ m_BatchedSubmits[i] };
+		submitInfos[i] = VkSubmitInfo2
+		{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.waitSemaphoreInfoCount = submit.m_NumWaitSemaphores,
+			.pWaitSemaphoreInfos = submit.m_WaitSemaphores,
+			.commandBufferInfoCount = 1u,
+			.pCommandBufferInfos = &submit.m_CmdBufferInfo,
+			.signalSemaphoreInfoCount = submit.m_NumSignalSemaphores,
+			.pSignalSemaphoreInfos = submit.m_SignalSemaphores,
+		};
+	}
+
+	HandleVkResult(vkQueueSubmit2(m_Queue, m_NumBatchedSubmits, submitInfos, VK_NULL_HANDLE));
+	++m_QueueSubmitCount;
+
+	m_NumBatchedSubmits = 0;
+	m_FlushedTimelineValue = m_LastSubmitTimelineValue;
+}
+
+void GfxImmediateCommands::WaitSemaphore(VkSemaphore semaphore, uint64_t waitValue, VkPipelineStageFlags2 stageMask)
+{
+	assert(m_NumWaitSemaphores < sk_MaxWaitSemaphores && L"Too many wait semaphores for a single submit.");
+
+	m_WaitSemaphores[m_NumWaitSemaphores++] = VkSemaphoreSubmitInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = semaphore,
+		.value = waitValue,
+		.stageMask = stageMask,
+	};
 }
 
 void GfxImmediateCommands::SignalSemaphore(VkSemaphore semaphore, uint64_t signalValue)
@@ -198,14 +239,6 @@ VkSemaphore GfxImmediateCommands::AcquireLastSubmitSemaphore()
 	return std::exchange(m_LastSubmitSemaphore.semaphore, VK_NULL_HANDLE);
 }
 
-VkFence GfxImmediateCommands::GetVkFence(SubmitHandle handle) const
-{
-	if (handle.Empty())
-		return VK_NULL_HANDLE;
-
-	return m_CmdBuffers[handle.m_BufferIndex].m_Fence;
-}
-
 SubmitHandle GfxImmediateCommands::GetLastSubmitHandle() const
 {
 	return m_LastSubmitHandle;
@@ -216,6 +249,26 @@ SubmitHandle GfxImmediateCommands::GetNextSubmitHandle() const
 	return m_NextSubmitHandle;
 }
 
+uint32_t GfxImmediateCommands::GetQueueFamilyIndex() const
+{
+	return m_QueueFamilyIndex;
+}
+
+VkSemaphore GfxImmediateCommands::GetTimelineSemaphore() const
+{
+	return m_TimelineSemaphore;
+}
+
+uint64_t GfxImmediateCommands::GetLastSubmitTimelineValue() const
+{
+	return m_LastSubmitTimelineValue;
+}
+
+uint32_t GfxImmediateCommands::GetQueueSubmitCount() const
+{
+	return m_QueueSubmitCount;
+}
+
 bool GfxImmediateCommands::IsReady(SubmitHandle handle, bool fastCheckNoVulkan) const
 {
 	// Empty handle
@@ -231,84 +284,96 @@ bool GfxImmediateCommands::IsReady(SubmitHandle handle, bool fastCheckNoVulkan)
 	// Already recycled and reused
 	if (buffer.m_Handle.m_SubmitId != handle.m_SubmitId)
 		return true;
-	
+
+	// Not submitted yet
+	if (buffer.m_IsEncoding)
+		return false;
+
+	if (buffer.m_TimelineValue <= m_CompletedTimelineValue)
+		return true;
 
 	if (fastCheckNoVulkan)
-		return false; // Skip Vulkan API query, just let it retire naturally (when submitId for this bufferIndex gets incremented)
+		return false; // Skip Vulkan API query, the cached value moves forward on the next Purge()
 
-	const auto& device{ m_pDevice->GetDevice() };
-	return vkWaitForFences(device, 1, &buffer.m_Fence, VK_TRUE, 0) == VK_SUCCESS;
+	return buffer.m_TimelineValue <= UpdateCompletedTimelineValue();
 }
 
 void GfxImmediateCommands::Wait(SubmitHandle handle)
 {
-	const auto& device{ m_pDevice->GetDevice() };
 	auto& logger{ Logger::Get() };
 	if (handle.Empty())
 	{
-		vkDeviceWaitIdle(device);
+		vkDeviceWaitIdle(m_pDevice->GetDevice());
 		return;
 	}
 
 	if (IsReady(handle))
 			return;
 
-	if (!m_CmdBuffers[handle.m_BufferIndex].m_IsEncoding)
+	if (m_CmdBuffers[handle.m_BufferIndex].m_IsEncoding)
 	{
 		// we are waiting for a buffer which has not been submitted - this is probably a logic error somewhere in the calling code
 		logger.LogWarning(L"Waiting on a command buffer that hasn't been submitted yet. Potential code logic issue.");
 		return;
 	}
 
-	HandleVkResult(vkWaitForFences(device, 1, &m_CmdBuffers[handle.m_BufferIndex].m_Fence, VK_TRUE, UINT64_MAX));
+	WaitTimelineValue(m_CmdBuffers[handle.m_BufferIndex].m_TimelineValue);
 
 	Purge();
 }
 
 void GfxImmediateCommands::WaitAll()
 {
-	VkFence fences[sk_MaxCommandBuffers];
+	if (m_NumInFlight)
+		WaitTimelineValue(m_LastSubmitTimelineValue);
 
-	uint32_t numFences{};
+	Purge();
+}
 
-	for (const CommandBufferWrapper& buffer : m_CmdBuffers)
-		if (buffer.m_CmdBuffer != VK_NULL_HANDLE && !buffer.m_IsEncoding)
-			fences[numFences++] = buffer.m_Fence;
+void GfxImmediateCommands::Purge()
+{
+	if (!m_NumInFlight)
+		return;
 
-	if (numFences)
+	const uint64_t completedValue{ UpdateCompletedTimelineValue() };
+
+	while (m_NumInFlight)
 	{
-		const auto& device{ m_pDevice->GetDevice() };
-		HandleVkResult(vkWaitForFences(device, numFences, fences, VK_TRUE, UINT64_MAX));
-	}
+		CommandBufferWrapper& buffer{ m_CmdBuffers[m_InFlightBufferIndices[m_FirstInFlight]] };
+		if (buffer.m_TimelineValue > completedValue)
+			break;
 
-	Purge();
+		// The pool allows individual resets, vkBeginCommandBuffer() resets it implicitly when it is acquired again
+		buffer.m_CmdBuffer = VK_NULL_HANDLE;
+		m_FreeBufferIndices[m_NumAvailableCommandBuffers++] = buffer.m_Handle.m_BufferIndex;
+
+		m_FirstInFlight = (m_FirstInFlight + 1) % sk_MaxCommandBuffers;
+		--m_NumInFlight;
+	}
 }
 
-void GfxImmediateCommands::Purge()
+void GfxImmediateCommands::WaitTimelineValue(uint64_t value)
 {
-	const auto& device{ m_pDevice->GetDevice() };
+	if (value > m_FlushedTimelineValue)
+		FlushSubmits();
 
-	for (uint32_t i{}; i < sk_MaxCommandBuffers; ++i)
+	const VkSemaphoreWaitInfo waitInfo
 	{
-		// always start checking with the oldest submitted buffer, then wrap around
-		CommandBufferWrapper& buffer{ m_CmdBuffers[(i + m_LastSubmitHandle.m_BufferIndex + 1) % sk_MaxCommandBuffers] };
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &m_TimelineSemaphore,
+		.pValues = &value,
+	};
 
-		if (buffer.m_CmdBuffer == VK_NULL_HANDLE || buffer.m_IsEncoding)
-			continue;
+	HandleVkResult(vkWaitSemaphores(m_pDevice->GetDevice(), &waitInfo, UINT64_MAX));
+	m_CompletedTimelineValue = std::max(m_CompletedTimelineValue, value);
+}
 
-		const VkResult result{ vkWaitForFences(device, 1, &buffer.m_Fence, VK_TRUE, 0) };
+uint64_t GfxImmediateCommands::UpdateCompletedTimelineValue() const
+{
+	uint64_t value{};
+	HandleVkResult(vkGetSemaphoreCounterValue(m_pDevice->GetDevice(), m_TimelineSemaphore, &value));
+	m_CompletedTimelineValue = value;
 
-		if (result == VK_SUCCESS)
-		{
-			HandleVkResult(vkResetCommandBuffer(buffer.m_CmdBuffer, VkCommandBufferResetFlags{ 0 }));
-			HandleVkResult(vkResetFences(device, 1, &buffer.m_Fence));
-			buffer.m_CmdBuffer = VK_NULL_HANDLE;
-			++m_NumAvailableCommandBuffers;
-		}
-		else
-		{
-			if (result != VK_TIMEOUT)
-				HandleVkResult(result);
-		}
-	}
+	return value;
 }
@@ -16,17 +16,24 @@ struct CommandBufferWrapper
 	VkCommandBuffer m_CmdBuffer{ VK_NULL_HANDLE };
 	VkCommandBuffer m_CmdBufferAllocated{ VK_NULL_HANDLE };
 	SubmitHandle m_Handle{};
-	VkFence m_Fence{ VK_NULL_HANDLE };
+	uint64_t m_TimelineValue{}; // Signaled on the queue's timeline semaphore once the submit completes
 	VkSemaphore m_Semaphore{ VK_NULL_HANDLE };
 	bool m_IsEncoding{};
 };
 
+enum QueueType : uint8_t
+{
+	QueueType_Graphics,
+	QueueType_Compute,
+	QueueType_Transfer,
+};
+
 class GfxDevice;
 
 class GfxImmediateCommands final
 {
 public:
-	explicit GfxImmediateCommands(GfxDevice* pDevice, const char* debugName = nullptr);
+	explicit GfxImmediateCommands(GfxDevice* pDevice, QueueType queueType = QueueType_Graphics, const char* debugName = nullptr);
 	~GfxImmediateCommands();
 
 	GfxImmediateCommands(const GfxImmediateCommands&) noexcept = delete;
@@ -35,26 +42,57 @@ public:
 	GfxImmediateCommands& operator=(GfxImmediateCommands&&) noexcept = delete;
 
 	static constexpr uint32_t sk_MaxCommandBuffers{ 64 };
+	static constexpr uint32_t sk_MaxWaitSemaphores{ 4 };
 
 	const CommandBufferWrapper& Acquire();
+	// Queued with its semaphores, the batch reaches the queue in a single vkQueueSubmit2 on FlushSubmits().
+	// Waiting on a queued submit flushes the batch first
 	SubmitHandle Submit(const CommandBufferWrapper& buffer);
-	void WaitSemaphore(VkSemaphore semaphore);
+	void FlushSubmits();
+	// Waits accumulate until the next Submit(), waitValue is only used by timeline semaphores
+	void WaitSemaphore(VkSemaphore semaphore, uint64_t waitValue = 0, VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
 	void SignalSemaphore(VkSemaphore semaphore, uint64_t signalValue);
 	[[nodiscard]] VkSemaphore AcquireLastSubmitSemaphore();
-	[[nodiscard]] VkFence GetVkFence(SubmitHandle handle) const;
 	[[nodiscard]] SubmitHandle GetLastSubmitHandle() const;
 	[[nodiscard]] SubmitHandle GetNextSubmitHandle() const;
+	// The fast check compares against the completion last read from the timeline semaphore instead of reading it again
 	[[nodiscard]] bool IsReady(SubmitHandle handle, bool fastCheckNoVulkan = false) const;
+	[[nodiscard]] uint32_t GetQueueFamilyIndex() const;
+	// Signaled with an increasing value by every submit, other queues wait on it for cross-queue dependencies
+	[[nodiscard]] VkSemaphore GetTimelineSemaphore() const;
+	[[nodiscard]] uint64_t GetLastSubmitTimelineValue() const;
+	// vkQueueSubmit2 calls since creation
+	[[nodiscard]] uint32_t GetQueueSubmitCount() const;
 	void Wait(SubmitHandle handle);
 	void WaitAll();
 
 private:
+	struct BatchedSubmit final
+	{
+		VkSemaphoreSubmitInfo m_WaitSemaphores[sk_MaxWaitSemaphores + 1]{}; // Plus the previous submit's semaphore
+		uint32_t m_NumWaitSemaphores{};
+		VkSemaphoreSubmitInfo m_SignalSemaphores[3]{}; // Own semaphore, queue timeline, user signal
+		uint32_t m_NumSignalSemaphores{};
+		VkCommandBufferSubmitInfo m_CmdBufferInfo{};
+	};
+
 	GfxDevice* m_pDevice{};
 	VkQueue m_Queue{ VK_NULL_HANDLE };
 	VkCommandPool m_CommandPool{ VK_NULL_HANDLE };
 	uint32_t m_QueueFamilyIndex{};
 	const char* m_DebugName{};
 	CommandBufferWrapper m_CmdBuffers[sk_MaxCommandBuffers];
+	// Buffers ready to be acquired, used as a stack
+	uint32_t m_FreeBufferIndices[sk_MaxCommandBuffers]{};
+	// Submitted buffers in submission order, a ring starting at the oldest. Submits on one queue complete in order,
+	// so they retire from the front against a single timeline semaphore value
+	uint32_t m_InFlightBufferIndices[sk_MaxCommandBuffers]{};
+	uint32_t m_FirstInFlight{};
+	uint32_t m_NumInFlight{};
+	VkSemaphore m_TimelineSemaphore{ VK_NULL_HANDLE };
+	uint64_t m_LastSubmitTimelineValue{};
+	uint64_t m_FlushedTimelineValue{};
+	mutable uint64_t m_CompletedTimelineValue{};
 	SubmitHandle m_LastSubmitHandle{};
 	SubmitHandle m_NextSubmitHandle{};
 	VkSemaphoreSubmitInfo m_LastSubmitSemaphore
@@ -62,11 +100,8 @@ private:
 		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
 		.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
 	};
-	VkSemaphoreSubmitInfo m_WaitSemaphore
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-		.stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
-	};
+	VkSemaphoreSubmitInfo m_WaitSemaphores[sk_MaxWaitSemaphores]{};
+	uint32_t m_NumWaitSemaphores{};
 	VkSemaphoreSubmitInfo m_SignalSemaphore
 	{
 		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
@@ -74,8 +109,16 @@ private:
 	};
 	uint32_t m_NumAvailableCommandBuffers{ sk_MaxCommandBuffers };
 	uint32_t m_SubmitCounter{ 1 };
+	// Never more than one per command buffer
+	BatchedSubmit m_BatchedSubmits[sk_MaxCommandBuffers]{};
+	uint32_t m_NumBatchedSubmits{};
+	uint32_t m_QueueSubmitCount{};
 	
+	// Retires every completed submit with one read of the timeline semaphore
 	void Purge();
+	// Flushes first if the value belongs to a queued submit
+	void WaitTimelineValue(uint64_t value);
+	uint64_t UpdateCompletedTimelineValue() const;
 };
 
 #endif //GFXIMMEDIATECOMMANDS_H
\ No newline at end of file
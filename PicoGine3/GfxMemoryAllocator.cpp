@@ -0,0 +1,490 @@
+#include "pch.h"
+#include "GfxMemoryAllocator.h"
+
+#include <bit>
+
+#include "GfxDevice.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+namespace
+{
+	VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+#pragma region GfxTlsfHeap
+
+GfxTlsfHeap::GfxTlsfHeap(VkDeviceSize size) :
+	m_Size{ size }
+{
+	m_FreeLists.fill(sk_Null);
+
+	const uint32_t nodeIndex{ CreateNode() };
+	m_Nodes[nodeIndex].m_Offset = 0;
+	m_Nodes[nodeIndex].m_Size = size;
+	InsertFreeNode(nodeIndex);
+}
+
+bool GfxTlsfHeap::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& nodeIndex)
+{
+	// Searching for size + alignment - 1 guarantees the aligned range fits in whatever block is found
+	nodeIndex = FindFreeNode(size + alignment - 1);
+	if (nodeIndex == sk_Null)
+		return false;
+
+	RemoveFreeNode(nodeIndex);
+
+	const VkDeviceSize padding{ AlignUp(m_Nodes[nodeIndex].m_Offset, alignment) - m_Nodes[nodeIndex].m_Offset };
+	if (padding > 0)
+	{
+		// Give the alignment padding back as a free node, neighbours of a free node are never free so no merge is needed
+		const uint32_t frontIndex{ CreateNode() };
+		Node& node{ m_Nodes[nodeIndex] };
+		Node& front{ m_Nodes[frontIndex] };
+
+		front.m_Offset = node.m_Offset;
+		front.m_Size = padding;
+		front.m_PrevPhysical = node.m_PrevPhysical;
+		front.m_NextPhysical = nodeIndex;
+
+		if (node.m_PrevPhysical != sk_Null)
+			m_Nodes[node.m_PrevPhysical].m_NextPhysical = frontIndex;
+
+		node.m_Offset += padding;
+		node.m_Size -= padding;
+		node.m_PrevPhysical = frontIndex;
+
+		InsertFreeNode(frontIndex);
+	}
+
+	if (m_Nodes[nodeIndex].m_Size - size >= sk_MinSplitSize)
+	{
+		const uint32_t backIndex{ CreateNode() };
+		Node& node{ m_Nodes[nodeIndex] };
+		Node& back{ m_Nodes[backIndex] };
+
+		back.m_Offset = node.m_Offset + size;
+		back.m_Size = node.m_Size - size;
+		back.m_PrevPhysical = nodeIndex;
+		back.m_NextPhysical = node.m_NextPhysical;
+
+		if (node.m_NextPhysical != sk_Null)
+			m_Nodes[node.m_NextPhysical].m_PrevPhysical = backIndex;
+
+		node.m_Size = size;
+		node.m_NextPhysical = backIndex;
+
+		InsertFreeNode(backIndex);
+	}
+
+	Node& node{ m_Nodes[nodeIndex] };
+	node.m_IsFree = false;
+	m_UsedSize += node.m_Size;
+	++m_NumAllocations;
+
+	offset = node.m_Offset;
+	return true;
+}
+
+void GfxTlsfHeap::Free(uint32_t nodeIndex)
+{
+	assert(nodeIndex < m_Nodes.size() && !m_Nodes[nodeIndex].m_IsFree && L"Double free in GfxTlsfHeap.");
+
+	m_UsedSize -= m_Nodes[nodeIndex].m_Size;
+	--m_NumAllocations;
+	m_Nodes[nodeIndex].m_IsFree = true;
+
+	// Merge with the next physical node
+	const uint32_t nextIndex{ m_Nodes[nodeIndex].m_NextPhysical };
+	if (nextIndex != sk_Null && m_Nodes[nextIndex].m_IsFree)
+	{
+		RemoveFreeNode(nextIndex);
+
+		Node& node{ m_Nodes[nodeIndex] };
+		node.m_Size += m_Nodes[nextIndex].m_Size;
+		node.m_NextPhysical = m_Nodes[nextIndex].m_NextPhysical;
+		if (node.m_NextPhysical != sk_Null)
+			m_Nodes[node.m_NextPhysical].m_PrevPhysical = nodeIndex;
+
+		ReleaseNode(nextIndex);
+	}
+
+	// Merge into the previous physical node
+	const uint32_t prevIndex{ m_Nodes[nodeIndex].m_PrevPhysical };
+	if (prevIndex != sk_Null && m_Nodes[prevIndex].m_IsFree)
+	{
+		RemoveFreeNode(prevIndex);
+
+		Node& prev{ m_Nodes[prevIndex] };
+		prev.m_Size += m_Nodes[nodeIndex].m_Size;
+		prev.m_NextPhysical = m_Nodes[nodeIndex].m_NextPhysical;
+		if (prev.m_NextPhysical != sk_Null)
+			m_Nodes[prev.m_NextPhysical].m_PrevPhysical = prevIndex;
+
+		ReleaseNode(nodeIndex);
+		nodeIndex = prevIndex;
+	}
+
+	InsertFreeNode(nodeIndex);
+}
+
+bool GfxTlsfHeap::IsEmpty() const
+{
+	return m_NumAllocations == 0;
+}
+
+VkDeviceSize GfxTlsfHeap::GetSize() const
+{
+	return m_Size;
+}
+
+VkDeviceSize GfxTlsfHeap::GetUsedSize() const
+{
+	return m_UsedSize;
+}
+
+void GfxTlsfHeap::Mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+{
+	if (size < sk_SmallSize)
+	{
+		fl = 0;
+		sl = static_cast<uint32_t>(size / (sk_SmallSize / sk_SLCount));
+		return;
+	}
+
+	const uint32_t msb{ static_cast<uint32_t>(std::bit_width(size)) - 1 };
+	fl = msb - sk_FLShift + 1;
+	sl = static_cast<uint32_t>(size >> (msb - sk_SLBits)) - sk_SLCount;
+}
+
+uint32_t GfxTlsfHeap::FindFreeNode(VkDeviceSize size) const
+{
+	// Round up to the next list so any node found is large enough (good fit instead of first fit)
+	if (size < sk_SmallSize)
+		size = AlignUp(size, sk_SmallSize / sk_SLCount);
+
+	if (size >= sk_SmallSize)
+	{
+		const uint32_t msb{ static_cast<uint32_t>(std::bit_width(size)) - 1 };
+		size += (VkDeviceSize{ 1 } << (msb - sk_SLBits)) - 1;
+	}
+
+	uint32_t fl, sl;
+	Mapping(size, fl, sl);
+
+	if (fl >= sk_FLCount)
+		return sk_Null;
+
+	uint32_t slMap{ m_SLBitmaps[fl] & (~0u << sl) };
+	if (!slMap)
+	{
+		const uint64_t flMap{ fl + 1 < 64 ? m_FLBitmap & (~uint64_t{ 0 } << (fl + 1)) : 0 };
+		if (!flMap)
+			return sk_Null;
+
+		fl = static_cast<uint32_t>(std::countr_zero(flMap));
+		slMap = m_SLBitmaps[fl];
+	}
+
+	sl = static_cast<uint32_t>(std::countr_zero(slMap));
+	return m_FreeLists[fl * sk_SLCount + sl];
+}
+
+void GfxTlsfHeap::InsertFreeNode(uint32_t nodeIndex)
+{
+	Node& node{ m_Nodes[nodeIndex] };
+
+	uint32_t fl, sl;
+	Mapping(node.m_Size, fl, sl);
+
+	uint32_t& head{ m_FreeLists[fl * sk_SLCount + sl] };
+	node.m_IsFree = true;
+	node.m_PrevFree = sk_Null;
+	node.m_NextFree = head;
+
+	if (head != sk_Null)
+		m_Nodes[head].m_PrevFree = nodeIndex;
+
+	head = nodeIndex;
+	m_FLBitmap |= uint64_t{ 1 } << fl;
+	m_SLBitmaps[fl] |= 1u << sl;
+}
+
+void GfxTlsfHeap::RemoveFreeNode(uint32_t nodeIndex)
+{
+	const Node& node{ m_Nodes[nodeIndex] };
+
+	uint32_t fl, sl;
+	Mapping(node.m_Size, fl, sl);
+
+	if (node.m_PrevFree != sk_Null)
+		m_Nodes[node.m_PrevFree].m_NextFree = node.m_NextFree;
+	else
+		m_FreeLists[fl * sk_SLCount + sl] = node.m_NextFree;
+
+	if (node.m_NextFree != sk_Null)
+		m_Nodes[node.m_NextFree].m_PrevFree = node.m_PrevFree;
+
+	if (m_FreeLists[fl * sk_SLCount + sl] == sk_Null)
+	{
+		m_SLBitmaps[fl] &= ~(1u << sl);
+		if (!m_SLBitmaps[fl])
+			m_FLBitmap &= ~(uint64_t{ 1 } << fl);
+	}
+}
+
+uint32_t GfxTlsfHeap::CreateNode()
+{
+	if (!m_UnusedNodes.empty())
+	{
+		const uint32_t nodeIndex{ m_UnusedNodes.back() };
+		m_UnusedNodes.pop_back();
+		m_Nodes[nodeIndex] = Node{};
+		return nodeIndex;
+	}
+
+	m_Nodes.emplace_back();
+	return static_cast<uint32_t>(m_Nodes.size() - 1);
+}
+
+void GfxTlsfHeap::ReleaseNode(uint32_t nodeIndex)
+{
+	m_UnusedNodes.emplace_back(nodeIndex);
+}
+
+#pragma endregion
+
+#pragma region GfxMemoryAllocator
+
+GfxMemoryAllocator::GfxMemoryAllocator(GfxDevice* pDevice) :
+	m_pDevice{ pDevice }
+{
+	vkGetPhysicalDeviceMemoryProperties(m_pDevice->GetPhysicalDevice(), &m_VkMemoryProperties);
+
+	const VkPhysicalDeviceLimits& limits{ m_pDevice->GetPhysicalDeviceLimits() };
+	m_NonCoherentAtomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+	m_MaxMemoryAllocationCount = limits.maxMemoryAllocationCount;
+
+	m_BlockPools.resize(m_VkMemoryProperties.memoryTypeCount * 2);
+}
+
+GfxMemoryAllocator::~GfxMemoryAllocator()
+{
+	if (m_Stats.m_AllocationCount > 0)
+		Logger::Get().LogWarning(std::format(L"GfxMemoryAllocator destroyed with {} live allocations.", m_Stats.m_AllocationCount));
+
+	for (auto& pool : m_BlockPools)
+	{
+		for (const auto& pBlock : pool.m_Blocks)
+		{
+			if (pBlock)
+				FreeDeviceMemory(pBlock->m_VkMemory, pBlock->m_Heap.GetSize());
+		}
+	}
+}
+
+GfxAllocation GfxMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isLinearResource, bool prefersDedicated,
+	VkImage dedicatedImage, VkBuffer dedicatedBuffer)
+{
+	const uint32_t memoryTypeIndex{ m_pDevice->FindMemoryType(requirements.memoryTypeBits, properties) };
+	const VkMemoryPropertyFlags typeFlags{ m_VkMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags };
+
+	GfxAllocation allocation{};
+	allocation.m_MemoryTypeIndex = memoryTypeIndex;
+	allocation.m_IsLinear = isLinearResource;
+	allocation.m_IsCoherent = (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+	VkDeviceSize alignment{ std::max<VkDeviceSize>(requirements.alignment, 1) };
+	VkDeviceSize size{ requirements.size };
+
+	// Flushes and invalidations of non-coherent memory work on whole atoms, never let two allocations share one
+	if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !allocation.m_IsCoherent)
+	{
+		alignment = std::max(alignment, m_NonCoherentAtomSize);
+		size = AlignUp(size, m_NonCoherentAtomSize);
+	}
+
+	allocation.m_Size = size;
+
+	const VkDeviceSize blockSize{ GetBlockSize(memoryTypeIndex) };
+
+	const std::lock_guard lock{ m_Mutex };
+
+	if (prefersDedicated || size > blockSize / 2)
+	{
+		if (dedicatedImage != VK_NULL_HANDLE || dedicatedBuffer != VK_NULL_HANDLE)
+		{
+			// Dedicated allocations must match the resource requirements exactly, the whole range is flushed anyway
+			allocation.m_Size = requirements.size;
+
+			const VkMemoryDedicatedAllocateInfo dedicatedInfo{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+				.image = dedicatedImage,
+				.buffer = dedicatedBuffer
+			};
+			allocation.m_VkMemory = AllocateDeviceMemory(allocation.m_Size, memoryTypeIndex, &allocation.m_pMappedPtr, &dedicatedInfo);
+		}
+		else
+			allocation.m_VkMemory = AllocateDeviceMemory(size, memoryTypeIndex, &allocation.m_pMappedPtr);
+		allocation.m_BlockIndex = GfxAllocation::sk_Dedicated;
+		++m_Stats.m_DedicatedAllocationCount;
+	}
+	else
+	{
+		BlockPool& pool{ m_BlockPools[memoryTypeIndex * 2 + (isLinearResource ? 1 : 0)] };
+
+		bool isAllocated{};
+		uint32_t freeSlot{ GfxAllocation::sk_Dedicated };
+		for (uint32_t i{}; i < pool.m_Blocks.size() && !isAllocated; ++i)
+		{
+			Block* pBlock{ pool.m_Blocks[i].get() };
+			if (!pBlock)
+			{
+				freeSlot = std::min(freeSlot, i);
+				continue;
+			}
+
+			if (pBlock->m_Heap.Allocate(size, alignment, allocation.m_Offset, allocation.m_NodeIndex))
+			{
+				allocation.m_BlockIndex = i;
+				isAllocated = true;
+			}
+		}
+
+		if (!isAllocated)
+		{
+			auto pBlock{ std::make_unique<Block>(Block{ .m_Heap = GfxTlsfHeap{ blockSize } }) };
+			pBlock->m_VkMemory = AllocateDeviceMemory(blockSize, memoryTypeIndex, &pBlock->m_pMappedPtr);
+
+			[[maybe_unused]] const bool result{ pBlock->m_Heap.Allocate(size, alignment, allocation.m_Offset, allocation.m_NodeIndex) };
+			assert(result && L"Fresh memory block could not fit the allocation.");
+
+			if (freeSlot == GfxAllocation::sk_Dedicated)
+			{
+				freeSlot = static_cast<uint32_t>(pool.m_Blocks.size());
+				pool.m_Blocks.emplace_back();
+			}
+
+			pool.m_Blocks[freeSlot] = std::move(pBlock);
+			allocation.m_BlockIndex = freeSlot;
+			++m_Stats.m_BlockCount;
+		}
+
+		const Block& block{ *pool.m_Blocks[allocation.m_BlockIndex] };
+		allocation.m_VkMemory = block.m_VkMemory;
+		if (block.m_pMappedPtr)
+			allocation.m_pMappedPtr = static_cast<uint8_t*>(block.m_pMappedPtr) + allocation.m_Offset;
+	}
+
+	++m_Stats.m_AllocationCount;
+	m_Stats.m_BytesUsed += allocation.m_Size;
+
+	return allocation;
+}
+
+void GfxMemoryAllocator::Free(const GfxAllocation& allocation)
+{
+	if (!allocation.IsValid())
+		return;
+
+	const std::lock_guard lock{ m_Mutex };
+
+	--m_Stats.m_AllocationCount;
+	m_Stats.m_BytesUsed -= allocation.m_Size;
+
+	if (allocation.IsDedicated())
+	{
+		--m_Stats.m_DedicatedAllocationCount;
+		FreeDeviceMemory(allocation.m_VkMemory, allocation.m_Size);
+		return;
+	}
+
+	BlockPool& pool{ m_BlockPools[allocation.m_MemoryTypeIndex * 2 + (allocation.m_IsLinear ? 1 : 0)] };
+	auto& pBlock{ pool.m_Blocks[allocation.m_BlockIndex] };
+	assert(pBlock && pBlock->m_VkMemory == allocation.m_VkMemory && L"Allocation does not belong to this allocator.");
+
+	pBlock->m_Heap.Free(allocation.m_NodeIndex);
+
+	if (!pBlock->m_Heap.IsEmpty())
+		return;
+
+	// Keep one empty block per pool around so load/unload patterns do not hit vkAllocateMemory every time
+	const auto numBlocks{ std::ranges::count_if(pool.m_Blocks, [](const auto& pOther) { return pOther != nullptr; }) };
+	if (numBlocks > 1)
+	{
+		FreeDeviceMemory(pBlock->m_VkMemory, pBlock->m_Heap.GetSize());
+		pBlock.reset();
+		--m_Stats.m_BlockCount;
+	}
+}
+
+GfxMemoryStats GfxMemoryAllocator::GetStats() const
+{
+	const std::lock_guard lock{ m_Mutex };
+	return m_Stats;
+}
+
+VkDeviceSize GfxMemoryAllocator::GetNonCoherentAtomSize() const
+{
+	return m_NonCoherentAtomSize;
+}
+
+VkDeviceSize GfxMemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) const
+{
+	// Small heaps (host-visible device local BAR, integrated GPUs) get smaller blocks
+	const VkDeviceSize heapSize{ m_VkMemoryProperties.memoryHeaps[m_VkMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size };
+	return std::min(sk_MaxBlockSize, std::bit_floor(std::max<VkDeviceSize>(heapSize / 8, 1)));
+}
+
+VkDeviceMemory GfxMemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** ppMappedPtr, const VkMemoryDedicatedAllocateInfo* pDedicatedInfo)
+{
+	if (m_Stats.m_VkAllocationCount >= m_MaxMemoryAllocationCount)
+		Logger::Get().LogWarning(std::format(L"Device memory allocation count reached maxMemoryAllocationCount ({}).", m_MaxMemoryAllocationCount));
+
+	const VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+		.pNext = pDedicatedInfo,
+		.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR,
+	};
+
+	const VkMemoryAllocateInfo allocateInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = &memoryAllocateFlagsInfo,
+		.allocationSize = size,
+		.memoryTypeIndex = memoryTypeIndex,
+	};
+
+	const auto& device{ m_pDevice->GetDevice() };
+
+	VkDeviceMemory memory{ VK_NULL_HANDLE };
+	HandleVkResult(vkAllocateMemory(device, &allocateInfo, nullptr, &memory));
+
+	// Host-visible memory stays mapped for its whole lifetime
+	if (m_VkMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		HandleVkResult(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, ppMappedPtr));
+
+	++m_Stats.m_VkAllocationCount;
+	++m_Stats.m_TotalVkAllocateCalls;
+	m_Stats.m_BytesReserved += size;
+	m_Stats.m_PeakBytesReserved = std::max(m_Stats.m_PeakBytesReserved, m_Stats.m_BytesReserved);
+
+	return memory;
+}
+
+void GfxMemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size)
+{
+	// vkFreeMemory implicitly unmaps
+	vkFreeMemory(m_pDevice->GetDevice(), memory, nullptr);
+
+	--m_Stats.m_VkAllocationCount;
+	m_Stats.m_BytesReserved -= size;
+}
+
+#pragma endregion
+
+#endif
\ No newline at end of file
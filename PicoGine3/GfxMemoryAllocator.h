@@ -0,0 +1,137 @@
+#ifndef GFXMEMORYALLOCATOR_H
+#define GFXMEMORYALLOCATOR_H
+
+#include <mutex>
+
+#include "GfxStructs.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GfxDevice;
+
+struct GfxMemoryStats final
+{
+	uint64_t m_BytesReserved{}; // device memory held by blocks and dedicated allocations
+	uint64_t m_BytesUsed{}; // handed out to resources
+	uint64_t m_PeakBytesReserved{};
+	uint64_t m_TotalVkAllocateCalls{};
+	uint32_t m_BlockCount{};
+	uint32_t m_AllocationCount{};
+	uint32_t m_DedicatedAllocationCount{};
+	uint32_t m_VkAllocationCount{}; // live vkAllocateMemory allocations, bounded by maxMemoryAllocationCount
+};
+
+// Two-level segregated fit heap managing the ranges of a single device memory block, O(1) allocation and free
+class GfxTlsfHeap final
+{
+public:
+	explicit GfxTlsfHeap(VkDeviceSize size);
+	~GfxTlsfHeap() = default;
+
+	GfxTlsfHeap(const GfxTlsfHeap&) noexcept = delete;
+	GfxTlsfHeap& operator=(const GfxTlsfHeap&) noexcept = delete;
+	GfxTlsfHeap(GfxTlsfHeap&&) noexcept = default;
+	GfxTlsfHeap& operator=(GfxTlsfHeap&&) noexcept = default;
+
+	[[nodiscard]] bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& nodeIndex);
+	void Free(uint32_t nodeIndex);
+
+	[[nodiscard]] bool IsEmpty() const;
+	[[nodiscard]] VkDeviceSize GetSize() const;
+	[[nodiscard]] VkDeviceSize GetUsedSize() const;
+
+private:
+	static constexpr uint32_t sk_Null{ 0xFFFFFFFF };
+	static constexpr uint32_t sk_SLBits{ 4 };
+	static constexpr uint32_t sk_SLCount{ 1u << sk_SLBits };
+	static constexpr uint32_t sk_FLShift{ 8 };
+	static constexpr uint32_t sk_FLCount{ 40 };
+	static constexpr VkDeviceSize sk_SmallSize{ VkDeviceSize{ 1 } << sk_FLShift };
+	static constexpr VkDeviceSize sk_MinSplitSize{ 64 };
+
+	struct Node final
+	{
+		VkDeviceSize m_Offset{};
+		VkDeviceSize m_Size{};
+		uint32_t m_PrevPhysical{ sk_Null };
+		uint32_t m_NextPhysical{ sk_Null };
+		uint32_t m_PrevFree{ sk_Null };
+		uint32_t m_NextFree{ sk_Null };
+		bool m_IsFree{};
+	};
+
+	VkDeviceSize m_Size{};
+	VkDeviceSize m_UsedSize{};
+	uint32_t m_NumAllocations{};
+
+	uint64_t m_FLBitmap{};
+	std::array<uint32_t, sk_FLCount> m_SLBitmaps{};
+	std::array<uint32_t, sk_FLCount * sk_SLCount> m_FreeLists{};
+
+	std::vector<Node> m_Nodes{};
+	std::vector<uint32_t> m_UnusedNodes{};
+
+	static void Mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+	[[nodiscard]] uint32_t FindFreeNode(VkDeviceSize size) const;
+	void InsertFreeNode(uint32_t nodeIndex);
+	void RemoveFreeNode(uint32_t nodeIndex);
+	[[nodiscard]] uint32_t CreateNode();
+	void ReleaseNode(uint32_t nodeIndex);
+};
+
+// Sub-allocates buffers and images from large per memory type blocks instead of one vkAllocateMemory per resource
+class GfxMemoryAllocator final
+{
+public:
+	explicit GfxMemoryAllocator(GfxDevice* pDevice);
+	~GfxMemoryAllocator();
+
+	GfxMemoryAllocator(const GfxMemoryAllocator&) noexcept = delete;
+	GfxMemoryAllocator& operator=(const GfxMemoryAllocator&) noexcept = delete;
+	GfxMemoryAllocator(GfxMemoryAllocator&&) noexcept = delete;
+	GfxMemoryAllocator& operator=(GfxMemoryAllocator&&) noexcept = delete;
+
+	// isLinearResource: buffers and linear images, optimal tiling images must pass false
+	// dedicatedImage/dedicatedBuffer: resource the memory is bound to, chained into dedicated allocations so the driver can optimize them
+	[[nodiscard]] GfxAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isLinearResource, bool prefersDedicated = false,
+		VkImage dedicatedImage = VK_NULL_HANDLE, VkBuffer dedicatedBuffer = VK_NULL_HANDLE);
+	void Free(const GfxAllocation& allocation);
+
+	[[nodiscard]] GfxMemoryStats GetStats() const;
+	[[nodiscard]] VkDeviceSize GetNonCoherentAtomSize() const;
+
+private:
+	struct Block final
+	{
+		VkDeviceMemory m_VkMemory{ VK_NULL_HANDLE };
+		void* m_pMappedPtr{};
+		GfxTlsfHeap m_Heap;
+	};
+
+	// Linear and optimal resources never share a block, which keeps bufferImageGranularity out of the picture
+	struct BlockPool final
+	{
+		std::vector<std::unique_ptr<Block>> m_Blocks{};
+	};
+
+	static constexpr VkDeviceSize sk_MaxBlockSize{ VkDeviceSize{ 256 } << 20 };
+
+	GfxDevice* m_pDevice;
+	VkPhysicalDeviceMemoryProperties m_VkMemoryProperties{};
+	VkDeviceSize m_NonCoherentAtomSize{ 1 };
+	uint32_t m_MaxMemoryAllocationCount{};
+
+	mutable std::mutex m_Mutex{};
+	std::vector<BlockPool> m_BlockPools{};
+	GfxMemoryStats m_Stats{};
+
+	[[nodiscard]] VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex) const;
+	[[nodiscard]] VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** ppMappedPtr, const VkMemoryDedicatedAllocateInfo* pDedicatedInfo = nullptr);
+	void FreeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size);
+};
+
+#endif
+
+#endif //GFXMEMORYALLOCATOR_H
\ No newline at end of file
@@ -0,0 +1,502 @@
+#include "pch.h"
+#include "GfxRenderGraph.h"
+
+#include "GfxMemoryAllocator.h"
+#include "GraphicsAPI.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxRenderGraph::PassBuilder::PassBuilder(GfxRenderGraph* pGraph, uint32_t passIndex) :
+	m_pGraph{ pGraph },
+	m_PassIndex{ passIndex }
+{
+}
+
+GfxRenderGraph::PassBuilder& GfxRenderGraph::PassBuilder::Read(ResourceID resource, StageAccess stageAccess)
+{
+	m_pGraph->AddAccess(m_PassIndex, Access{ .m_Resource = resource, .m_StageAccess = stageAccess });
+	return *this;
+}
+
+GfxRenderGraph::PassBuilder& GfxRenderGraph::PassBuilder::Write(ResourceID resource, StageAccess stageAccess)
+{
+	m_pGraph->AddAccess(m_PassIndex, Access{ .m_Resource = resource, .m_StageAccess = stageAccess, .m_IsWrite = true });
+	return *this;
+}
+
+GfxRenderGraph::PassBuilder& GfxRenderGraph::PassBuilder::Read(ResourceID resource, VkImageLayout layout, StageAccess stageAccess)
+{
+	if (stageAccess.m_Stage == VK_PIPELINE_STAGE_2_NONE)
+		stageAccess = GfxImage::GetPipelineStageAccess(layout);
+
+	m_pGraph->AddAccess(m_PassIndex, Access{ .m_Resource = resource, .m_StageAccess = stageAccess, .m_Layout = layout });
+	return *this;
+}
+
+GfxRenderGraph::PassBuilder& GfxRenderGraph::PassBuilder::Write(ResourceID resource, VkImageLayout layout, bool discard, StageAccess stageAccess)
+{
+	if (stageAccess.m_Stage == VK_PIPELINE_STAGE_2_NONE)
+		stageAccess = GfxImage::GetPipelineStageAccess(layout);
+
+	m_pGraph->AddAccess(m_PassIndex, Access{ .m_Resource = resource, .m_StageAccess = stageAccess, .m_Layout = layout, .m_IsWrite = true, .m_Discard = discard });
+	return *this;
+}
+
+GfxRenderGraph::PassBuilder& GfxRenderGraph::PassBuilder::SideEffect()
+{
+	m_pGraph->m_Passes[m_PassIndex].m_HasSideEffect = true;
+	return *this;
+}
+
+GfxRenderGraph::GfxRenderGraph(GraphicsAPI* pGraphicsAPI) :
+	m_pGraphicsAPI{ pGraphicsAPI }
+{
+}
+
+GfxRenderGraph::~GfxRenderGraph()
+{
+	ReleaseTransientImages();
+}
+
+GfxRenderGraph::ResourceID GfxRenderGraph::ImportImage(GfxImage* pImage)
+{
+	assert(pImage && L"Importing a null image.");
+
+	Resource& resource{ m_Resources.emplace_back(Resource{ .m_pImage = pImage }) };
+	resource.m_State.m_Layout = pImage->m_CurrentVkImageLayout;
+
+	// The last access is unknown, the one of the layout it was left in is assumed
+	if (resource.m_State.m_Layout != VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+		const StageAccess stageAccess{ GfxImage::GetPipelineStageAccess(resource.m_State.m_Layout) };
+		resource.m_State.m_SrcStage = stageAccess.m_Stage;
+		resource.m_State.m_SrcAccess = stageAccess.m_Access & sk_WriteAccessMask;
+	}
+
+	return static_cast<ResourceID>(m_Resources.size() - 1);
+}
+
+GfxRenderGraph::ResourceID GfxRenderGraph::ImportBuffer(VkBuffer vkBuffer)
+{
+	assert(vkBuffer != VK_NULL_HANDLE && L"Importing a null buffer.");
+
+	m_Resources.emplace_back(Resource{ .m_VkBuffer = vkBuffer });
+	return static_cast<ResourceID>(m_Resources.size() - 1);
+}
+
+GfxRenderGraph::ResourceID GfxRenderGraph::CreateTransientImage(const TransientImageDesc& desc)
+{
+	assert(desc.m_Format != VK_FORMAT_UNDEFINED && desc.m_Extent.width > 0 && desc.m_Extent.height > 0 && desc.m_Usage && L"Invalid transient image description.");
+
+	m_Resources.emplace_back(Resource{ .m_TransientIndex = static_cast<uint32_t>(m_TransientDeclarations.size()) });
+	m_TransientDeclarations.emplace_back(TransientImage{ .m_Desc = desc });
+
+	return static_cast<ResourceID>(m_Resources.size() - 1);
+}
+
+GfxImage* GfxRenderGraph::GetImage(ResourceID resource) const
+{
+	return m_Resources[resource].m_pImage;
+}
+
+GfxRenderGraph::PassBuilder GfxRenderGraph::AddPass(const char* name, ExecuteCallback&& execute)
+{
+	m_Passes.emplace_back(Pass{ .m_Name = name, .m_Execute = std::move(execute) });
+	return PassBuilder{ this, static_cast<uint32_t>(m_Passes.size() - 1) };
+}
+
+void GfxRenderGraph::Execute(GfxCommandBuffer& cmdBuffer)
+{
+	PROFILE_FUNCTION();
+
+	m_Stats.m_PassCount = static_cast<uint32_t>(m_Passes.size());
+	m_Stats.m_CulledPassCount = 0;
+	m_Stats.m_BarrierCount = 0;
+	m_Stats.m_BarrierBatchCount = 0;
+
+	CullPasses();
+	ComputeTransientLifetimes();
+
+	// Images are bound to their memory for good, any change to the declarations or lifetimes rebuilds the whole set
+	if (!MatchesTransientImages())
+	{
+		ReleaseTransientImages();
+		m_TransientImages = std::move(m_TransientDeclarations);
+		CreateTransientImages();
+	}
+	m_TransientDeclarations.clear();
+
+	for (Resource& resource : m_Resources)
+		if (resource.m_TransientIndex != sk_InvalidIndex)
+			resource.m_pImage = &m_TransientImages[resource.m_TransientIndex].m_Image;
+
+	GfxGpuTimer* pGpuTimer{ m_pGraphicsAPI->GetGfxGpuTimer() };
+	const VkCommandBuffer vkCmdBuffer{ cmdBuffer.GetCmdBuffer() };
+
+	for (uint32_t passIndex{}; passIndex < m_Passes.size(); ++passIndex)
+	{
+		const Pass& pass{ m_Passes[passIndex] };
+		if (pass.m_IsCulled)
+			continue;
+
+		m_ImageBarriers.clear();
+		m_BufferBarriers.clear();
+
+		for (const Access& access : pass.m_Accesses)
+		{
+			Resource& resource{ m_Resources[access.m_Resource] };
+
+			// Whatever the memory held is dropped, only the accesses of the last image using it are waited on
+			if (resource.m_TransientIndex != sk_InvalidIndex && m_TransientImages[resource.m_TransientIndex].m_FirstPass == passIndex)
+			{
+				const ResourceState& slotState{ m_MemorySlots[m_TransientImages[resource.m_TransientIndex].m_MemorySlot].m_State };
+				resource.m_State = ResourceState{ .m_SrcStage = slotState.m_SrcStage | slotState.m_ReadStages, .m_SrcAccess = slotState.m_SrcAccess };
+			}
+
+			AddBarrier(resource, access);
+		}
+
+		cmdBuffer.PushDebugGroupLabel(pass.m_Name);
+		pGpuTimer->BeginRegion(cmdBuffer, pass.m_Name);
+
+		if (!m_ImageBarriers.empty() || !m_BufferBarriers.empty())
+		{
+			const VkDependencyInfo dependency
+			{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.bufferMemoryBarrierCount = static_cast<uint32_t>(m_BufferBarriers.size()),
+				.pBufferMemoryBarriers = m_BufferBarriers.data(),
+				.imageMemoryBarrierCount = static_cast<uint32_t>(m_ImageBarriers.size()),
+				.pImageMemoryBarriers = m_ImageBarriers.data(),
+			};
+			vkCmdPipelineBarrier2(vkCmdBuffer, &dependency);
+
+			m_Stats.m_BarrierCount += static_cast<uint32_t>(m_ImageBarriers.size() + m_BufferBarriers.size());
+			++m_Stats.m_BarrierBatchCount;
+		}
+
+		pass.m_Execute(cmdBuffer);
+
+		pGpuTimer->EndRegion(cmdBuffer);
+		cmdBuffer.PopDebugGroupLabel();
+
+		for (const Access& access : pass.m_Accesses)
+		{
+			const Resource& resource{ m_Resources[access.m_Resource] };
+			if (resource.m_TransientIndex != sk_InvalidIndex && m_TransientImages[resource.m_TransientIndex].m_LastPass == passIndex)
+				m_MemorySlots[m_TransientImages[resource.m_TransientIndex].m_MemorySlot].m_State = resource.m_State;
+		}
+	}
+
+	for (const Resource& resource : m_Resources)
+		if (resource.m_pImage)
+			resource.m_pImage->m_CurrentVkImageLayout = resource.m_State.m_Layout;
+
+	m_Passes.clear();
+	m_Resources.clear();
+}
+
+GfxRenderGraphStats GfxRenderGraph::GetStats() const
+{
+	return m_Stats;
+}
+
+void GfxRenderGraph::AddAccess(uint32_t passIndex, const Access& access)
+{
+	assert(access.m_Resource < m_Resources.size() && L"Unknown render graph resource.");
+	assert(access.m_StageAccess.m_Stage != VK_PIPELINE_STAGE_2_NONE && L"Render graph accesses need a pipeline stage.");
+
+	std::vector<Access>& accesses{ m_Passes[passIndex].m_Accesses };
+
+	const auto it{ std::ranges::find(accesses, access.m_Resource, &Access::m_Resource) };
+	if (it == accesses.end())
+	{
+		accesses.emplace_back(access);
+		return;
+	}
+
+	// A resource used several ways by a pass is a single access, the contents are only dropped if every use discards them
+	assert(it->m_Layout == access.m_Layout && L"An image can only be in one layout during a pass.");
+	it->m_StageAccess.m_Stage |= access.m_StageAccess.m_Stage;
+	it->m_StageAccess.m_Access |= access.m_StageAccess.m_Access;
+	it->m_Discard = it->m_Discard && access.m_Discard;
+	it->m_IsWrite = it->m_IsWrite || access.m_IsWrite;
+}
+
+void GfxRenderGraph::CullPasses()
+{
+	// Walking back from the side effects, a pass survives when a surviving pass after it needs something it writes
+	std::vector<bool> isNeeded(m_Resources.size());
+
+	for (auto pass{ m_Passes.rbegin() }; pass != m_Passes.rend(); ++pass)
+	{
+		pass->m_IsCulled = !pass->m_HasSideEffect && std::ranges::none_of(pass->m_Accesses, [&isNeeded](const Access& access)
+		{
+			return access.m_IsWrite && isNeeded[access.m_Resource];
+		});
+
+		if (pass->m_IsCulled)
+		{
+			++m_Stats.m_CulledPassCount;
+			continue;
+		}
+
+		// Discarded contents are not needed from earlier passes, read or preserved ones are
+		for (const Access& access : pass->m_Accesses)
+			isNeeded[access.m_Resource] = !(access.m_IsWrite && access.m_Discard);
+	}
+}
+
+void GfxRenderGraph::ComputeTransientLifetimes()
+{
+	for (uint32_t passIndex{}; passIndex < m_Passes.size(); ++passIndex)
+	{
+		if (m_Passes[passIndex].m_IsCulled)
+			continue;
+
+		for (const Access& access : m_Passes[passIndex].m_Accesses)
+		{
+			const uint32_t transientIndex{ m_Resources[access.m_Resource].m_TransientIndex };
+			if (transientIndex == sk_InvalidIndex)
+				continue;
+
+			TransientImage& transient{ m_TransientDeclarations[transientIndex] };
+			transient.m_FirstPass = std::min(transient.m_FirstPass, passIndex);
+			transient.m_LastPass = passIndex;
+		}
+	}
+}
+
+void GfxRenderGraph::CreateTransientImages()
+{
+	const auto& gfxDevice{ m_pGraphicsAPI->GetGfxDevice() };
+	const auto& device{ gfxDevice->GetDevice() };
+
+	std::vector<VkMemoryRequirements> requirements(m_TransientImages.size());
+	std::vector<uint32_t> order{};
+	order.reserve(m_TransientImages.size());
+
+	m_Stats.m_TransientImageCount = 0;
+	m_Stats.m_TransientBytesRequested = 0;
+	m_Stats.m_TransientBytesAllocated = 0;
+
+	for (uint32_t i{}; i < m_TransientImages.size(); ++i)
+	{
+		// Only used by culled passes
+		if (m_TransientImages[i].m_FirstPass == sk_InvalidIndex)
+			continue;
+
+		const TransientImageDesc& desc{ m_TransientImages[i].m_Desc };
+		GfxImage& image{ m_TransientImages[i].m_Image };
+
+		image.m_VkUsageFlags = desc.m_Usage;
+		image.m_VkExtent = VkExtent3D{ desc.m_Extent.width, desc.m_Extent.height, 1 };
+		image.m_VkType = VK_IMAGE_TYPE_2D;
+		image.m_VkImageFormat = desc.m_Format;
+		image.m_IsDepthFormat = GfxImage::IsDepthFormat(desc.m_Format);
+		image.m_IsStencilFormat = GfxImage::IsStencilFormat(desc.m_Format);
+		image.m_pGraphicsAPI = m_pGraphicsAPI;
+
+		if (desc.m_DebugName)
+			snprintf(image.m_DebugName, sizeof(image.m_DebugName) - 1, "%s", desc.m_DebugName);
+
+		const VkImageCreateInfo createInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = desc.m_Format,
+			.extent = image.m_VkExtent,
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = desc.m_Usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		HandleVkResult(vkCreateImage(device, &createInfo, nullptr, &image.m_VkImage));
+		HandleVkResult(gfxDevice->SetVkObjectName(VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(image.m_VkImage), image.m_DebugName));
+
+		vkGetImageMemoryRequirements(device, image.m_VkImage, &requirements[i]);
+		order.emplace_back(i);
+
+		++m_Stats.m_TransientImageCount;
+		m_Stats.m_TransientBytesRequested += requirements[i].size;
+	}
+
+	// Largest first, each image joins the first slot of a compatible memory type whose images all live outside of its lifetime
+	std::ranges::sort(order, [&requirements](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+	std::vector<VkMemoryRequirements> slotRequirements{};
+	std::vector<std::vector<uint32_t>> slotImages{};
+
+	for (const uint32_t i : order)
+	{
+		const TransientImage& transient{ m_TransientImages[i] };
+		const auto overlaps = [this, &transient](uint32_t other)
+		{
+			return transient.m_FirstPass <= m_TransientImages[other].m_LastPass && m_TransientImages[other].m_FirstPass <= transient.m_LastPass;
+		};
+
+		uint32_t slot{};
+		while (slot < slotImages.size() && ((slotRequirements[slot].memoryTypeBits & requirements[i].memoryTypeBits) == 0 || std::ranges::any_of(slotImages[slot], overlaps)))
+			++slot;
+
+		if (slot == slotImages.size())
+		{
+			slotRequirements.emplace_back(requirements[i]);
+			slotImages.emplace_back();
+		}
+		else
+		{
+			VkMemoryRequirements& slotRequirement{ slotRequirements[slot] };
+			slotRequirement.size = std::max(slotRequirement.size, requirements[i].size);
+			slotRequirement.alignment = std::max(slotRequirement.alignment, requirements[i].alignment);
+			slotRequirement.memoryTypeBits &= requirements[i].memoryTypeBits;
+		}
+
+		slotImages[slot].emplace_back(i);
+		m_TransientImages[i].m_MemorySlot = slot;
+	}
+
+	GfxMemoryAllocator* pAllocator{ gfxDevice->GetMemoryAllocator() };
+	m_MemorySlots.resize(slotImages.size());
+
+	for (uint32_t slot{}; slot < slotImages.size(); ++slot)
+	{
+		// Alignments are powers of two, the largest one satisfies every image bound at the start of the slot
+		const GfxAllocation& allocation{ m_MemorySlots[slot].m_Allocation = pAllocator->Allocate(slotRequirements[slot], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false) };
+		m_Stats.m_TransientBytesAllocated += slotRequirements[slot].size;
+
+		for (const uint32_t i : slotImages[slot])
+		{
+			GfxImage& image{ m_TransientImages[i].m_Image };
+			HandleVkResult(vkBindImageMemory(device, image.m_VkImage, allocation.m_VkMemory, allocation.m_Offset));
+
+			const VkImageAspectFlags aspect{ image.m_IsDepthFormat ? VK_IMAGE_ASPECT_DEPTH_BIT : image.m_IsStencilFormat ? VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_COLOR_BIT };
+			image.m_ImageView = image.CreateImageView(VK_IMAGE_VIEW_TYPE_2D, image.m_VkImageFormat, aspect, 0, 1, 0, 1, {}, image.m_DebugName);
+		}
+	}
+}
+
+void GfxRenderGraph::ReleaseTransientImages()
+{
+	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
+
+	// Frames in flight may still be using them
+	for (const TransientImage& transient : m_TransientImages)
+	{
+		if (transient.m_Image.m_VkImage == VK_NULL_HANDLE)
+			continue;
+
+		m_pGraphicsAPI->AddDeferredTask(std::packaged_task<void()>([device = device, image = transient.m_Image.m_VkImage, imageView = transient.m_Image.m_ImageView]()
+		{
+			vkDestroyImageView(device, imageView, nullptr);
+			vkDestroyImage(device, image, nullptr);
+		}));
+	}
+
+	for (const MemorySlot& slot : m_MemorySlots)
+	{
+		m_pGraphicsAPI->AddDeferredTask(std::packaged_task<void()>([allocator = m_pGraphicsAPI->GetGfxDevice()->GetMemoryAllocator(), allocation = slot.m_Allocation]()
+		{
+			allocator->Free(allocation);
+		}));
+	}
+
+	m_TransientImages.clear();
+	m_MemorySlots.clear();
+}
+
+void GfxRenderGraph::AddBarrier(Resource& resource, const Access& access)
+{
+	ResourceState& state{ resource.m_State };
+	const StageAccess dst{ access.m_StageAccess };
+	const bool isLayoutChange{ resource.m_pImage && access.m_Layout != state.m_Layout };
+
+	bool isBarrierNeeded{};
+	StageAccess src{};
+
+	if (access.m_IsWrite || isLayoutChange)
+	{
+		// Waits on every access since the last write, reads included, and makes that write available
+		src = StageAccess{ state.m_SrcStage | state.m_ReadStages, state.m_SrcAccess };
+		isBarrierNeeded = isLayoutChange || src.m_Stage != VK_PIPELINE_STAGE_2_NONE;
+	}
+	else if (state.m_SrcStage != VK_PIPELINE_STAGE_2_NONE && ((dst.m_Stage & ~state.m_VisibleStages) != 0 || (dst.m_Access & ~state.m_VisibleAccess) != 0))
+	{
+		// Reads by stages an earlier barrier already covered share it
+		src = StageAccess{ state.m_SrcStage, state.m_SrcAccess };
+		isBarrierNeeded = true;
+	}
+
+	if (isBarrierNeeded)
+	{
+		if (resource.m_pImage)
+		{
+			m_ImageBarriers.emplace_back(VkImageMemoryBarrier2
+			{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+				.srcStageMask = src.m_Stage,
+				.srcAccessMask = src.m_Access,
+				.dstStageMask = dst.m_Stage,
+				.dstAccessMask = dst.m_Access,
+				.oldLayout = access.m_Discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.m_Layout,
+				.newLayout = access.m_Layout,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = resource.m_pImage->m_VkImage,
+				.subresourceRange = VkImageSubresourceRange{ resource.m_pImage->GetImageAspectFlags(), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+			});
+		}
+		else
+		{
+			m_BufferBarriers.emplace_back(VkBufferMemoryBarrier2
+			{
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+				.srcStageMask = src.m_Stage,
+				.srcAccessMask = src.m_Access,
+				.dstStageMask = dst.m_Stage,
+				.dstAccessMask = dst.m_Access,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.buffer = resource.m_VkBuffer,
+				.offset = 0,
+				.size = VK_WHOLE_SIZE,
+			});
+		}
+	}
+
+	if (access.m_IsWrite || isLayoutChange)
+	{
+		// A layout transition is a write made visible to the stages of the barrier, later readers chain on them
+		state.m_Layout = resource.m_pImage ? access.m_Layout : state.m_Layout;
+		state.m_SrcStage = dst.m_Stage;
+		state.m_SrcAccess = access.m_IsWrite ? dst.m_Access & sk_WriteAccessMask : VK_ACCESS_2_NONE;
+		state.m_ReadStages = access.m_IsWrite ? VK_PIPELINE_STAGE_2_NONE : dst.m_Stage;
+		state.m_VisibleStages = access.m_IsWrite ? VK_PIPELINE_STAGE_2_NONE : dst.m_Stage;
+		state.m_VisibleAccess = access.m_IsWrite ? VK_ACCESS_2_NONE : dst.m_Access;
+		return;
+	}
+
+	if (isBarrierNeeded)
+	{
+		state.m_VisibleStages |= dst.m_Stage;
+		state.m_VisibleAccess |= dst.m_Access;
+	}
+	state.m_ReadStages |= dst.m_Stage;
+}
+
+bool GfxRenderGraph::MatchesTransientImages() const
+{
+	return std::ranges::equal(m_TransientDeclarations, m_TransientImages, [](const TransientImage& a, const TransientImage& b)
+	{
+		return a.m_Desc.m_Format == b.m_Desc.m_Format && a.m_Desc.m_Extent.width == b.m_Desc.m_Extent.width && a.m_Desc.m_Extent.height == b.m_Desc.m_Extent.height
+			&& a.m_Desc.m_Usage == b.m_Desc.m_Usage && a.m_FirstPass == b.m_FirstPass && a.m_LastPass == b.m_LastPass;
+	});
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,175 @@
+#ifndef GFXRENDERGRAPH_H
+#define GFXRENDERGRAPH_H
+
+#include <functional>
+
+#include "GfxStructs.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GfxCommandBuffer;
+class GraphicsAPI;
+
+struct GfxRenderGraphStats final
+{
+	uint32_t m_PassCount{};
+	uint32_t m_CulledPassCount{};
+	uint32_t m_BarrierCount{};
+	uint32_t m_BarrierBatchCount{};
+	uint32_t m_TransientImageCount{};
+	VkDeviceSize m_TransientBytesRequested{};
+	VkDeviceSize m_TransientBytesAllocated{}; // after aliasing
+};
+
+// Passes declare the resources they read and write, in recording order. On execution, the passes nothing depends on are culled,
+// each remaining pass gets one batched barrier covering its hazards, and transient images with disjoint lifetimes share memory
+class GfxRenderGraph final
+{
+public:
+	using ResourceID = uint32_t;
+	// Non const, passes bind pipelines and push constants through the command buffer
+	using ExecuteCallback = std::function<void(GfxCommandBuffer&)>;
+
+	struct TransientImageDesc final
+	{
+		VkFormat m_Format{ VK_FORMAT_UNDEFINED };
+		VkExtent2D m_Extent{};
+		VkImageUsageFlags m_Usage{};
+		const char* m_DebugName{};
+	};
+
+	class PassBuilder final
+	{
+	public:
+		// Buffers
+		PassBuilder& Read(ResourceID resource, StageAccess stageAccess);
+		PassBuilder& Write(ResourceID resource, StageAccess stageAccess);
+		// Images, the stages and accesses default to the ones of the layout
+		PassBuilder& Read(ResourceID resource, VkImageLayout layout, StageAccess stageAccess = {});
+		// Discarding drops the previous contents instead of preserving them, for attachments cleared on load
+		PassBuilder& Write(ResourceID resource, VkImageLayout layout, bool discard = false, StageAccess stageAccess = {});
+		// Never culled, for passes whose results leave the graph: presentation, or data read by the next frame
+		PassBuilder& SideEffect();
+
+	private:
+		friend class GfxRenderGraph;
+		explicit PassBuilder(GfxRenderGraph* pGraph, uint32_t passIndex);
+
+		GfxRenderGraph* m_pGraph;
+		uint32_t m_PassIndex;
+	};
+
+	explicit GfxRenderGraph(GraphicsAPI* pGraphicsAPI);
+	~GfxRenderGraph();
+
+	GfxRenderGraph(const GfxRenderGraph&) noexcept = delete;
+	GfxRenderGraph& operator=(const GfxRenderGraph&) noexcept = delete;
+	GfxRenderGraph(GfxRenderGraph&&) noexcept = delete;
+	GfxRenderGraph& operator=(GfxRenderGraph&&) noexcept = delete;
+
+	// The image's state is taken from its m_CurrentVkImageLayout, and written back once the graph has executed
+	[[nodiscard]] ResourceID ImportImage(GfxImage* pImage);
+	// Accesses from before the graph must have been made visible by the caller, host writes are by the submission
+	[[nodiscard]] ResourceID ImportBuffer(VkBuffer vkBuffer);
+	// 2D, single level, only valid during execution and undefined until the first pass writing it
+	[[nodiscard]] ResourceID CreateTransientImage(const TransientImageDesc& desc);
+	// Transient images are only backed inside the pass callbacks
+	[[nodiscard]] GfxImage* GetImage(ResourceID resource) const;
+
+	PassBuilder AddPass(const char* name, ExecuteCallback&& execute);
+
+	// Records the surviving passes in declaration order, then clears the graph for the next frame
+	void Execute(GfxCommandBuffer& cmdBuffer);
+
+	[[nodiscard]] GfxRenderGraphStats GetStats() const;
+
+private:
+	// Synchronization state of a resource between two passes
+	struct ResourceState final
+	{
+		VkImageLayout m_Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags2 m_SrcStage{ VK_PIPELINE_STAGE_2_NONE }; // last write or layout transition
+		VkAccessFlags2 m_SrcAccess{ VK_ACCESS_2_NONE }; // writes still to be made available
+		VkPipelineStageFlags2 m_ReadStages{ VK_PIPELINE_STAGE_2_NONE }; // reads since then, later writes wait on them
+		VkPipelineStageFlags2 m_VisibleStages{ VK_PIPELINE_STAGE_2_NONE };
+		VkAccessFlags2 m_VisibleAccess{ VK_ACCESS_2_NONE };
+	};
+
+	struct Resource final
+	{
+		GfxImage* m_pImage{};
+		VkBuffer m_VkBuffer{ VK_NULL_HANDLE };
+		uint32_t m_TransientIndex{ sk_InvalidIndex };
+		ResourceState m_State{};
+	};
+
+	struct Access final
+	{
+		ResourceID m_Resource{};
+		StageAccess m_StageAccess{};
+		VkImageLayout m_Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		bool m_IsWrite{};
+		bool m_Discard{};
+	};
+
+	struct Pass final
+	{
+		const char* m_Name{};
+		ExecuteCallback m_Execute{};
+		std::vector<Access> m_Accesses{};
+		bool m_HasSideEffect{};
+		bool m_IsCulled{};
+	};
+
+	struct TransientImage final
+	{
+		TransientImageDesc m_Desc{};
+		uint32_t m_FirstPass{ sk_InvalidIndex };
+		uint32_t m_LastPass{};
+		uint32_t m_MemorySlot{};
+		GfxImage m_Image{};
+	};
+
+	// Memory shared by transient images whose lifetimes do not overlap
+	struct MemorySlot final
+	{
+		GfxAllocation m_Allocation{};
+		// Left by the last image using the memory, the next one waits on it before discarding the contents
+		ResourceState m_State{};
+	};
+
+	static constexpr uint32_t sk_InvalidIndex{ std::numeric_limits<uint32_t>::max() };
+	static constexpr VkAccessFlags2 sk_WriteAccessMask
+	{
+		VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT
+	};
+
+	GraphicsAPI* m_pGraphicsAPI;
+
+	std::vector<Pass> m_Passes{};
+	std::vector<Resource> m_Resources{};
+	// Declared this frame, compared against the backed ones to decide whether they can be reused as is
+	std::vector<TransientImage> m_TransientDeclarations{};
+	std::vector<TransientImage> m_TransientImages{};
+	std::vector<MemorySlot> m_MemorySlots{};
+
+	std::vector<VkImageMemoryBarrier2> m_ImageBarriers{};
+	std::vector<VkBufferMemoryBarrier2> m_BufferBarriers{};
+	GfxRenderGraphStats m_Stats{};
+
+	void AddAccess(uint32_t passIndex, const Access& access);
+	void CullPasses();
+	void ComputeTransientLifetimes();
+	void CreateTransientImages();
+	void ReleaseTransientImages();
+	void AddBarrier(Resource& resource, const Access& access);
+
+	[[nodiscard]] bool MatchesTransientImages() const;
+};
+
+#endif
+
+#endif //GFXRENDERGRAPH_H
\ No newline at end of file
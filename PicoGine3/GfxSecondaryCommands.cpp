@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "GfxSecondaryCommands.h"
+
+#include "GfxDevice.h"
+#include "GfxSwapchain.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxSecondaryCommands::GfxSecondaryCommands(GfxDevice* pDevice, GfxImmediateCommands* pImmediateCommands, uint32_t slotCount, const char* debugName) :
+	m_pDevice{ pDevice },
+	m_pImmediateCommands{ pImmediateCommands },
+	m_SlotCount{ slotCount },
+	m_DebugName{ debugName }
+{
+	const auto& device{ m_pDevice->GetDevice() };
+
+	// Buffers are only ever reset with their whole pool
+	const VkCommandPoolCreateInfo poolCreateInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = m_pImmediateCommands->GetQueueFamilyIndex(),
+	};
+
+	m_Pools.resize(static_cast<size_t>(GfxSwapchain::sk_MaxFramesInFlight) * m_SlotCount);
+	m_FrameSubmitHandles.resize(GfxSwapchain::sk_MaxFramesInFlight);
+
+	for (size_t i{}; i < m_Pools.size(); ++i)
+	{
+		HandleVkResult(vkCreateCommandPool(device, &poolCreateInfo, nullptr, &m_Pools[i].m_VkCommandPool));
+
+		if (m_DebugName)
+		{
+			char poolName[256]{ 0 };
+			snprintf(poolName, sizeof(poolName) - 1, "Command Pool: %s (Frame %zu, Slot %zu)", m_DebugName, i / m_SlotCount, i % m_SlotCount);
+			HandleVkResult(m_pDevice->SetVkObjectName(VK_OBJECT_TYPE_COMMAND_POOL, reinterpret_cast<uint64_t>(m_Pools[i].m_VkCommandPool), poolName));
+		}
+	}
+}
+
+GfxSecondaryCommands::~GfxSecondaryCommands()
+{
+	const auto& device{ m_pDevice->GetDevice() };
+
+	// The owner waits for the device to be idle first, destroying a pool frees its command buffers
+	for (const SlotPool& pool : m_Pools)
+		vkDestroyCommandPool(device, pool.m_VkCommandPool, nullptr);
+}
+
+void GfxSecondaryCommands::BeginFrame(uint32_t frameIndex)
+{
+	PROFILE_FUNCTION();
+
+	m_FrameIndex = frameIndex;
+
+	SubmitHandle& submitHandle{ m_FrameSubmitHandles[m_FrameIndex] };
+	if (!submitHandle.Empty())
+		m_pImmediateCommands->Wait(submitHandle);
+
+	submitHandle = SubmitHandle{};
+
+	const auto& device{ m_pDevice->GetDevice() };
+	for (uint32_t slot{}; slot < m_SlotCount; ++slot)
+	{
+		SlotPool& pool{ m_Pools[m_FrameIndex * m_SlotCount + slot] };
+		if (pool.m_UsedCount == 0)
+			continue;
+
+		HandleVkResult(vkResetCommandPool(device, pool.m_VkCommandPool, 0));
+		pool.m_UsedCount = 0;
+	}
+}
+
+void GfxSecondaryCommands::SetFrameSubmitHandle(SubmitHandle handle)
+{
+	m_FrameSubmitHandles[m_FrameIndex] = handle;
+}
+
+VkCommandBuffer GfxSecondaryCommands::Begin(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+	assert(slot < m_SlotCount && L"Secondary command buffer slot out of range.");
+
+	SlotPool& pool{ m_Pools[m_FrameIndex * m_SlotCount + slot] };
+
+	if (pool.m_UsedCount == pool.m_CmdBuffers.size())
+	{
+		const VkCommandBufferAllocateInfo bufferAllocInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = pool.m_VkCommandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1,
+		};
+
+		HandleVkResult(vkAllocateCommandBuffers(m_pDevice->GetDevice(), &bufferAllocInfo, &pool.m_CmdBuffers.emplace_back()));
+	}
+
+	const VkCommandBuffer cmdBuffer{ pool.m_CmdBuffers[pool.m_UsedCount++] };
+
+	const VkCommandBufferBeginInfo beginInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritanceInfo,
+	};
+
+	HandleVkResult(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+
+	return cmdBuffer;
+}
+
+uint32_t GfxSecondaryCommands::GetSlotCount() const
+{
+	return m_SlotCount;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef GFXSECONDARYCOMMANDS_H
+#define GFXSECONDARYCOMMANDS_H
+
+#include "GfxImmediateCommands.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GfxDevice;
+
+// Secondary command buffers recorded from several threads and executed by the frame's primary command buffer.
+// Every recording slot has its own pool per frame in flight, a slot must only be used by one thread at a time.
+class GfxSecondaryCommands final
+{
+public:
+	explicit GfxSecondaryCommands(GfxDevice* pDevice, GfxImmediateCommands* pImmediateCommands, uint32_t slotCount, const char* debugName = nullptr);
+	~GfxSecondaryCommands();
+
+	GfxSecondaryCommands(const GfxSecondaryCommands&) noexcept = delete;
+	GfxSecondaryCommands& operator=(const GfxSecondaryCommands&) noexcept = delete;
+	GfxSecondaryCommands(GfxSecondaryCommands&&) noexcept = delete;
+	GfxSecondaryCommands& operator=(GfxSecondaryCommands&&) noexcept = delete;
+
+	// Waits for the last submit of the frame's buffers, then resets the frame's pools
+	void BeginFrame(uint32_t frameIndex);
+	// Submit of the primary command buffer executing this frame's buffers
+	void SetFrameSubmitHandle(SubmitHandle handle);
+
+	// Begun for use inside the inherited render pass, ended by the caller
+	[[nodiscard]] VkCommandBuffer Begin(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritanceInfo);
+
+	[[nodiscard]] uint32_t GetSlotCount() const;
+
+private:
+	struct SlotPool final
+	{
+		VkCommandPool m_VkCommandPool{ VK_NULL_HANDLE };
+		std::vector<VkCommandBuffer> m_CmdBuffers{};
+		uint32_t m_UsedCount{};
+	};
+
+	GfxDevice* m_pDevice;
+	GfxImmediateCommands* m_pImmediateCommands;
+	uint32_t m_SlotCount;
+	const char* m_DebugName;
+
+	// Frame major, slot minor
+	std::vector<SlotPool> m_Pools{};
+	std::vector<SubmitHandle> m_FrameSubmitHandles{};
+	uint32_t m_FrameIndex{};
+};
+
+#endif
+
+#endif //GFXSECONDARYCOMMANDS_H
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "GfxStagingRing.h"
+
+#include "GfxMemoryAllocator.h"
+#include "GraphicsAPI.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxStagingRing::GfxStagingRing(GraphicsAPI* pGraphicsAPI, GfxImmediateCommands* pImmediateCommands, VkDeviceSize size) :
+	m_pGraphicsAPI{ pGraphicsAPI },
+	m_pImmediateCommands{ pImmediateCommands },
+	m_Size{ size }
+{
+	const GfxDevice* pDevice{ m_pGraphicsAPI->GetGfxDevice() };
+
+	pDevice->CreateBuffer(m_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_VkBuffer, m_Allocation);
+	HandleVkResult(pDevice->SetVkObjectName(VK_OBJECT_TYPE_BUFFER, reinterpret_cast<uint64_t>(m_VkBuffer), "Buffer: staging ring"));
+
+	assert(m_Allocation.m_pMappedPtr && m_Allocation.m_IsCoherent && L"Staging ring memory must be host visible and coherent.");
+}
+
+GfxStagingRing::~GfxStagingRing()
+{
+	for (const OversizeBuffer& buffer : m_OversizeBuffers)
+		DestroyOversizeBuffer(buffer);
+
+	vkDestroyBuffer(m_pGraphicsAPI->GetGfxDevice()->GetDevice(), m_VkBuffer, nullptr);
+	m_pGraphicsAPI->GetGfxDevice()->GetMemoryAllocator()->Free(m_Allocation);
+}
+
+StagingRegion GfxStagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	PROFILE_FUNCTION();
+
+	if (size > m_Size / 2)
+		return AllocateOversize(size);
+
+	const SubmitHandle currentHandle{ m_pImmediateCommands->GetNextSubmitHandle() };
+
+	Reclaim();
+
+	VkDeviceSize offset{};
+	while (!TryAllocate(size, alignment, offset))
+	{
+		// Everything left belongs to the command buffer being recorded, waiting would never return
+		if (m_InFlightRanges.front().m_SubmitHandle.Handle() == currentHandle.Handle())
+			return AllocateOversize(size);
+
+		m_pImmediateCommands->Wait(m_InFlightRanges.front().m_SubmitHandle);
+		Reclaim();
+	}
+
+	// Consecutive uploads recorded into the same command buffer share one range
+	if (!m_InFlightRanges.empty() && m_InFlightRanges.back().m_SubmitHandle.Handle() == currentHandle.Handle() && m_InFlightRanges.back().m_End <= offset)
+		m_InFlightRanges.back().m_End = offset + size;
+	else
+		m_InFlightRanges.emplace_back(InFlightRange{ offset, offset + size, currentHandle });
+
+	m_Head = offset + size;
+
+	return StagingRegion{
+		.m_VkBuffer = m_VkBuffer,
+		.m_Offset = offset,
+		.m_Size = size,
+		.m_pMappedPtr = static_cast<uint8_t*>(m_Allocation.m_pMappedPtr) + offset,
+	};
+}
+
+StagingRegion GfxStagingRing::Upload(const void* pData, VkDeviceSize size, VkDeviceSize alignment)
+{
+	const StagingRegion region{ Allocate(size, alignment) };
+	memcpy(region.m_pMappedPtr, pData, size);
+	return region;
+}
+
+void GfxStagingRing::Reclaim()
+{
+	while (!m_InFlightRanges.empty() && m_pImmediateCommands->IsReady(m_InFlightRanges.front().m_SubmitHandle))
+		m_InFlightRanges.pop_front();
+
+	while (!m_OversizeBuffers.empty() && m_pImmediateCommands->IsReady(m_OversizeBuffers.front().m_SubmitHandle))
+	{
+		DestroyOversizeBuffer(m_OversizeBuffers.front());
+		m_OversizeBuffers.pop_front();
+	}
+
+	if (m_InFlightRanges.empty())
+		m_Head = 0;
+}
+
+bool GfxStagingRing::TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) const
+{
+	const VkDeviceSize alignedHead{ (m_Head + alignment - 1) & ~(alignment - 1) };
+
+	if (m_InFlightRanges.empty())
+	{
+		offset = alignedHead + size <= m_Size ? alignedHead : 0;
+		return true;
+	}
+
+	const VkDeviceSize tail{ m_InFlightRanges.front().m_Begin };
+
+	// Head is ahead of the oldest range: use the end of the buffer, then wrap around to the start
+	if (m_Head > tail)
+	{
+		if (alignedHead + size <= m_Size)
+		{
+			offset = alignedHead;
+			return true;
+		}
+
+		offset = 0;
+		return size < tail;
+	}
+
+	// Head has wrapped, free space is between the head and the oldest range
+	offset = alignedHead;
+	return alignedHead + size < tail;
+}
+
+StagingRegion GfxStagingRing::AllocateOversize(VkDeviceSize size)
+{
+	const GfxDevice* pDevice{ m_pGraphicsAPI->GetGfxDevice() };
+
+	// Released with the command buffer currently being recorded
+	OversizeBuffer& buffer{ m_OversizeBuffers.emplace_back() };
+	buffer.m_SubmitHandle = m_pImmediateCommands->GetNextSubmitHandle();
+
+	pDevice->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer.m_VkBuffer, buffer.m_Allocation);
+	HandleVkResult(pDevice->SetVkObjectName(VK_OBJECT_TYPE_BUFFER, reinterpret_cast<uint64_t>(buffer.m_VkBuffer), "Buffer: oversize staging"));
+
+	return StagingRegion{
+		.m_VkBuffer = buffer.m_VkBuffer,
+		.m_Offset = 0,
+		.m_Size = size,
+		.m_pMappedPtr = static_cast<uint8_t*>(buffer.m_Allocation.m_pMappedPtr),
+	};
+}
+
+void GfxStagingRing::DestroyOversizeBuffer(const OversizeBuffer& buffer) const
+{
+	const GfxDevice* pDevice{ m_pGraphicsAPI->GetGfxDevice() };
+
+	vkDestroyBuffer(pDevice->GetDevice(), buffer.m_VkBuffer, nullptr);
+	pDevice->GetMemoryAllocator()->Free(buffer.m_Allocation);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef GFXSTAGINGRING_H
+#define GFXSTAGINGRING_H
+
+#include "GfxImmediateCommands.h"
+#include "GfxStructs.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GraphicsAPI;
+
+struct StagingRegion final
+{
+	VkBuffer m_VkBuffer{ VK_NULL_HANDLE };
+	VkDeviceSize m_Offset{};
+	VkDeviceSize m_Size{};
+	uint8_t* m_pMappedPtr{};
+};
+
+// Persistently mapped upload ring, regions are reclaimed once the submit that consumed them has retired on pImmediateCommands' queue
+class GfxStagingRing final
+{
+public:
+	explicit GfxStagingRing(GraphicsAPI* pGraphicsAPI, GfxImmediateCommands* pImmediateCommands, VkDeviceSize size = sk_DefaultSize);
+	~GfxStagingRing();
+
+	GfxStagingRing(const GfxStagingRing&) noexcept = delete;
+	GfxStagingRing& operator=(const GfxStagingRing&) noexcept = delete;
+	GfxStagingRing(GfxStagingRing&&) noexcept = delete;
+	GfxStagingRing& operator=(GfxStagingRing&&) noexcept = delete;
+
+	// The region belongs to the command buffer currently being recorded and must only be used by it
+	[[nodiscard]] StagingRegion Allocate(VkDeviceSize size, VkDeviceSize alignment = sk_DefaultAlignment);
+	[[nodiscard]] StagingRegion Upload(const void* pData, VkDeviceSize size, VkDeviceSize alignment = sk_DefaultAlignment);
+
+private:
+	struct InFlightRange final
+	{
+		VkDeviceSize m_Begin{};
+		VkDeviceSize m_End{};
+		SubmitHandle m_SubmitHandle{};
+	};
+
+	struct OversizeBuffer final
+	{
+		VkBuffer m_VkBuffer{ VK_NULL_HANDLE };
+		GfxAllocation m_Allocation{};
+		SubmitHandle m_SubmitHandle{};
+	};
+
+	static constexpr VkDeviceSize sk_DefaultSize{ VkDeviceSize{ 32 } << 20 };
+	static constexpr VkDeviceSize sk_DefaultAlignment{ 16 };
+
+	GraphicsAPI* m_pGraphicsAPI;
+	GfxImmediateCommands* m_pImmediateCommands;
+	VkBuffer m_VkBuffer{ VK_NULL_HANDLE };
+	GfxAllocation m_Allocation{};
+	VkDeviceSize m_Size{};
+	VkDeviceSize m_Head{};
+	std::deque<InFlightRange> m_InFlightRanges{};
+	std::deque<OversizeBuffer> m_OversizeBuffers{};
+
+	void Reclaim();
+	[[nodiscard]] bool TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) const;
+	[[nodiscard]] StagingRegion AllocateOversize(VkDeviceSize size);
+	void DestroyOversizeBuffer(const OversizeBuffer& buffer) const;
+};
+
+#endif
+
+#endif //GFXSTAGINGRING_H
\ No newline at end of file
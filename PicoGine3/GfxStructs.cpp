@@ -1,10 +1,25 @@
 #include "pch.h"
 #include "GfxStructs.h"
 
+#include "GfxMemoryAllocator.h"
 #include "GraphicsAPI.h"
 
 #pragma region GfxBuffer
 
+VkMappedMemoryRange GfxBuffer::GetMappedMemoryRange(VkDeviceSize offset, VkDeviceSize size, VkDeviceSize atomSize) const
+{
+	// The buffer lives somewhere inside a shared block, ranges are relative to the block and must be aligned to nonCoherentAtomSize
+	const VkDeviceSize begin{ (m_Allocation.m_Offset + offset) / atomSize * atomSize };
+	const VkDeviceSize end{ std::min((m_Allocation.m_Offset + offset + size + atomSize - 1) / atomSize * atomSize, m_Allocation.m_Offset + m_Allocation.m_Size) };
+
+	return VkMappedMemoryRange{
+		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		.memory = m_Allocation.m_VkMemory,
+		.offset = begin,
+		.size = end - begin,
+	};
+}
+
 uint8_t* GfxBuffer::GetMappedPtr() const
 {
 	return static_cast<uint8_t*>(m_pMappedPtr);
@@ -54,19 +69,9 @@ void GfxBuffer::FlushMappedMemory(VkDeviceSize offset, VkDeviceSize size) const
 	if (!m_pMappedPtr)
 		return;
 
-	/*if (VULKAN_USE_VMA)
-		vmaFlushAllocation((VmaAllocator)ctx.getVmaAllocator(), vmaAllocation_, offset, size);
-	
-	else
-	{*/
-		const VkMappedMemoryRange range{
-			.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-			.memory = m_VkMemory,
-			.offset = offset,
-			.size = size,
-		};
-		vkFlushMappedMemoryRanges(m_pGraphicsAPI->GetGfxDevice()->GetDevice(), 1, &range);
-	//}
+	const auto& gfxDevice{ m_pGraphicsAPI->GetGfxDevice() };
+	const VkMappedMemoryRange range{ GetMappedMemoryRange(offset, size, gfxDevice->GetMemoryAllocator()->GetNonCoherentAtomSize()) };
+	vkFlushMappedMemoryRanges(gfxDevice->GetDevice(), 1, &range);
 }
 
 void GfxBuffer::InvalidateMappedMemory(VkDeviceSize offset, VkDeviceSize size) const
@@ -74,19 +79,9 @@ void GfxBuffer::InvalidateMappedMemory(VkDeviceSize offset, VkDeviceSize size) c
 	if (!m_pMappedPtr)
 		return;
 
-	/*if (VULKAN_USE_VMA)
-		vmaInvalidateAllocation(static_cast<VmaAllocator>(ctx.GetVmaAllocator()), vmaAllocation_, offset, size);
-	
-	else
-	{*/
-		const VkMappedMemoryRange range{
-			.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-			.memory = m_VkMemory,
-			.offset = offset,
-			.size = size,
-		};
-		vkInvalidateMappedMemoryRanges(m_pGraphicsAPI->GetGfxDevice()->GetDevice(), 1, &range);
-	//}
+	const auto& gfxDevice{ m_pGraphicsAPI->GetGfxDevice() };
+	const VkMappedMemoryRange range{ GetMappedMemoryRange(offset, size, gfxDevice->GetMemoryAllocator()->GetNonCoherentAtomSize()) };
+	vkInvalidateMappedMemoryRanges(gfxDevice->GetDevice(), 1, &range);
 }
 
 #pragma endregion
@@ -140,6 +135,12 @@ StageAccess GfxImage::GetPipelineStageAccess(VkImageLayout layout)
 			.m_Stage = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
 			.m_Access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
 		};
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		return StageAccess
+		{
+			.m_Stage = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.m_Access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT,
+		};
 	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
 		return StageAccess
 		{
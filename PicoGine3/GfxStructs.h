@@ -1,6 +1,8 @@
 #ifndef GFXSTRUCTS_H
 #define GFXSTRUCTS_H
 
+#include "Pool.h"
+
 class GraphicsAPI;
 struct GfxBuffer;
 struct GfxImage;
@@ -480,6 +482,29 @@ inline VkFormat FormatToVkFormat(Format format)
 
 #pragma endregion
 
+#pragma region GfxAllocation
+
+// Range of device memory handed out by GfxMemoryAllocator, either a sub-allocation of a shared block or a dedicated allocation
+struct GfxAllocation final
+{
+	static constexpr uint32_t sk_Dedicated{ 0xFFFFFFFF };
+
+	VkDeviceMemory m_VkMemory{ VK_NULL_HANDLE };
+	VkDeviceSize m_Offset{};
+	VkDeviceSize m_Size{};
+	void* m_pMappedPtr{}; // already offset, null unless the memory is host visible
+	uint32_t m_MemoryTypeIndex{};
+	uint32_t m_BlockIndex{ sk_Dedicated };
+	uint32_t m_NodeIndex{};
+	bool m_IsLinear{};
+	bool m_IsCoherent{};
+
+	[[nodiscard]] bool IsValid() const { return m_VkMemory != VK_NULL_HANDLE; }
+	[[nodiscard]] bool IsDedicated() const { return m_BlockIndex == sk_Dedicated; }
+};
+
+#pragma endregion
+
 #pragma region GfxBuffer
 
 struct BufferDesc final
@@ -489,6 +514,7 @@ struct BufferDesc final
 	size_t m_Size{ 0 };
 	const void* m_Data{ nullptr };
 	const char* m_DebugName{ nullptr };
+	bool m_IsSharedWithAsyncCompute{ false }; // Concurrent between the graphics and async compute families, no ownership transfers
 };
 
 struct GfxBuffer final
@@ -508,9 +534,10 @@ struct GfxBuffer final
 	void GetBufferData(size_t offset, size_t size, void* data) const;
 	void FlushMappedMemory(VkDeviceSize offset, VkDeviceSize size) const;
 	void InvalidateMappedMemory(VkDeviceSize offset, VkDeviceSize size) const;
+	[[nodiscard]] VkMappedMemoryRange GetMappedMemoryRange(VkDeviceSize offset, VkDeviceSize size, VkDeviceSize atomSize) const;
 
 	VkBuffer m_VkBuffer{ VK_NULL_HANDLE };
-	VkDeviceMemory m_VkMemory{ VK_NULL_HANDLE };
+	GfxAllocation m_Allocation{};
 	//VmaAllocation m_VmaAllocation{ VK_NULL_HANDLE };
 	VkDeviceAddress m_VkDeviceAddress{};
 	VkDeviceSize m_BufferSize{};
@@ -603,7 +630,7 @@ struct GfxImage final
 
 	VkImage m_VkImage{ VK_NULL_HANDLE };
 	VkImageUsageFlags m_VkUsageFlags{};
-	VkDeviceMemory m_VkMemory{ VK_NULL_HANDLE };
+	GfxAllocation m_Allocation{};
 	//VmaAllocation m_VmaAllocation{ VK_NULL_HANDLE };
 	VkFormatProperties m_VkFormatProperties{};
 	VkExtent3D m_VkExtent{ 0, 0, 0 };
@@ -631,4 +658,47 @@ struct GfxImage final
 
 #pragma endregion
 
+#pragma region GfxQueryPool
+
+struct QueryPoolDesc final
+{
+	uint32_t m_NumQueries{ 0 };
+	const char* m_DebugName{ nullptr };
+};
+
+// Timestamp queries only for now
+struct GfxQueryPool final
+{
+	VkQueryPool m_VkQueryPool{ VK_NULL_HANDLE };
+	uint32_t m_NumQueries{};
+};
+
+using QueryPoolHandle = Handle<GfxQueryPool>;
+
+#pragma endregion
+
+#pragma region GfxComputePipeline
+
+struct ComputePipelineDesc final
+{
+	static constexpr uint32_t sk_MaxSetLayouts{ 4 };
+	const wchar_t* m_ShaderPath{ nullptr };
+	const char* m_EntryPoint{ "CSMain" };
+	VkDescriptorSetLayout m_SetLayouts[sk_MaxSetLayouts]{};
+	uint32_t m_NumSetLayouts{ 0 };
+	uint32_t m_PushConstantsSize{ 0 };
+	const char* m_DebugName{ nullptr };
+};
+
+struct GfxComputePipeline final
+{
+	VkPipeline m_VkPipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout m_VkPipelineLayout{ VK_NULL_HANDLE };
+	uint32_t m_PushConstantsSize{};
+};
+
+using ComputePipelineHandle = Handle<GfxComputePipeline>;
+
+#pragma endregion
+
 #endif //GFXSTRUCTS_H
\ No newline at end of file
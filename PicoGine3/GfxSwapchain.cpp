@@ -3,6 +3,7 @@
 
 #include <format>
 
+#include "GfxMemoryAllocator.h"
 #include "GraphicsAPI.h"
 #include "Settings.h"
 #include "WindowManager.h"
@@ -12,11 +13,14 @@
 #elif defined(_VK)
 
 GfxSwapchain::GfxSwapchain(GraphicsAPI* pGraphicsAPI) :
-	m_pGraphicsAPI{ pGraphicsAPI }
+	m_pGraphicsAPI{ pGraphicsAPI },
+	m_IsHeadless{ pGraphicsAPI->GetGfxDevice()->IsHeadless() },
+	m_IsDepthSampled{ Settings::Get().IsGpuDrivenEnabled() && Settings::Get().IsOcclusionCullingEnabled() }
 {
 	CreateSwapchain();
 	CreateDepthResources();
-	CreateRenderPass();
+	CreateRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, m_VkRenderPass);
+	CreateRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD, m_VkLoadRenderPass);
 	CreateFrameBuffers();
 	CreateSyncObjects();
 }
@@ -29,9 +33,12 @@ GfxSwapchain::~GfxSwapchain()
 		vkDestroySemaphore(device, m_AcquireSemaphores[i], nullptr);
 
 	vkDestroyRenderPass(device, m_VkRenderPass, nullptr);
+	vkDestroyRenderPass(device, m_VkLoadRenderPass, nullptr);
 
 	CleanupSwapchain();
-	vkDestroySwapchainKHR(device, m_VkSwapChain, nullptr);
+
+	if (m_VkSwapChain != VK_NULL_HANDLE)
+		vkDestroySwapchainKHR(device, m_VkSwapChain, nullptr);
 }
 
 VkFramebuffer GfxSwapchain::GetCurrentFrameBuffer() const
@@ -44,6 +51,16 @@ VkRenderPass GfxSwapchain::GetRenderPass() const
 	return m_VkRenderPass;
 }
 
+VkRenderPass GfxSwapchain::GetLoadRenderPass() const
+{
+	return m_VkLoadRenderPass;
+}
+
+GfxImage* GfxSwapchain::GetCurrentDepthImage()
+{
+	return &m_DepthImages[m_CurrentFrameSwapchainImageIndex];
+}
+
 VkImageView GfxSwapchain::GetImageView(int index) const
 {
 	assert(index >= 0 && index < m_SwapChainImages.size() && L"Invalid swap chain image view index.");
@@ -85,9 +102,21 @@ uint64_t GfxSwapchain::GetCurrentFrameIndex() const
 	return m_CurrentFrame;
 }
 
+bool GfxSwapchain::IsHeadless() const
+{
+	return m_IsHeadless;
+}
+
+VkImageLayout GfxSwapchain::GetPresentLayout() const
+{
+	// PRESENT_SRC_KHR is only valid with VK_KHR_swapchain, headless targets are left ready for readback instead
+	return m_IsHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
 VkFormat GfxSwapchain::FindDepthFormat() const
 {
-	return m_pGraphicsAPI->GetGfxDevice()->FindSupportedFormat({ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	const VkFormatFeatureFlags features{ m_IsDepthSampled ? VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT };
+	return m_pGraphicsAPI->GetGfxDevice()->FindSupportedFormat({ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT }, VK_IMAGE_TILING_OPTIMAL, features);
 }
 
 void GfxSwapchain::SetCurrentFrameTimelineWaitValue(uint64_t value)
@@ -97,6 +126,14 @@ void GfxSwapchain::SetCurrentFrameTimelineWaitValue(uint64_t value)
 
 VkResult GfxSwapchain::Present(VkSemaphore semaphore)
 {
+	if (m_IsHeadless)
+	{
+		m_GetNextImage = true;
+		++m_CurrentFrame;
+
+		return VK_SUCCESS;
+	}
+
 	const auto& deviceQueueInfo{ m_pGraphicsAPI->GetGfxDevice()->GetDeviceQueueInfo() };
 
 	const VkPresentInfoKHR presentInfo
@@ -133,10 +170,16 @@ void GfxSwapchain::RecreateSwapchain()
 
 GfxImage* GfxSwapchain::AcquireImage()
 {
+	PROFILE_FUNCTION();
+
 	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
 
 	if (m_GetNextImage)
 	{
+		// Offscreen targets are simply cycled through, the timeline wait below keeps them from being overwritten in flight
+		if (m_IsHeadless)
+			m_CurrentFrameSwapchainImageIndex = static_cast<uint32_t>(m_CurrentFrame % m_SwapChainImages.size());
+
 		const auto timelineSemaphore{ m_pGraphicsAPI->GetTimelineSemaphore() };
 
 		const VkSemaphoreWaitInfo waitInfo
@@ -149,6 +192,12 @@ GfxImage* GfxSwapchain::AcquireImage()
 
 		HandleVkResult(vkWaitSemaphores(device, &waitInfo, UINT64_MAX));
 
+		if (m_IsHeadless)
+		{
+			m_GetNextImage = false;
+			return &m_SwapChainImages[m_CurrentFrameSwapchainImageIndex];
+		}
+
 		const VkSemaphore acquireSemaphore{ m_AcquireSemaphores[m_CurrentFrameSwapchainImageIndex] };
 
 		const VkResult result{ vkAcquireNextImageKHR(device, m_VkSwapChain, UINT64_MAX, acquireSemaphore, VK_NULL_HANDLE, &m_CurrentFrameSwapchainImageIndex) };
@@ -208,6 +257,12 @@ VkExtent2D GfxSwapchain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabi
 
 void GfxSwapchain::CreateSwapchain()
 {
+	if (m_IsHeadless)
+	{
+		CreateOffscreenTargets();
+		return;
+	}
+
 	const auto& gfxDevice{ m_pGraphicsAPI->GetGfxDevice() };
 	const auto& device{ gfxDevice->GetDevice() };
 	const auto& physicalDevice{ gfxDevice->GetPhysicalDevice() };
@@ -289,9 +344,8 @@ void GfxSwapchain::CreateSwapchain()
 		snprintf(debugNameImage, sizeof(debugNameImage) - 1, "Image: swapchain %u", i);
 		snprintf(debugNameImageView, sizeof(debugNameImageView) - 1, "Image View: swapchain %u", i);
 
-		m_SwapChainImages.emplace_back(m_pGraphicsAPI);
-		GfxImage& image{ m_SwapChainImages[i] };
-		
+		GfxImage& image{ m_SwapChainImages.emplace_back() };
+		image.m_pGraphicsAPI = m_pGraphicsAPI;
 		image.m_VkImage = swapchainImages[i];
 		image.m_VkUsageFlags = usageFlags;
 		image.m_VkExtent = VkExtent3D{ .width = m_VkSwapChainExtent.width, .height = m_VkSwapChainExtent.height, .depth = 1 };
@@ -306,6 +360,39 @@ void GfxSwapchain::CreateSwapchain()
 	}
 }
 
+void GfxSwapchain::CreateOffscreenTargets()
+{
+	const auto& gfxDevice{ m_pGraphicsAPI->GetGfxDevice() };
+	const auto& resolution{ Settings::Get().GetDesiredResolution() };
+
+	m_VkSwapChainColorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	m_VkSwapChainExtent = VkExtent2D{ static_cast<uint32_t>(resolution.x), static_cast<uint32_t>(resolution.y) };
+
+	constexpr VkImageUsageFlags usageFlags{ VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+
+	char debugNameImage[256]{};
+
+	m_SwapChainImages.reserve(sk_MaxFramesInFlight);
+
+	for (uint32_t i{}; i < sk_MaxFramesInFlight; ++i)
+	{
+		snprintf(debugNameImage, sizeof(debugNameImage) - 1, "Image: offscreen target %u", i);
+
+		GfxImage& image{ m_SwapChainImages.emplace_back() };
+		image.m_pGraphicsAPI = m_pGraphicsAPI;
+		image.m_VkUsageFlags = usageFlags;
+		image.m_VkExtent = VkExtent3D{ .width = m_VkSwapChainExtent.width, .height = m_VkSwapChainExtent.height, .depth = 1 };
+		image.m_VkType = VK_IMAGE_TYPE_2D;
+		image.m_VkImageFormat = m_VkSwapChainColorFormat;
+		image.m_IsSwapchainImage = true;
+		image.m_IsOwningVkImage = true;
+
+		gfxDevice->CreateImage(image.m_VkExtent.width, image.m_VkExtent.height, image.m_NumLevels, image.m_VkImageFormat, VK_IMAGE_TILING_OPTIMAL, image.m_VkUsageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.m_VkImage, image.m_Allocation);
+
+		HandleVkResult(gfxDevice->SetVkObjectName(VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(image.m_VkImage), debugNameImage));
+	}
+}
+
 void GfxSwapchain::CreateDepthResources()
 {
 	const VkFormat depthFormat{ FindDepthFormat() };
@@ -317,17 +404,19 @@ void GfxSwapchain::CreateDepthResources()
 	{
 		snprintf(debugNameImageView, sizeof(debugNameImageView) - 1, "Image View: swapchain depth %u", static_cast<uint32_t>(i));
 
-		m_DepthImages.emplace_back(m_pGraphicsAPI);
-		GfxImage& image{ m_DepthImages[i] };
-
-		image.m_VkUsageFlags = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		GfxImage& image{ m_DepthImages.emplace_back() };
+		image.m_pGraphicsAPI = m_pGraphicsAPI;
+		image.m_VkUsageFlags = m_IsDepthSampled ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 		image.m_VkExtent = VkExtent3D{ m_VkSwapChainExtent.width, m_VkSwapChainExtent.height, 1 };
 		image.m_VkType = VK_IMAGE_TYPE_2D;
 		image.m_VkImageFormat = depthFormat;
 		image.m_IsDepthFormat = GfxImage::IsDepthFormat(depthFormat);
 		image.m_IsStencilFormat = GfxImage::IsStencilFormat(depthFormat);
 
-		m_pGraphicsAPI->GetGfxDevice()->CreateImage(image.m_VkExtent.width, image.m_VkExtent.height, image.m_NumLevels, image.m_VkImageFormat, VK_IMAGE_TILING_OPTIMAL, image.m_VkUsageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.m_VkImage, image.m_VkMemory[0]);
+		m_pGraphicsAPI->GetGfxDevice()->CreateImage(image.m_VkExtent.width, image.m_VkExtent.height, image.m_NumLevels, image.m_VkImageFormat, VK_IMAGE_TILING_OPTIMAL, image.m_VkUsageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.m_VkImage, image.m_Allocation);
+
+		// Read by the depth pyramid build, sampled views cannot include the stencil aspect
+		image.m_ImageView = image.CreateImageView(VK_IMAGE_VIEW_TYPE_2D, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1, {}, debugNameImageView);
 	}
 }
 
@@ -364,36 +453,77 @@ void GfxSwapchain::CleanupSwapchain()
 	for (const auto framebuffer : m_VkFrameBuffers)
 		vkDestroyFramebuffer(device, framebuffer, nullptr);
 
+	m_VkFrameBuffers.clear();
+
+	for (auto& image : m_DepthImages)
+		DestroyImageResources(image);
+
+	for (auto& image : m_SwapChainImages)
+		DestroyImageResources(image);
+
 	m_DepthImages.clear();
 	m_SwapChainImages.clear();
 }
 
-void GfxSwapchain::CreateRenderPass()
+void GfxSwapchain::DestroyImageResources(GfxImage& image) const
+{
+	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
+
+	for (auto& levelViews : image.m_ImageViewForFramebuffer)
+	{
+		for (auto& view : levelViews)
+		{
+			if (view != VK_NULL_HANDLE)
+				vkDestroyImageView(device, view, nullptr);
+
+			view = VK_NULL_HANDLE;
+		}
+	}
+
+	if (image.m_ImageView != VK_NULL_HANDLE)
+		vkDestroyImageView(device, image.m_ImageView, nullptr);
+
+	image.m_ImageView = VK_NULL_HANDLE;
+
+	if (!image.m_IsOwningVkImage)
+		return;
+
+	vkDestroyImage(device, image.m_VkImage, nullptr);
+	m_pGraphicsAPI->GetGfxDevice()->GetMemoryAllocator()->Free(image.m_Allocation);
+
+	image.m_VkImage = VK_NULL_HANDLE;
+	image.m_Allocation = {};
+}
+
+void GfxSwapchain::CreateRenderPass(VkAttachmentLoadOp loadOp, VkRenderPass& renderPass) const
 {
 	const auto& device{ m_pGraphicsAPI->GetGfxDevice()->GetDevice() };
 
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = m_VkSwapChainColorFormat;
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.loadOp = loadOp;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0;
 	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	// Depth is only kept after the main pass, for the depth pyramid build and the late pass. Nothing reads it after the late pass
+	const bool isDepthKept{ m_IsDepthSampled && loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR };
+
 	VkAttachmentDescription depthAttachment{};
 	depthAttachment.format = FindDepthFormat();
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.loadOp = loadOp;
+	depthAttachment.storeOp = isDepthKept ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference depthAttachmentRef{};
@@ -406,14 +536,7 @@ void GfxSwapchain::CreateRenderPass()
 	subpass.pColorAttachments = &colorAttachmentRef;
 	subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
+	// No external dependencies, the render graph's barriers around the pass order it with the rest of the frame
 	const std::array<VkAttachmentDescription, 2> attachments{ colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -421,10 +544,8 @@ void GfxSwapchain::CreateRenderPass()
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
 
-	HandleVkResult(vkCreateRenderPass(device, &renderPassInfo, nullptr, &m_VkRenderPass));
+	HandleVkResult(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass));
 }
 
 void GfxSwapchain::CreateSyncObjects()
@@ -37,7 +37,12 @@ public:
 	GfxSwapchain& operator=(GfxSwapchain&&) noexcept = delete;
 
 	[[nodiscard]] VkFramebuffer GetCurrentFrameBuffer() const;
+	// The attachments enter and leave in their attachment layouts, transitions are left to the render graph
 	[[nodiscard]] VkRenderPass GetRenderPass() const;
+	// Same attachments as GetRenderPass(), loads the color and depth stored by it instead of clearing them
+	[[nodiscard]] VkRenderPass GetLoadRenderPass() const;
+	// Depth of the current frame, its m_ImageView is the depth aspect
+	[[nodiscard]] GfxImage* GetCurrentDepthImage();
 	[[nodiscard]] VkImageView GetImageView(int index) const;
 	[[nodiscard]] size_t GetImageCount() const;
 	[[nodiscard]] VkFormat GetSwapChainImageFormat() const;
@@ -46,6 +51,8 @@ public:
 	[[nodiscard]] uint32_t Height() const;
 	[[nodiscard]] float AspectRatio() const;
 	[[nodiscard]] uint64_t GetCurrentFrameIndex() const;
+	[[nodiscard]] bool IsHeadless() const;
+	[[nodiscard]] VkImageLayout GetPresentLayout() const;
 
 	[[nodiscard]] VkFormat FindDepthFormat() const;
 
@@ -59,6 +66,9 @@ public:
 
 private:
 	GraphicsAPI* m_pGraphicsAPI;
+	bool m_IsHeadless;
+	// Only occlusion culling reads the depth after the main pass
+	bool m_IsDepthSampled;
 
 	VkFormat m_VkSwapChainColorFormat;
 	VkFormat m_VkSwapChainDepthFormat;
@@ -66,13 +76,14 @@ private:
 
 	std::vector<VkFramebuffer> m_VkFrameBuffers;
 	VkRenderPass m_VkRenderPass{ VK_NULL_HANDLE };
+	VkRenderPass m_VkLoadRenderPass{ VK_NULL_HANDLE };
 
 	VkSwapchainKHR m_VkSwapChain{ VK_NULL_HANDLE };
 	std::vector<GfxImage> m_SwapChainImages;
 	std::vector<GfxImage> m_DepthImages;
 
-	std::array<VkSemaphore, sk_MaxFramesInFlight> m_AcquireSemaphores;
-	std::array<uint64_t, sk_MaxFramesInFlight> m_TimelineWaitValues;
+	std::array<VkSemaphore, sk_MaxFramesInFlight> m_AcquireSemaphores{};
+	std::array<uint64_t, sk_MaxFramesInFlight> m_TimelineWaitValues{};
 
 	uint64_t m_CurrentFrame{};
 	uint32_t m_CurrentFrameSwapchainImageIndex{};
@@ -84,10 +95,12 @@ private:
 	static VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 	void CreateSwapchain();
+	void CreateOffscreenTargets();
 	void CreateDepthResources();
 	void CreateFrameBuffers();
 	void CleanupSwapchain();
-	void CreateRenderPass();
+	void DestroyImageResources(GfxImage& image) const;
+	void CreateRenderPass(VkAttachmentLoadOp loadOp, VkRenderPass& renderPass) const;
 	void CreateSyncObjects();
 };
 
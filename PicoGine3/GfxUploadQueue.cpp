@@ -0,0 +1,228 @@
+#include "pch.h"
+#include "GfxUploadQueue.h"
+
+#include "GraphicsAPI.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+GfxUploadQueue::GfxUploadQueue(GraphicsAPI* pGraphicsAPI) :
+	m_pGraphicsAPI{ pGraphicsAPI },
+	m_pImmediateCommands{ std::make_unique<GfxImmediateCommands>(pGraphicsAPI->GetGfxDevice(), QueueType_Transfer, "GfxUploadQueue::m_pImmediateCommands") },
+	m_pStagingRing{ std::make_unique<GfxStagingRing>(pGraphicsAPI, m_pImmediateCommands.get()) }
+{
+	const GfxDevice* pDevice{ m_pGraphicsAPI->GetGfxDevice() };
+
+	m_TimelineSemaphore = pDevice->CreateVkSemaphoreTimeline(0, "GfxUploadQueue::m_TimelineSemaphore");
+	m_TransferFamily = pDevice->GetDeviceQueueInfo().m_TransferFamily;
+	m_GraphicsFamily = pDevice->GetDeviceQueueInfo().m_GraphicsFamily;
+
+	if (!IsDedicatedQueue())
+		Logger::Get().LogInfo(L"No dedicated transfer queue family, uploads share the graphics family.\n");
+}
+
+GfxUploadQueue::~GfxUploadQueue()
+{
+	Flush();
+	m_pImmediateCommands->WaitAll();
+
+	m_pStagingRing.reset();
+	m_pImmediateCommands.reset();
+
+	vkDestroySemaphore(m_pGraphicsAPI->GetGfxDevice()->GetDevice(), m_TimelineSemaphore, nullptr);
+}
+
+UploadHandle GfxUploadQueue::UploadBuffer(GfxBuffer* pDstBuffer, const void* pData, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+	PROFILE_FUNCTION();
+
+	assert(pDstBuffer && L"Invalid upload destination buffer.");
+
+	// The staging region is tied to the transfer command buffer, it has to be acquired first
+	const VkCommandBuffer cmdBuffer{ GetCmdBuffer() };
+	const StagingRegion region{ m_pStagingRing->Upload(pData, size) };
+
+	m_pGraphicsAPI->GetGfxDevice()->CopyBuffer(cmdBuffer, region.m_VkBuffer, pDstBuffer->m_VkBuffer, size, region.m_Offset, dstOffset);
+
+	const UploadHandle handle{ m_SubmittedValue + 1 };
+
+	if (!IsDedicatedQueue())
+		return handle;
+
+	const VkBufferMemoryBarrier2 release
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.srcQueueFamilyIndex = m_TransferFamily,
+		.dstQueueFamilyIndex = m_GraphicsFamily,
+		.buffer = pDstBuffer->m_VkBuffer,
+		.offset = dstOffset,
+		.size = size,
+	};
+
+	const VkDependencyInfo dependencyInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.bufferMemoryBarrierCount = 1,
+		.pBufferMemoryBarriers = &release,
+	};
+	vkCmdPipelineBarrier2(cmdBuffer, &dependencyInfo);
+
+	PendingAcquire& acquire{ m_PendingAcquires.emplace_back() };
+	acquire.m_TimelineValue = handle.m_TimelineValue;
+	acquire.m_BufferBarrier = release;
+
+	return handle;
+}
+
+UploadHandle GfxUploadQueue::UploadImage(GfxImage* pDstImage, const void* pData, VkDeviceSize size, VkImageLayout finalLayout)
+{
+	PROFILE_FUNCTION();
+
+	assert(pDstImage && L"Invalid upload destination image.");
+	assert(pDstImage->m_NumLevels == 1 && pDstImage->m_NumLayers == 1 && L"Only single level, single layer images can be uploaded on the transfer queue.");
+
+	const VkCommandBuffer cmdBuffer{ GetCmdBuffer() };
+	const StagingRegion region{ m_pStagingRing->Upload(pData, size, 4) };
+	const VkImageSubresourceRange range{ pDstImage->GetImageAspectFlags(), 0, 1, 0, 1 };
+
+	GfxImage::ImageMemoryBarrier(cmdBuffer,
+		pDstImage->m_VkImage,
+		StageAccess{ .m_Stage = VK_PIPELINE_STAGE_2_NONE, .m_Access = VK_ACCESS_2_NONE },
+		StageAccess{ .m_Stage = VK_PIPELINE_STAGE_2_COPY_BIT, .m_Access = VK_ACCESS_2_TRANSFER_WRITE_BIT },
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		range);
+
+	m_pGraphicsAPI->GetGfxDevice()->CopyBufferToImage(cmdBuffer, region.m_VkBuffer, pDstImage->m_VkImage, pDstImage->m_VkExtent.width, pDstImage->m_VkExtent.height, region.m_Offset);
+
+	// The layout transition happens as part of the release, the graphics queue sees the final layout once acquired
+	const VkImageMemoryBarrier2 release
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = finalLayout,
+		.srcQueueFamilyIndex = IsDedicatedQueue() ? m_TransferFamily : VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = IsDedicatedQueue() ? m_GraphicsFamily : VK_QUEUE_FAMILY_IGNORED,
+		.image = pDstImage->m_VkImage,
+		.subresourceRange = range,
+	};
+
+	const VkDependencyInfo dependencyInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.imageMemoryBarrierCount = 1,
+		.pImageMemoryBarriers = &release,
+	};
+	vkCmdPipelineBarrier2(cmdBuffer, &dependencyInfo);
+
+	pDstImage->m_CurrentVkImageLayout = finalLayout;
+
+	const UploadHandle handle{ m_SubmittedValue + 1 };
+
+	if (IsDedicatedQueue())
+	{
+		PendingAcquire& acquire{ m_PendingAcquires.emplace_back() };
+		acquire.m_TimelineValue = handle.m_TimelineValue;
+		acquire.m_ImageBarrier = release;
+		acquire.m_IsImage = true;
+	}
+
+	return handle;
+}
+
+void GfxUploadQueue::Flush()
+{
+	if (!m_pCurrentWrapper)
+		return;
+
+	PROFILE_FUNCTION();
+
+	m_pImmediateCommands->SignalSemaphore(m_TimelineSemaphore, ++m_SubmittedValue);
+	m_pImmediateCommands->Submit(*m_pCurrentWrapper);
+	m_pCurrentWrapper = nullptr;
+
+	// Not left in the batch, the graphics queue only picks up uploads it sees completed on the timeline
+	m_pImmediateCommands->FlushSubmits();
+}
+
+void GfxUploadQueue::AcquireCompleted(VkCommandBuffer graphicsCmdBuffer, GfxImmediateCommands* pGraphicsCommands)
+{
+	if (m_AcquiredValue == m_SubmittedValue)
+		return;
+
+	PROFILE_FUNCTION();
+
+	uint64_t completedValue{};
+	HandleVkResult(vkGetSemaphoreCounterValue(m_pGraphicsAPI->GetGfxDevice()->GetDevice(), m_TimelineSemaphore, &completedValue));
+
+	if (completedValue <= m_AcquiredValue)
+		return;
+
+	std::vector<VkBufferMemoryBarrier2> bufferBarriers{};
+	std::vector<VkImageMemoryBarrier2> imageBarriers{};
+
+	// Pending acquires are recorded in submission order
+	auto it{ m_PendingAcquires.begin() };
+	for (; it != m_PendingAcquires.end() && it->m_TimelineValue <= completedValue; ++it)
+	{
+		if (it->m_IsImage)
+		{
+			VkImageMemoryBarrier2& barrier{ imageBarriers.emplace_back(it->m_ImageBarrier) };
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.srcAccessMask = VK_ACCESS_2_NONE;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+		}
+		else
+		{
+			VkBufferMemoryBarrier2& barrier{ bufferBarriers.emplace_back(it->m_BufferBarrier) };
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.srcAccessMask = VK_ACCESS_2_NONE;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+		}
+	}
+	m_PendingAcquires.erase(m_PendingAcquires.begin(), it);
+
+	if (!bufferBarriers.empty() || !imageBarriers.empty())
+	{
+		const VkDependencyInfo dependencyInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+			.pBufferMemoryBarriers = bufferBarriers.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+			.pImageMemoryBarriers = imageBarriers.data(),
+		};
+		vkCmdPipelineBarrier2(graphicsCmdBuffer, &dependencyInfo);
+	}
+
+	// Already signaled, but the wait is what makes the transfer writes visible to the graphics queue
+	pGraphicsCommands->WaitSemaphore(m_TimelineSemaphore, completedValue);
+	m_AcquiredValue = completedValue;
+}
+
+bool GfxUploadQueue::IsComplete(UploadHandle handle) const
+{
+	return handle.m_TimelineValue <= m_AcquiredValue;
+}
+
+bool GfxUploadQueue::IsDedicatedQueue() const
+{
+	return m_TransferFamily != m_GraphicsFamily;
+}
+
+VkCommandBuffer GfxUploadQueue::GetCmdBuffer()
+{
+	if (!m_pCurrentWrapper)
+		m_pCurrentWrapper = &m_pImmediateCommands->Acquire();
+
+	return m_pCurrentWrapper->m_CmdBuffer;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef GFXUPLOADQUEUE_H
+#define GFXUPLOADQUEUE_H
+
+#include <atomic>
+
+#include "GfxImmediateCommands.h"
+#include "GfxStagingRing.h"
+#include "GfxStructs.h"
+
+#if defined(_DX)
+
+#elif defined(_VK)
+
+class GraphicsAPI;
+
+struct UploadHandle final
+{
+	uint64_t m_TimelineValue{};
+	[[nodiscard]] bool Empty() const { return m_TimelineValue == 0; }
+};
+
+// Uploads recorded on the transfer queue, handed over to the graphics queue through queue family ownership transfers and a timeline semaphore
+class GfxUploadQueue final
+{
+public:
+	explicit GfxUploadQueue(GraphicsAPI* pGraphicsAPI);
+	~GfxUploadQueue();
+
+	GfxUploadQueue(const GfxUploadQueue&) noexcept = delete;
+	GfxUploadQueue& operator=(const GfxUploadQueue&) noexcept = delete;
+	GfxUploadQueue(GfxUploadQueue&&) noexcept = delete;
+	GfxUploadQueue& operator=(GfxUploadQueue&&) noexcept = delete;
+
+	// The destination must not be used by the graphics queue before IsComplete() returns true
+	UploadHandle UploadBuffer(GfxBuffer* pDstBuffer, const void* pData, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	// Single level, single layer images only, mip generation needs the graphics queue
+	UploadHandle UploadImage(GfxImage* pDstImage, const void* pData, VkDeviceSize size, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	void Flush();
+	// Records the acquire side of every finished upload into the graphics command buffer and makes its next submit wait on them
+	void AcquireCompleted(VkCommandBuffer graphicsCmdBuffer, GfxImmediateCommands* pGraphicsCommands);
+
+	// Changes in AcquireCompleted(), so two calls from another thread than the recording one may disagree within a frame
+	[[nodiscard]] bool IsComplete(UploadHandle handle) const;
+	[[nodiscard]] bool IsDedicatedQueue() const;
+
+private:
+	struct PendingAcquire final
+	{
+		uint64_t m_TimelineValue{};
+		VkBufferMemoryBarrier2 m_BufferBarrier{};
+		VkImageMemoryBarrier2 m_ImageBarrier{};
+		bool m_IsImage{};
+	};
+
+	GraphicsAPI* m_pGraphicsAPI;
+	std::unique_ptr<GfxImmediateCommands> m_pImmediateCommands;
+	std::unique_ptr<GfxStagingRing> m_pStagingRing;
+	const CommandBufferWrapper* m_pCurrentWrapper{};
+	VkSemaphore m_TimelineSemaphore{ VK_NULL_HANDLE };
+	uint64_t m_SubmittedValue{};
+	std::atomic<uint64_t> m_AcquiredValue{}; // Written by the render thread, IsComplete() may be called from any thread
+	uint32_t m_TransferFamily{};
+	uint32_t m_GraphicsFamily{};
+	std::vector<PendingAcquire> m_PendingAcquires{};
+
+	VkCommandBuffer GetCmdBuffer();
+};
+
+#endif
+
+#endif //GFXUPLOADQUEUE_H
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "pch.h"
 #include "GraphicsAPI.h"
 
+#include <bit>
+
+#include "Benchmark.h"
+#include "GfxMemoryAllocator.h"
+#include "JobSystem.h"
 #include "ResourceManager.h"
 #include "TimeManager.h"
 #include "WindowManager.h"
@@ -55,15 +60,32 @@ GraphicsAPI::GraphicsAPI() :
 	m_IsInitialized{ false },
 	m_pGfxDevice{ std::make_unique<GfxDevice>() },
 	m_pGfxSwapchain{ std::make_unique<GfxSwapchain>(this) },
-	m_pGfxImmediateCommands{ std::make_unique<GfxImmediateCommands>(m_pGfxDevice.get(), "GraphicsAPI::m_pGfxImmediateCommands") },
+	m_pGfxImmediateCommands{ std::make_unique<GfxImmediateCommands>(m_pGfxDevice.get(), QueueType_Graphics, "GraphicsAPI::m_pGfxImmediateCommands") },
 	m_TimelineSemaphore{ m_pGfxDevice->CreateVkSemaphoreTimeline(m_pGfxSwapchain->GetImageCount() - 1, "GraphicsAPI::m_TimelineSemaphore") },
 	m_pShaderModulePool{ std::make_unique<ShaderModulePool>(m_pGfxDevice.get()) }
 {
+	// Needs the query pools pool, which is declared after it
+	m_pGfxGpuTimer = std::make_unique<GfxGpuTimer>(this);
+	m_pGfxStagingRing = std::make_unique<GfxStagingRing>(this, m_pGfxImmediateCommands.get());
+	m_pGfxUploadQueue = std::make_unique<GfxUploadQueue>(this);
+	m_pGfxRenderGraph = std::make_unique<GfxRenderGraph>(this);
+	// One recording slot per worker and one for the calling thread, which takes part in the parallel loops
+	m_pGfxSecondaryCommands = std::make_unique<GfxSecondaryCommands>(m_pGfxDevice.get(), m_pGfxImmediateCommands.get(), JobSystem::Get().GetWorkerCount() + 1, "GraphicsAPI::m_pGfxSecondaryCommands");
+
+	// A compute family without graphics support runs next to the graphics queue, the shared family would only serialize behind it.
+	// Created before the buffers, which are made concurrent between both families when it exists
+	const DeviceQueueInfo queueInfo{ m_pGfxDevice->GetDeviceQueueInfo() };
+	if (queueInfo.m_ComputeFamily != queueInfo.m_GraphicsFamily)
+		m_pGfxComputeCommands = std::make_unique<GfxImmediateCommands>(m_pGfxDevice.get(), QueueType_Compute, "GraphicsAPI::m_pGfxComputeCommands");
+
 	AcquireCommandBuffer();
 	CreateDescriptorSetLayout();
 	CreateGraphicsPipeline();
+	m_pGfxDepthPyramid = std::make_unique<GfxDepthPyramid>(this, m_pGfxSwapchain->GetSwapChainExtent());
+	CreateCullPipeline();
 	CreateTextureImage();
 	CreateUniformBuffers();
+	CreateGeometryArenas();
 	CreateDescriptorPool();
 	CreateDescriptorSets();
 	SubmitCommandBuffer();
@@ -77,7 +99,19 @@ GraphicsAPI::~GraphicsAPI()
 	vkDeviceWaitIdle(device);
 
 	ResourceManager::Get().ReleaseGPUBuffers();
+
+	// Ranges released by the meshes are returned to their arena by deferred tasks
+	WaitDeferredTasks();
+	for (auto& pArena : m_GeometryArenas)
+		pArena.reset();
+
+	vkDestroyImageView(device, m_pTestModelTextureImage->m_ImageView, nullptr);
+	vkDestroyImage(device, m_pTestModelTextureImage->m_VkImage, nullptr);
+	m_pGfxDevice->GetMemoryAllocator()->Free(m_pTestModelTextureImage->m_Allocation);
 	m_pTestModelTextureImage.reset();
+	m_pGfxGpuTimer.reset();
+	m_pGfxStagingRing.reset();
+	m_pGfxUploadQueue.reset();
 
 	vkDestroySemaphore(device, m_TimelineSemaphore, nullptr);
 
@@ -85,18 +119,40 @@ GraphicsAPI::~GraphicsAPI()
 
 	m_PerFrameUBO.clear();
 
+	for (const BufferHandle handle : m_InstanceBuffers)
+		Destroy(handle);
+	m_InstanceBuffers.clear();
+
+	for (size_t i{}; i < m_ObjectBuffers.size(); ++i)
+	{
+		Destroy(m_ObjectBuffers[i]);
+		Destroy(m_DrawCommandBuffers[i]);
+		Destroy(m_DrawCountBuffers[i]);
+		Destroy(m_LateObjectBuffers[i]);
+	}
+	m_ObjectBuffers.clear();
+	m_DrawCommandBuffers.clear();
+	m_DrawCountBuffers.clear();
+	m_LateObjectBuffers.clear();
+
 	vkDestroyDescriptorPool(device, m_VkDescriptorPool, nullptr);
 
 	vkDestroyDescriptorSetLayout(device, m_VkDescriptorSetLayout, nullptr);
 	
 	vkDestroyPipeline(device, m_VkGraphicsPipeline, nullptr);
+	vkDestroyPipeline(device, m_VkPackedGraphicsPipeline, nullptr);
 	vkDestroyPipelineLayout(device, m_VkGraphicsPipelineLayout, nullptr);
+	Destroy(m_CullPipeline);
+	m_pGfxDepthPyramid.reset();
+	m_pGfxRenderGraph.reset();
+	m_pGfxSecondaryCommands.reset();
 
 	m_pShaderModulePool.reset();
 	m_pGfxSwapchain.reset();
 
 	WaitDeferredTasks();
 
+	m_pGfxComputeCommands.reset();
 	m_pGfxImmediateCommands.reset();
 	m_pGfxDevice.reset();
 }
@@ -116,6 +172,11 @@ GfxImmediateCommands* GraphicsAPI::GetGfxImmediateCommands() const
 	return m_pGfxImmediateCommands.get();
 }
 
+GfxImmediateCommands* GraphicsAPI::GetGfxComputeCommands() const
+{
+	return m_pGfxComputeCommands.get();
+}
+
 VkSemaphore GraphicsAPI::GetTimelineSemaphore() const
 {
 	return m_TimelineSemaphore;
@@ -126,49 +187,53 @@ const GfxCommandBuffer& GraphicsAPI::GetCurrentCommandBuffer() const
 	return m_CurrentCommandBuffer;
 }
 
+GfxGpuTimer* GraphicsAPI::GetGfxGpuTimer() const
+{
+	return m_pGfxGpuTimer.get();
+}
+
+GfxStagingRing* GraphicsAPI::GetGfxStagingRing() const
+{
+	return m_pGfxStagingRing.get();
+}
+
+GfxUploadQueue* GraphicsAPI::GetGfxUploadQueue() const
+{
+	return m_pGfxUploadQueue.get();
+}
+
+ShaderModulePool* GraphicsAPI::GetShaderModulePool() const
+{
+	return m_pShaderModulePool.get();
+}
+
 void GraphicsAPI::BeginFrame()
 {
+	PROFILE_FUNCTION();
+
 	AcquireCommandBuffer();
 	const VkCommandBuffer cmdBuffer{ m_CurrentCommandBuffer.GetCmdBuffer() };
 
-	UpdatePerFrameUBO();
+	// Uploads recorded since the last frame go out now, the ones that already landed become usable this frame
+	m_pGfxUploadQueue->Flush();
+	m_pGfxUploadQueue->AcquireCompleted(cmdBuffer, m_pGfxImmediateCommands.get());
 
-	std::array<VkClearValue, 2> clearValues{};
-	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-	clearValues[1].depthStencil = { 1.0f, 0 };
-
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_pGfxSwapchain->GetRenderPass();
-	renderPassInfo.framebuffer = m_pGfxSwapchain->GetCurrentFrameBuffer();
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = m_pGfxSwapchain->GetSwapChainExtent();
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
-	
-	vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkGraphicsPipeline);
+	m_pGfxGpuTimer->BeginFrame(m_CurrentCommandBuffer);
+	m_pGfxSecondaryCommands->BeginFrame(static_cast<uint32_t>(m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight));
 
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_pGfxSwapchain->Width());
-	viewport.height = static_cast<float>(m_pGfxSwapchain->Height());
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	
-	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+	UpdatePerFrameUBO();
 
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_pGfxSwapchain->GetSwapChainExtent();
-	
-	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+	m_CulledObjectCount = 0;
+	m_OcclusionCulling = false;
+	m_AsyncCullTimelineValue = 0;
+	m_FrameDrawCount = 0;
+	m_FrameBindCount = 0;
 }
 
 void GraphicsAPI::EndFrame()
 {
+	PROFILE_FUNCTION();
+
 	const auto cmdBuffer{ m_CurrentCommandBuffer.GetCmdBuffer() };
 	if (cmdBuffer == VK_NULL_HANDLE)
 	{
@@ -176,45 +241,172 @@ void GraphicsAPI::EndFrame()
 		return;
 	}
 
-	vkCmdEndRenderPass(cmdBuffer);
+	BuildFrameGraph();
+	m_pGfxRenderGraph->Execute(m_CurrentCommandBuffer);
+	m_MainPassDraws = nullptr;
+	m_MainPassDrawCount = 0;
+
+	m_pGfxGpuTimer->EndFrame(m_CurrentCommandBuffer);
+
+	// On the frame's own submit, a wait only holds back the commands of its batch
+	if (m_AsyncCullTimelineValue != 0)
+		m_pGfxImmediateCommands->WaitSemaphore(m_pGfxComputeCommands->GetTimelineSemaphore(), m_AsyncCullTimelineValue, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+
+	const SubmitHandle submitHandle{ SubmitCommandBuffer(true) };
+	m_pGfxGpuTimer->SetFrameSubmitHandle(submitHandle);
+	m_pGfxSecondaryCommands->SetFrameSubmitHandle(submitHandle);
+
+	auto& benchmark{ Benchmark::Get() };
+	if (benchmark.IsEnabled())
+	{
+		const GfxMemoryStats memoryStats{ m_pGfxDevice->GetMemoryAllocator()->GetStats() };
+		benchmark.SetCounter("gpuMemoryBytesReserved", memoryStats.m_BytesReserved);
+		benchmark.SetCounter("gpuMemoryBytesUsed", memoryStats.m_BytesUsed);
+		benchmark.SetCounter("gpuMemoryPeakBytesReserved", memoryStats.m_PeakBytesReserved);
+		benchmark.SetCounter("gpuMemoryBlocks", memoryStats.m_BlockCount);
+		benchmark.SetCounter("gpuMemoryAllocations", memoryStats.m_AllocationCount);
+		benchmark.SetCounter("gpuMemoryDedicatedAllocations", memoryStats.m_DedicatedAllocationCount);
+		benchmark.SetCounter("gpuMemoryVkAllocateCalls", memoryStats.m_TotalVkAllocateCalls);
+		benchmark.SetCounter("drawCalls", m_FrameDrawCount);
+		benchmark.SetCounter("bindCalls", m_FrameBindCount);
+		const uint32_t graphicsQueueSubmitCount{ m_pGfxImmediateCommands->GetQueueSubmitCount() };
+		benchmark.SetCounter("graphicsQueueSubmitCalls", graphicsQueueSubmitCount - m_LastGraphicsQueueSubmitCount);
+		m_LastGraphicsQueueSubmitCount = graphicsQueueSubmitCount;
+		const uint32_t computeQueueSubmitCount{ m_pGfxComputeCommands ? m_pGfxComputeCommands->GetQueueSubmitCount() : 0 };
+		benchmark.SetCounter("computeQueueSubmitCalls", computeQueueSubmitCount - m_LastComputeQueueSubmitCount);
+		m_LastComputeQueueSubmitCount = computeQueueSubmitCount;
+
+		const GfxRenderGraphStats graphStats{ m_pGfxRenderGraph->GetStats() };
+		benchmark.SetCounter("renderGraphPasses", graphStats.m_PassCount);
+		benchmark.SetCounter("renderGraphCulledPasses", graphStats.m_CulledPassCount);
+		benchmark.SetCounter("renderGraphBarriers", graphStats.m_BarrierCount);
+		benchmark.SetCounter("renderGraphBarrierBatches", graphStats.m_BarrierBatchCount);
+		benchmark.SetCounter("renderGraphTransientImages", graphStats.m_TransientImageCount);
+		benchmark.SetCounter("renderGraphTransientBytesRequested", graphStats.m_TransientBytesRequested);
+		benchmark.SetCounter("renderGraphTransientBytesAllocated", graphStats.m_TransientBytesAllocated);
+	}
+}
+
+void GraphicsAPI::SetInstanceData(std::span<const InstanceData> instances)
+{
+	PROFILE_FUNCTION();
+
+	if (instances.empty())
+		return;
 
-	SubmitCommandBuffer(true);
+	const auto currentFrame{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+
+	// The previous user of this slot has retired, the old buffer only has to outlive the command buffer being recorded
+	if (instances.size() > m_InstanceBufferCapacities[currentFrame])
+	{
+		Destroy(m_InstanceBuffers[currentFrame]);
+		CreateInstanceBuffer(currentFrame, std::bit_ceil(static_cast<uint32_t>(instances.size())));
+	}
+
+	m_BuffersPool.Get(m_InstanceBuffers[currentFrame])->WriteBufferData(0, instances.size_bytes(), instances.data());
+}
+
+void GraphicsAPI::SetMainPassDraws(uint32_t drawCount, DrawRangeCallback&& drawCallback)
+{
+	m_MainPassDrawCount = drawCount;
+	m_MainPassDraws = std::move(drawCallback);
 }
 
-void GraphicsAPI::DrawMesh(uint32_t meshDataID, uint32_t /*materialID*/, const XMFLOAT4X4& transform) const
+void GraphicsAPI::DrawMesh(DrawRecorder& recorder, uint32_t meshDataID, uint32_t /*materialID*/, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod) const
 {
 	const auto& resourceManager{ ResourceManager::Get() };
 	const auto& meshData{ resourceManager.GetMeshData(meshDataID) };
-	const auto& vertexBuffer{ m_BuffersPool.Get(meshData.m_pVertexBufferHandle) };
-	const auto& indexBuffer{ m_BuffersPool.Get(meshData.m_pIndexBufferHandle) };
-	const auto currentFrameIndex{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+	if (!meshData.IsReady())
+		return;
 
-	const auto cmdBuffer{ m_CurrentCommandBuffer.GetCmdBuffer() };
-	if (cmdBuffer == VK_NULL_HANDLE)
+	if (recorder.m_CmdBuffer == VK_NULL_HANDLE)
 	{
-		Logger::Get().LogError(L"No command buffer was acquired beforehand.");
+		Logger::Get().LogError(L"Draws can only be recorded by the main pass draw callback.");
 		return;
 	}
 
-	const PushConstants pushConstants{ transform };
+	BindDrawState(recorder, meshData.m_VertexFormat, m_BuffersPool.Get(meshData.m_pVertexBufferHandle)->m_VkBuffer, m_BuffersPool.Get(meshData.m_pIndexBufferHandle)->m_VkBuffer);
 
-	const VkBuffer vertexBuffers[]
+	PushDrawConstants(recorder, meshData.m_PositionOffset, meshData.m_PositionScale);
+
+	// The placeholder has a single level
+	const MeshLod& meshLod{ meshData.m_Lods[std::min(lod, static_cast<uint32_t>(meshData.m_Lods.size()) - 1)] };
+	vkCmdDrawIndexed(recorder.m_CmdBuffer, meshLod.m_IndexCount, instanceCount, meshData.m_GeometryRange.m_FirstIndex + meshLod.m_FirstIndex, static_cast<int32_t>(meshData.m_GeometryRange.m_FirstVertex), firstInstance);
+	++recorder.m_DrawCount;
+}
+
+bool GraphicsAPI::IsGpuDrivenSupported() const
+{
+	return m_pGfxDevice->IsDrawIndirectCountSupported();
+}
+
+void GraphicsAPI::CullObjects(std::span<const ObjectData> objects, bool occlusionCulling)
+{
+	PROFILE_FUNCTION();
+
+	m_CulledObjectCount = static_cast<uint32_t>(objects.size());
+	m_OcclusionCulling = occlusionCulling;
+	if (objects.empty())
+		return;
+
+	const auto currentFrame{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+
+	if (objects.size() > m_ObjectBufferCapacities[currentFrame])
 	{
-		vertexBuffer->m_VkBuffer
-	};
+		Destroy(m_ObjectBuffers[currentFrame]);
+		Destroy(m_DrawCommandBuffers[currentFrame]);
+		Destroy(m_LateObjectBuffers[currentFrame]);
+		CreateObjectBuffers(currentFrame, std::bit_ceil(static_cast<uint32_t>(objects.size())));
+	}
+
+	// The culling passes themselves are declared with the rest of the frame in EndFrame()
+	m_BuffersPool.Get(m_ObjectBuffers[currentFrame])->WriteBufferData(0, objects.size_bytes(), objects.data());
+
+	// The second phase depends on this frame's depth, which only exists on the graphics queue
+	if (IsAsyncComputeSupported() && !m_OcclusionCulling)
+		SubmitAsyncCull();
+}
+
+bool GraphicsAPI::IsAsyncComputeSupported() const
+{
+	return m_pGfxComputeCommands != nullptr;
+}
+
+GfxGeometryArena* GraphicsAPI::GetGeometryArena(VertexFormat vertexFormat) const
+{
+	return m_GeometryArenas[static_cast<size_t>(vertexFormat)].get();
+}
 
-	constexpr VkDeviceSize offsets[]
+const XMFLOAT3& GraphicsAPI::GetCameraPosition() const
+{
+	return m_CameraPosition;
+}
+
+float GraphicsAPI::GetProjectionScale() const
+{
+	return static_cast<float>(m_pGfxSwapchain->Height()) * 0.5f / std::tan(m_CameraFovY * 0.5f);
+}
+
+std::array<XMFLOAT4, 6> GraphicsAPI::GetFrustumPlanes() const
+{
+	// Row vectors, clip = position * viewProj, so the planes are combinations of the matrix columns
+	const XMMATRIX columns{ XMMatrixTranspose(XMMatrixMultiply(CalculateViewMatrix(), CalculateProjMatrix())) };
+
+	const std::array<XMVECTOR, 6> planes
 	{
-		0
+		XMVectorAdd(columns.r[3], columns.r[0]),
+		XMVectorSubtract(columns.r[3], columns.r[0]),
+		XMVectorAdd(columns.r[3], columns.r[1]),
+		XMVectorSubtract(columns.r[3], columns.r[1]),
+		columns.r[2], // Depth range is [0, 1]
+		XMVectorSubtract(columns.r[3], columns.r[2]),
 	};
 
-	vkCmdPushConstants(cmdBuffer, m_VkGraphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pushConstants);
-
-	vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(cmdBuffer, indexBuffer->m_VkBuffer, 0, VK_INDEX_TYPE_UINT32);
-	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkGraphicsPipelineLayout, 0, 1, &m_VkDescriptorSets[currentFrameIndex], 0, nullptr);
+	std::array<XMFLOAT4, 6> result{};
+	for (size_t i{}; i < planes.size(); ++i)
+		XMStoreFloat4(&result[i], XMPlaneNormalize(planes[i]));
 
-	vkCmdDrawIndexed(cmdBuffer, meshData.m_IndexCount, 1, 0, 0, 0);
+	return result;
 }
 
 void GraphicsAPI::AcquireCommandBuffer()
@@ -227,6 +419,8 @@ void GraphicsAPI::AcquireCommandBuffer()
 
 SubmitHandle GraphicsAPI::SubmitCommandBuffer(bool present)
 {
+	PROFILE_FUNCTION();
+
 	const auto cmdBuffer{ m_CurrentCommandBuffer.GetCmdBuffer() };
 	if (cmdBuffer == VK_NULL_HANDLE)
 	{
@@ -234,13 +428,9 @@ SubmitHandle GraphicsAPI::SubmitCommandBuffer(bool present)
 		return {};
 	}
 
+	// The frame's render graph acquired the image and left it in the present layout
 	if (present)
 	{
-		const auto image{ m_pGfxSwapchain->AcquireImage() };
-		image->TransitionLayout(cmdBuffer,
-								VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-								VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS });
-
 		const uint64_t signalValue{ m_pGfxSwapchain->GetCurrentFrameIndex() + m_pGfxSwapchain->GetImageCount() };
 		m_pGfxSwapchain->SetCurrentFrameTimelineWaitValue(signalValue);
 		m_pGfxImmediateCommands->SignalSemaphore(m_TimelineSemaphore, signalValue);
@@ -248,9 +438,14 @@ SubmitHandle GraphicsAPI::SubmitCommandBuffer(bool present)
 
 	const SubmitHandle handle{ m_pGfxImmediateCommands->Submit(*m_CurrentCommandBuffer.GetBufferWrapper()) };
 
+	// Submits since the last frame, setup ones included, go out together. Present needs its semaphore's signal submitted
 	if (present)
 	{
-		const auto result{ m_pGfxSwapchain->Present(m_pGfxImmediateCommands->AcquireLastSubmitSemaphore()) };
+		m_pGfxImmediateCommands->FlushSubmits();
+
+		// Headless has no present to consume the last submit semaphore, leave it for the next submit to wait on
+		const VkSemaphore presentSemaphore{ m_pGfxSwapchain->IsHeadless() ? VK_NULL_HANDLE : m_pGfxImmediateCommands->AcquireLastSubmitSemaphore() };
+		const auto result{ m_pGfxSwapchain->Present(presentSemaphore) };
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 			m_pGfxSwapchain->RecreateSwapchain();
 
@@ -319,29 +514,33 @@ BufferHandle GraphicsAPI::AcquireBuffer(const BufferDesc& desc)
 
 	const VkMemoryPropertyFlags memFlags{ StorageTypeToVkMemoryPropertyFlags(desc.m_Storage) };
 
-#define ENSURE_BUFFER_SIZE(flag, maxSize)											   \
-    if (usageFlags & (flag))														   \
-	{																				   \
-		if (!desc.m_Size <= (maxSize))												   \
-		{																			   \
-			Logger::Get().LogError(std::format(L"Buffer size exceeds limit ", #flag)); \
-			return {};                                                                 \
-		}                                                                              \
+#define ENSURE_BUFFER_SIZE(flag, maxSize)																\
+	if (usageFlags & (flag))																		\
+	{																								\
+		if (desc.m_Size > (maxSize))																\
+		{																							\
+			Logger::Get().LogError(std::format(L"Buffer size exceeds limit {}.", L## #flag));		\
+			return {};																				\
+		}																							\
 	}
 
 	const VkPhysicalDeviceLimits& limits{m_pGfxDevice->GetPhysicalDeviceProperties().limits };
 
 	ENSURE_BUFFER_SIZE(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, limits.maxUniformBufferRange);
-	ENSURE_BUFFER_SIZE(VK_BUFFER_USAGE_FLAG_BITS_MAX_ENUM, limits.maxStorageBufferRange);
+	ENSURE_BUFFER_SIZE(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, limits.maxStorageBufferRange);
 
 #undef ENSURE_BUFFER_SIZE
 
-	GfxBuffer buffer{
-		.bufferSize_ = desc.m_Size,
-		.vkUsageFlags_ = usageFlags,
-		.vkMemFlags_ = memFlags,
-		.m_pGraphicsAPI = this
-	};
+	GfxBuffer buffer{};
+	buffer.m_BufferSize = desc.m_Size;
+	buffer.m_VkUsageFlags = usageFlags;
+	buffer.m_VkMemFlags = memFlags;
+	buffer.m_pGraphicsAPI = this;
+
+	// Concurrent sharing can be slower on some hardware, only the buffers both queues touch use it
+	const DeviceQueueInfo queueInfo{ m_pGfxDevice->GetDeviceQueueInfo() };
+	const std::array<uint32_t, 2> sharedFamilies{ queueInfo.m_GraphicsFamily, queueInfo.m_ComputeFamily };
+	const bool isConcurrent{ desc.m_IsSharedWithAsyncCompute && IsAsyncComputeSupported() };
 
 	const VkBufferCreateInfo ci{
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -349,9 +548,9 @@ BufferHandle GraphicsAPI::AcquireBuffer(const BufferDesc& desc)
 		.flags = 0,
 		.size = desc.m_Size,
 		.usage = usageFlags,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-		.queueFamilyIndexCount = 0,
-		.pQueueFamilyIndices = nullptr,
+		.sharingMode = isConcurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = isConcurrent ? static_cast<uint32_t>(sharedFamilies.size()) : 0u,
+		.pQueueFamilyIndices = isConcurrent ? sharedFamilies.data() : nullptr,
 	};
 
 	const auto& device{ m_pGfxDevice->GetDevice() };
@@ -398,28 +597,19 @@ BufferHandle GraphicsAPI::AcquireBuffer(const BufferDesc& desc)
 
 		VkMemoryRequirements requirements{};
 		vkGetBufferMemoryRequirements(device, buffer.m_VkBuffer, &requirements);
-		if (requirements.memoryTypeBits & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
-			buffer.m_IsCoherentMemory = true;
 
-		constexpr VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
-			.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR,
-		};
-
-		const VkMemoryAllocateInfo ai{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.pNext = &memoryAllocateFlagsInfo,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = m_pGfxDevice->FindMemoryType(requirements.memoryTypeBits, memFlags),
-		};
+		buffer.m_Allocation = m_pGfxDevice->GetMemoryAllocator()->Allocate(requirements, memFlags, true, false, VK_NULL_HANDLE, buffer.m_VkBuffer);
+		HandleVkResult(vkBindBufferMemory(device, buffer.m_VkBuffer, buffer.m_Allocation.m_VkMemory, buffer.m_Allocation.m_Offset));
 
-		HandleVkResult(vkAllocateMemory(device, &ai, nullptr, &buffer.m_VkMemory));
-		HandleVkResult(vkBindBufferMemory(device, buffer.m_VkBuffer, buffer.m_VkMemory, 0));
-
-		if (memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
-			HandleVkResult(vkMapMemory(device, buffer.m_VkMemory, 0, buffer.m_BufferSize, 0, &buffer.m_pMappedPtr));
+		// Host visible blocks are persistently mapped by the allocator
+		buffer.m_pMappedPtr = buffer.m_Allocation.m_pMappedPtr;
+		buffer.m_IsCoherentMemory = buffer.m_Allocation.m_IsCoherent;
 	//}
 
+	// Device local buffers are filled by the caller through the staging ring
+	if (desc.m_Data && buffer.m_pMappedPtr)
+		buffer.WriteBufferData(0, desc.m_Size, desc.m_Data);
+
 	assert(buffer.m_VkBuffer != VK_NULL_HANDLE);
 
 	HandleVkResult(m_pGfxDevice->SetVkObjectName(VK_OBJECT_TYPE_BUFFER, reinterpret_cast<uint64_t>(buffer.m_VkBuffer), desc.m_DebugName));
@@ -456,13 +646,10 @@ void GraphicsAPI::Destroy(BufferHandle handle)
 	//}
 	//else
 	//{
-		if (buffer->m_pMappedPtr)
-			vkUnmapMemory(m_pGfxDevice->GetDevice(), buffer->m_VkMemory);
-		
-		AddDeferredTask(std::packaged_task<void()>([device = m_pGfxDevice->GetDevice(), buffer = buffer->m_VkBuffer, memory = buffer->m_VkMemory]()
+		AddDeferredTask(std::packaged_task<void()>([device = m_pGfxDevice->GetDevice(), allocator = m_pGfxDevice->GetMemoryAllocator(), buffer = buffer->m_VkBuffer, allocation = buffer->m_Allocation]()
 		{
 			vkDestroyBuffer(device, buffer, nullptr);
-			vkFreeMemory(device, memory, nullptr);
+			allocator->Free(allocation);
 		}));
 	//}
 
@@ -559,18 +746,17 @@ TextureHandle GraphicsAPI::AcquireTexture(const TextureDesc& desc)
 	assert(vkExtent.height > 0);
 	assert(vkExtent.depth > 0);
 
-	GfxImage image{
-		.m_VkUsageFlags = usageFlags,
-		.m_VkExtent = vkExtent,
-		.m_VkType = vkImageType,
-		.m_VkImageFormat = vkFormat,
-		.m_VkSamples = vkSamples,
-		.m_NumLevels = numLevels,
-		.m_NumLayers = numLayers,
-		.m_IsDepthFormat = GfxImage::IsDepthFormat(vkFormat),
-		.m_IsStencilFormat = GfxImage::IsStencilFormat(vkFormat),
-		.m_pGraphicsAPI = this
-	};
+	GfxImage image{};
+	image.m_VkUsageFlags = usageFlags;
+	image.m_VkExtent = vkExtent;
+	image.m_VkType = vkImageType;
+	image.m_VkImageFormat = vkFormat;
+	image.m_VkSamples = vkSamples;
+	image.m_NumLevels = numLevels;
+	image.m_NumLayers = numLayers;
+	image.m_IsDepthFormat = GfxImage::IsDepthFormat(vkFormat);
+	image.m_IsStencilFormat = GfxImage::IsStencilFormat(vkFormat);
+	image.m_pGraphicsAPI = this;
 
 	if (hasDebugName)
 		snprintf(image.m_DebugName, sizeof(image.m_DebugName) - 1, "%s", desc.m_DebugName);
@@ -615,8 +801,13 @@ TextureHandle GraphicsAPI::AcquireTexture(const TextureDesc& desc)
 		const auto& device{ m_pGfxDevice->GetDevice() };
 		HandleVkResult(vkCreateImage(device, &ci, nullptr, &image.m_VkImage));
 
+		VkMemoryDedicatedRequirements dedicatedRequirements{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS
+		};
+
 		VkMemoryRequirements2 memRequirements{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2
+			.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+			.pNext = &dedicatedRequirements
 		};
 
 		const VkImage img = image.m_VkImage;
@@ -628,29 +819,18 @@ TextureHandle GraphicsAPI::AcquireTexture(const TextureDesc& desc)
 
 		vkGetImageMemoryRequirements2(device, &imgRequirements, &memRequirements);
 
-		const VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
-			.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR,
-		};
-
-		const VkMemoryAllocateInfo allocateInfo{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.pNext = &memoryAllocateFlagsInfo,
-			.allocationSize = memRequirements.memoryRequirements.size,
-			.memoryTypeIndex = m_pGfxDevice->FindMemoryType(memRequirements.memoryRequirements.memoryTypeBits, memoryFlags),
-		};
-
-		vkAllocateMemory(device, &allocateInfo, nullptr, &image.m_VkMemory);
+		image.m_Allocation = m_pGfxDevice->GetMemoryAllocator()->Allocate(memRequirements.memoryRequirements, memoryFlags, false,
+			dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation, img);
 
 		const VkBindImageMemoryInfo bindInfo{
 			.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
 			.image = image.m_VkImage,
-			.memory = image.m_VkMemory
+			.memory = image.m_Allocation.m_VkMemory,
+			.memoryOffset = image.m_Allocation.m_Offset
 		};
 		HandleVkResult(vkBindImageMemory2(device, 1, &bindInfo));
 
-		if (memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
-			HandleVkResult(vkMapMemory(device, image.m_VkMemory, 0, VK_WHOLE_SIZE, 0, &image.m_MappedPtr));
+		image.m_MappedPtr = image.m_Allocation.m_pMappedPtr;
 	//}
 
 	HandleVkResult(m_pGfxDevice->SetVkObjectName(VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(image.m_VkImage), debugNameImage));
@@ -756,14 +936,10 @@ void GraphicsAPI::Destroy(TextureHandle handle)
 	}
 	else
 	{*/
-	if (image->m_MappedPtr)
-		vkUnmapMemory(device, image->m_VkMemory);
-
-	AddDeferredTask(std::packaged_task<void()>([device = device, image = image->m_VkImage, memory = image->m_VkMemory]()
+	AddDeferredTask(std::packaged_task<void()>([device = device, allocator = m_pGfxDevice->GetMemoryAllocator(), image = image->m_VkImage, allocation = image->m_Allocation]()
 		{
 			vkDestroyImage(device, image, nullptr);
-			if (memory != VK_NULL_HANDLE)
-				vkFreeMemory(device, memory, nullptr);
+			allocator->Free(allocation);
 		}));
 	/*}*/
 
@@ -775,9 +951,147 @@ GfxImage* GraphicsAPI::GetTexture(TextureHandle handle) const
 	return m_TexturesPool.Get(handle);
 }
 
+QueryPoolHandle GraphicsAPI::AcquireQueryPool(const QueryPoolDesc& desc)
+{
+	assert(desc.m_NumQueries && L"A query pool needs at least one query.");
+
+	GfxQueryPool queryPool{};
+	queryPool.m_NumQueries = desc.m_NumQueries;
+
+	const VkQueryPoolCreateInfo ci{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = desc.m_NumQueries,
+		.pipelineStatistics = 0,
+	};
+
+	HandleVkResult(vkCreateQueryPool(m_pGfxDevice->GetDevice(), &ci, nullptr, &queryPool.m_VkQueryPool));
+
+	if (desc.m_DebugName)
+		HandleVkResult(m_pGfxDevice->SetVkObjectName(VK_OBJECT_TYPE_QUERY_POOL, reinterpret_cast<uint64_t>(queryPool.m_VkQueryPool), desc.m_DebugName));
+
+	return m_QueryPoolsPool.Add(std::move(queryPool));
+}
+
+void GraphicsAPI::Destroy(QueryPoolHandle handle)
+{
+	const GfxQueryPool* queryPool{ m_QueryPoolsPool.Get(handle) };
+
+	if (!queryPool)
+		return;
+
+	AddDeferredTask(std::packaged_task<void()>([device = m_pGfxDevice->GetDevice(), pool = queryPool->m_VkQueryPool]()
+	{
+		vkDestroyQueryPool(device, pool, nullptr);
+	}));
+
+	m_QueryPoolsPool.Remove(handle);
+}
+
+GfxQueryPool* GraphicsAPI::GetQueryPool(QueryPoolHandle handle) const
+{
+	return m_QueryPoolsPool.Get(handle);
+}
+
+bool GraphicsAPI::GetQueryPoolResults(QueryPoolHandle handle, uint32_t firstQuery, uint32_t queryCount, uint64_t* pResults) const
+{
+	const GfxQueryPool* queryPool{ m_QueryPoolsPool.Get(handle) };
+	assert(queryPool && L"Invalid query pool handle.");
+	assert(firstQuery + queryCount <= queryPool->m_NumQueries && L"Query range out of bounds.");
+
+	const VkResult result{ vkGetQueryPoolResults(m_pGfxDevice->GetDevice(), queryPool->m_VkQueryPool, firstQuery, queryCount,
+												  queryCount * sizeof(uint64_t), pResults, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) };
+
+	if (result == VK_NOT_READY)
+		return false;
+
+	HandleVkResult(result);
+	return true;
+}
+
+ComputePipelineHandle GraphicsAPI::AcquireComputePipeline(const ComputePipelineDesc& desc)
+{
+	if (!desc.m_ShaderPath || desc.m_NumSetLayouts > ComputePipelineDesc::sk_MaxSetLayouts)
+	{
+		Logger::Get().LogError(L"Invalid compute pipeline description.");
+		return {};
+	}
+
+	const auto& device{ m_pGfxDevice->GetDevice() };
+	const ShaderModule& computeShaderModule{ m_pShaderModulePool->GetShaderModule(desc.m_ShaderPath) };
+
+	GfxComputePipeline pipeline{};
+	pipeline.m_PushConstantsSize = desc.m_PushConstantsSize;
+
+	const VkPushConstantRange pushConstantRange
+	{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = desc.m_PushConstantsSize,
+	};
+
+	const VkPipelineLayoutCreateInfo pipelineLayoutInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = desc.m_NumSetLayouts,
+		.pSetLayouts = desc.m_SetLayouts,
+		.pushConstantRangeCount = desc.m_PushConstantsSize > 0 ? 1u : 0u,
+		.pPushConstantRanges = &pushConstantRange,
+	};
+
+	HandleVkResult(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipeline.m_VkPipelineLayout));
+
+	const VkComputePipelineCreateInfo pipelineInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = computeShaderModule.m_ShaderModule,
+			.pName = desc.m_EntryPoint,
+		},
+		.layout = pipeline.m_VkPipelineLayout,
+	};
+
+	HandleVkResult(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.m_VkPipeline));
+
+	if (desc.m_DebugName && *desc.m_DebugName)
+	{
+		char debugNameLayout[256]{ 0 };
+		snprintf(debugNameLayout, sizeof(debugNameLayout) - 1, "Pipeline Layout: %s", desc.m_DebugName);
+		HandleVkResult(m_pGfxDevice->SetVkObjectName(VK_OBJECT_TYPE_PIPELINE, reinterpret_cast<uint64_t>(pipeline.m_VkPipeline), desc.m_DebugName));
+		HandleVkResult(m_pGfxDevice->SetVkObjectName(VK_OBJECT_TYPE_PIPELINE_LAYOUT, reinterpret_cast<uint64_t>(pipeline.m_VkPipelineLayout), debugNameLayout));
+	}
+
+	return m_ComputePipelinesPool.Add(std::move(pipeline));
+}
+
+void GraphicsAPI::Destroy(ComputePipelineHandle handle)
+{
+	const GfxComputePipeline* pipeline{ m_ComputePipelinesPool.Get(handle) };
+
+	if (!pipeline)
+		return;
+
+	AddDeferredTask(std::packaged_task<void()>([device = m_pGfxDevice->GetDevice(), vkPipeline = pipeline->m_VkPipeline, layout = pipeline->m_VkPipelineLayout]()
+	{
+		vkDestroyPipeline(device, vkPipeline, nullptr);
+		vkDestroyPipelineLayout(device, layout, nullptr);
+	}));
+
+	m_ComputePipelinesPool.Remove(handle);
+}
+
+GfxComputePipeline* GraphicsAPI::GetComputePipeline(ComputePipelineHandle handle) const
+{
+	return m_ComputePipelinesPool.Get(handle);
+}
+
 void GraphicsAPI::ProcessDeferredTasks()
 {
-	while (m_DeferredTasks.empty() && m_pGfxImmediateCommands->IsReady(m_DeferredTasks.front().m_Handle, true))
+	while (!m_DeferredTasks.empty() && m_pGfxImmediateCommands->IsReady(m_DeferredTasks.front().m_Handle, true))
 	{
 		m_DeferredTasks.front().m_Task();
 		m_DeferredTasks.pop_front();
@@ -952,6 +1266,367 @@ void GraphicsAPI::CreateGraphicsPipeline()
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
 	HandleVkResult(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkGraphicsPipeline));
+
+	// Same shaders, only the vertex fetch differs
+	const auto& packedBindingDescription = PackedVertex3D::GetBindingDescription();
+	const auto& packedAttributeDescriptions = PackedVertex3D::GetAttributeDescriptions();
+
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(packedAttributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = &packedBindingDescription;
+	vertexInputInfo.pVertexAttributeDescriptions = packedAttributeDescriptions.data();
+
+	HandleVkResult(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkPackedGraphicsPipeline));
+}
+
+void GraphicsAPI::CreateCullPipeline()
+{
+	// Same set layout as the graphics pipelines at set 0, the depth pyramid at set 1
+	const ComputePipelineDesc desc
+	{
+		.m_ShaderPath = L"Shaders/CullObjects_CS.spv",
+		.m_SetLayouts = { m_VkDescriptorSetLayout, m_pGfxDepthPyramid->GetDescriptorSetLayout() },
+		.m_NumSetLayouts = 2,
+		.m_PushConstantsSize = sizeof(CullPushConstants),
+		.m_DebugName = "GraphicsAPI::m_CullPipeline",
+	};
+
+	m_CullPipeline = AcquireComputePipeline(desc);
+}
+
+void GraphicsAPI::CreateGeometryArenas()
+{
+	m_GeometryArenas[static_cast<size_t>(VertexFormat::Full)] = std::make_unique<GfxGeometryArena>(this, static_cast<uint32_t>(sizeof(Vertex3D)), sk_GeometryArenaVertexCapacity, sk_GeometryArenaIndexCapacity, "Buffer: geometry arena (full)");
+	m_GeometryArenas[static_cast<size_t>(VertexFormat::Packed)] = std::make_unique<GfxGeometryArena>(this, static_cast<uint32_t>(sizeof(PackedVertex3D)), sk_GeometryArenaVertexCapacity, sk_GeometryArenaIndexCapacity, "Buffer: geometry arena (packed)");
+}
+
+void GraphicsAPI::BuildFrameGraph()
+{
+	PROFILE_FUNCTION();
+
+	GfxRenderGraph& graph{ *m_pGfxRenderGraph };
+	const auto currentFrame{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+
+	// Acquired before recording, the passes render into the image's framebuffer
+	const auto color{ graph.ImportImage(m_pGfxSwapchain->AcquireImage()) };
+	const auto depth{ graph.ImportImage(m_pGfxSwapchain->GetCurrentDepthImage()) };
+
+	if (m_OcclusionCulling)
+		m_pGfxDepthPyramid->Resize(m_pGfxSwapchain->GetSwapChainExtent());
+
+	const auto depthPyramid{ graph.ImportImage(m_pGfxDepthPyramid->GetImage()) };
+
+	constexpr StageAccess cullReadWrite{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+	constexpr StageAccess cullWrite{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+	constexpr StageAccess cullRead{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT };
+	constexpr StageAccess pyramidRead{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+	constexpr StageAccess indirectRead{ VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT };
+
+	const bool isGpuDriven{ m_CulledObjectCount > 0 };
+	GfxRenderGraph::ResourceID drawCounts{};
+	GfxRenderGraph::ResourceID drawCommands{};
+	GfxRenderGraph::ResourceID lateObjects{};
+
+	if (isGpuDriven)
+	{
+		drawCounts = graph.ImportBuffer(m_BuffersPool.Get(m_DrawCountBuffers[currentFrame])->m_VkBuffer);
+		drawCommands = graph.ImportBuffer(m_BuffersPool.Get(m_DrawCommandBuffers[currentFrame])->m_VkBuffer);
+		lateObjects = graph.ImportBuffer(m_BuffersPool.Get(m_LateObjectBuffers[currentFrame])->m_VkBuffer);
+	}
+
+	// Already culled on the compute queue, the frame's submit waits on it
+	if (isGpuDriven && m_AsyncCullTimelineValue == 0)
+	{
+		graph.AddPass("ClearDrawCounts", [this, currentFrame](const GfxCommandBuffer& cmdBuffer)
+		{
+			vkCmdFillBuffer(cmdBuffer.GetCmdBuffer(), m_BuffersPool.Get(m_DrawCountBuffers[currentFrame])->m_VkBuffer, 0, VK_WHOLE_SIZE, 0);
+		}).Write(drawCounts, StageAccess{ VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT });
+
+		auto cullPass{ graph.AddPass("CullObjects", [this](GfxCommandBuffer& cmdBuffer) { DispatchCull(cmdBuffer, 0); }) };
+		cullPass.Write(drawCounts, cullReadWrite).Write(drawCommands, cullWrite);
+
+		if (m_OcclusionCulling)
+			cullPass.Write(lateObjects, cullWrite).Read(depthPyramid, VK_IMAGE_LAYOUT_GENERAL, pyramidRead);
+	}
+
+	auto mainPass{ graph.AddPass("MainPass", [this](const GfxCommandBuffer& cmdBuffer) { RecordMainPass(cmdBuffer); }) };
+	mainPass.Write(color, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true).Write(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true);
+
+	if (isGpuDriven)
+		mainPass.Read(drawCounts, indirectRead).Read(drawCommands, indirectRead);
+
+	if (m_OcclusionCulling)
+	{
+		// The next frame's first culling phase tests against it
+		graph.AddPass("DepthPyramid", [this, depth](const GfxCommandBuffer& cmdBuffer)
+		{
+			m_pGfxDepthPyramid->Build(cmdBuffer, m_pGfxRenderGraph->GetImage(depth)->m_ImageView);
+		})
+			.Read(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, pyramidRead)
+			.Write(depthPyramid, VK_IMAGE_LAYOUT_GENERAL, true, StageAccess{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT })
+			.SideEffect();
+
+		if (isGpuDriven)
+		{
+			graph.AddPass("CullDisoccluded", [this](GfxCommandBuffer& cmdBuffer) { DispatchCull(cmdBuffer, 1); })
+				.Read(lateObjects, cullRead)
+				.Read(depthPyramid, VK_IMAGE_LAYOUT_GENERAL, pyramidRead)
+				.Write(drawCounts, cullReadWrite)
+				.Write(drawCommands, cullWrite);
+		}
+
+		auto latePass{ graph.AddPass("LatePass", [this](const GfxCommandBuffer& cmdBuffer) { RecordLatePass(cmdBuffer); }) };
+		latePass.Write(color, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL).Write(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+		if (isGpuDriven)
+			latePass.Read(drawCounts, indirectRead).Read(drawCommands, indirectRead);
+	}
+
+	// Nothing to record, the graph's barrier moves the image to the present layout
+	graph.AddPass("Present", [](const GfxCommandBuffer&) {})
+		.Read(color, m_pGfxSwapchain->GetPresentLayout())
+		.SideEffect();
+}
+
+void GraphicsAPI::RecordMainPass(const GfxCommandBuffer& gfxCmdBuffer)
+{
+	PROFILE_FUNCTION();
+
+	const VkCommandBuffer cmdBuffer{ gfxCmdBuffer.GetCmdBuffer() };
+	const uint32_t chunkCount{ std::min(m_pGfxSecondaryCommands->GetSlotCount(), m_MainPassDrawCount / sk_MinDrawsPerRecordingChunk) };
+
+	if (chunkCount < 2)
+	{
+		BeginSwapchainRenderPass(cmdBuffer, m_pGfxSwapchain->GetRenderPass());
+
+		DrawRecorder recorder{ .m_CmdBuffer = cmdBuffer };
+		RecordMainPassDraws(recorder, 0, m_MainPassDrawCount);
+		AddRecorderCounts(recorder);
+
+		vkCmdEndRenderPass(cmdBuffer);
+		return;
+	}
+
+	// The subpass only executes secondary command buffers, the GPU-driven draws go in the first one
+	BeginSwapchainRenderPass(cmdBuffer, m_pGfxSwapchain->GetRenderPass(), VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+	const VkCommandBufferInheritanceInfo inheritanceInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.renderPass = m_pGfxSwapchain->GetRenderPass(),
+		.subpass = 0,
+		.framebuffer = m_pGfxSwapchain->GetCurrentFrameBuffer(),
+	};
+
+	m_DrawRecorders.assign(chunkCount, DrawRecorder{});
+
+	// Chunk i is always recorded into slot i, each slot's pool is only touched by the thread running its chunk
+	JobSystem::Get().ParallelFor(chunkCount, [this, chunkCount, &inheritanceInfo](uint32_t chunk)
+	{
+		PROFILE_SCOPE("RecordMainPassChunk");
+
+		DrawRecorder& recorder{ m_DrawRecorders[chunk] };
+		recorder.m_CmdBuffer = m_pGfxSecondaryCommands->Begin(chunk, inheritanceInfo);
+
+		const uint32_t firstDraw{ static_cast<uint32_t>(static_cast<uint64_t>(m_MainPassDrawCount) * chunk / chunkCount) };
+		const uint32_t lastDraw{ static_cast<uint32_t>(static_cast<uint64_t>(m_MainPassDrawCount) * (chunk + 1) / chunkCount) };
+		RecordMainPassDraws(recorder, firstDraw, lastDraw);
+
+		HandleVkResult(vkEndCommandBuffer(recorder.m_CmdBuffer));
+	});
+
+	std::vector<VkCommandBuffer> secondaryCmdBuffers{};
+	secondaryCmdBuffers.reserve(m_DrawRecorders.size());
+	for (const DrawRecorder& recorder : m_DrawRecorders)
+	{
+		secondaryCmdBuffers.emplace_back(recorder.m_CmdBuffer);
+		AddRecorderCounts(recorder);
+	}
+
+	vkCmdExecuteCommands(cmdBuffer, static_cast<uint32_t>(secondaryCmdBuffers.size()), secondaryCmdBuffers.data());
+
+	vkCmdEndRenderPass(cmdBuffer);
+}
+
+void GraphicsAPI::RecordLatePass(const GfxCommandBuffer& gfxCmdBuffer)
+{
+	const VkCommandBuffer cmdBuffer{ gfxCmdBuffer.GetCmdBuffer() };
+
+	// Nothing bound by the main pass can be relied on, it may have been recorded in secondary command buffers
+	BeginSwapchainRenderPass(cmdBuffer, m_pGfxSwapchain->GetLoadRenderPass());
+
+	DrawRecorder recorder{ .m_CmdBuffer = cmdBuffer };
+	SetSwapchainViewport(cmdBuffer);
+	DrawCullPhase(recorder, 1);
+	AddRecorderCounts(recorder);
+
+	vkCmdEndRenderPass(cmdBuffer);
+}
+
+void GraphicsAPI::BeginSwapchainRenderPass(VkCommandBuffer cmdBuffer, VkRenderPass renderPass, VkSubpassContents contents) const
+{
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = m_pGfxSwapchain->GetCurrentFrameBuffer();
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = m_pGfxSwapchain->GetSwapChainExtent();
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, contents);
+}
+
+void GraphicsAPI::SetSwapchainViewport(VkCommandBuffer cmdBuffer) const
+{
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(m_pGfxSwapchain->Width());
+	viewport.height = static_cast<float>(m_pGfxSwapchain->Height());
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_pGfxSwapchain->GetSwapChainExtent();
+	
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+}
+
+void GraphicsAPI::RecordMainPassDraws(DrawRecorder& recorder, uint32_t firstDraw, uint32_t lastDraw) const
+{
+	// Secondary command buffers inherit no dynamic state, every range sets its own
+	SetSwapchainViewport(recorder.m_CmdBuffer);
+
+	if (firstDraw == 0)
+		DrawCullPhase(recorder, 0);
+
+	if (m_MainPassDraws && firstDraw < lastDraw)
+		m_MainPassDraws(recorder, firstDraw, lastDraw);
+}
+
+void GraphicsAPI::AddRecorderCounts(const DrawRecorder& recorder)
+{
+	m_FrameDrawCount += recorder.m_DrawCount;
+	m_FrameBindCount += recorder.m_BindCount;
+}
+
+void GraphicsAPI::DispatchCull(GfxCommandBuffer& cmdBuffer, uint32_t phase)
+{
+	const auto currentFrame{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+
+	CullPushConstants pushConstants{};
+	const auto frustumPlanes{ GetFrustumPlanes() };
+	std::ranges::copy(frustumPlanes, pushConstants.m_FrustumPlanes);
+	pushConstants.m_ObjectCount = m_CulledObjectCount;
+	pushConstants.m_MaxDrawsPerFormat = m_ObjectBufferCapacities[currentFrame];
+	pushConstants.m_Phase = phase;
+	pushConstants.m_OcclusionCulling = m_OcclusionCulling && m_pGfxDepthPyramid->IsValid() ? 1 : 0;
+
+	const std::array<VkDescriptorSet, 2> descriptorSets{ m_VkDescriptorSets[currentFrame], m_pGfxDepthPyramid->GetDescriptorSet() };
+
+	// The second phase sees at most as many objects as the first, the extra threads exit on the held back count
+	cmdBuffer.BindComputePipeline(m_CullPipeline);
+	cmdBuffer.BindComputeDescriptorSets(descriptorSets.data(), static_cast<uint32_t>(descriptorSets.size()));
+	cmdBuffer.PushConstants(pushConstants);
+	cmdBuffer.DispatchThreadGroups(Dimensions{ .m_Width = (m_CulledObjectCount + sk_CullGroupSize - 1) / sk_CullGroupSize });
+}
+
+void GraphicsAPI::SubmitAsyncCull()
+{
+	PROFILE_FUNCTION();
+
+	const auto currentFrame{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+
+	// The slot's previous graphics submit, the last one reading these buffers, retired in BeginFrame()
+	GfxCommandBuffer cmdBuffer{ this, m_pGfxComputeCommands.get() };
+	cmdBuffer.FillBuffer(m_BuffersPool.Get(m_DrawCountBuffers[currentFrame]), 0, VK_WHOLE_SIZE, 0);
+	DispatchCull(cmdBuffer, 0);
+
+	m_pGfxComputeCommands->Submit(*cmdBuffer.GetBufferWrapper());
+	m_pGfxComputeCommands->FlushSubmits();
+	m_AsyncCullTimelineValue = m_pGfxComputeCommands->GetLastSubmitTimelineValue();
+}
+
+void GraphicsAPI::DrawCullPhase(DrawRecorder& recorder, uint32_t phase) const
+{
+	if (m_CulledObjectCount == 0)
+		return;
+
+	const auto currentFrame{ m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight };
+	const GfxBuffer* pDrawCommandBuffer{ m_BuffersPool.Get(m_DrawCommandBuffers[currentFrame]) };
+	const GfxBuffer* pDrawCountBuffer{ m_BuffersPool.Get(m_DrawCountBuffers[currentFrame]) };
+	const uint32_t maxDrawCount{ m_ObjectBufferCapacities[currentFrame] };
+
+	// The decode of packed positions is folded into the instance transforms
+	constexpr XMFLOAT3 identityOffset{ 0.0f, 0.0f, 0.0f };
+	constexpr XMFLOAT3 identityScale{ 1.0f, 1.0f, 1.0f };
+
+	for (uint32_t format{}; format < g_VertexFormatCount; ++format)
+	{
+		const GfxGeometryArena* pArena{ m_GeometryArenas[format].get() };
+		BindDrawState(recorder, static_cast<VertexFormat>(format), m_BuffersPool.Get(pArena->GetVertexBuffer())->m_VkBuffer, m_BuffersPool.Get(pArena->GetIndexBuffer())->m_VkBuffer);
+		PushDrawConstants(recorder, identityOffset, identityScale);
+
+		const uint32_t section{ phase * g_VertexFormatCount + format };
+		vkCmdDrawIndexedIndirectCount(recorder.m_CmdBuffer, pDrawCommandBuffer->m_VkBuffer, sizeof(VkDrawIndexedIndirectCommand) * maxDrawCount * section,
+			pDrawCountBuffer->m_VkBuffer, sizeof(uint32_t) * section, maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		++recorder.m_DrawCount;
+	}
+}
+
+void GraphicsAPI::BindDrawState(DrawRecorder& recorder, VertexFormat vertexFormat, VkBuffer vertexBuffer, VkBuffer indexBuffer) const
+{
+	// Both pipelines share the layout, descriptor sets and push constants stay bound across the switch
+	const VkPipeline pipeline{ vertexFormat == VertexFormat::Packed ? m_VkPackedGraphicsPipeline : m_VkGraphicsPipeline };
+	if (pipeline != recorder.m_BoundVkPipeline)
+	{
+		vkCmdBindPipeline(recorder.m_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		recorder.m_BoundVkPipeline = pipeline;
+		++recorder.m_BindCount;
+	}
+
+	const VkDescriptorSet descriptorSet{ m_VkDescriptorSets[m_pGfxSwapchain->GetCurrentFrameIndex() % GfxSwapchain::sk_MaxFramesInFlight] };
+	if (descriptorSet != recorder.m_BoundVkDescriptorSet)
+	{
+		vkCmdBindDescriptorSets(recorder.m_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkGraphicsPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		recorder.m_BoundVkDescriptorSet = descriptorSet;
+		++recorder.m_BindCount;
+	}
+
+	if (vertexBuffer != recorder.m_BoundVkVertexBuffer)
+	{
+		constexpr VkDeviceSize offset{ 0 };
+		vkCmdBindVertexBuffers(recorder.m_CmdBuffer, 0, 1, &vertexBuffer, &offset);
+		recorder.m_BoundVkVertexBuffer = vertexBuffer;
+		++recorder.m_BindCount;
+	}
+
+	if (indexBuffer != recorder.m_BoundVkIndexBuffer)
+	{
+		vkCmdBindIndexBuffer(recorder.m_CmdBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		recorder.m_BoundVkIndexBuffer = indexBuffer;
+		++recorder.m_BindCount;
+	}
+}
+
+void GraphicsAPI::PushDrawConstants(DrawRecorder& recorder, const XMFLOAT3& positionOffset, const XMFLOAT3& positionScale) const
+{
+	// Only packed meshes carry a decode, runs of full precision meshes share the identity
+	if (recorder.m_HasPushedConstants
+		&& XMVector3Equal(XMLoadFloat3(&positionOffset), XMLoadFloat3(&recorder.m_PushedConstants.m_PositionOffset))
+		&& XMVector3Equal(XMLoadFloat3(&positionScale), XMLoadFloat3(&recorder.m_PushedConstants.m_PositionScale)))
+		return;
+
+	recorder.m_PushedConstants = PushConstants{ positionOffset, positionScale };
+	recorder.m_HasPushedConstants = true;
+	vkCmdPushConstants(recorder.m_CmdBuffer, m_VkGraphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &recorder.m_PushedConstants);
 }
 
 void GraphicsAPI::CreateDescriptorSetLayout()
@@ -962,7 +1637,7 @@ void GraphicsAPI::CreateDescriptorSetLayout()
 	uboLayoutBinding.binding = 0;
 	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 	uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
 
 	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
@@ -972,10 +1647,36 @@ void GraphicsAPI::CreateDescriptorSetLayout()
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 
-	const std::array<VkDescriptorSetLayoutBinding, 2> bindings
+	VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+	instanceLayoutBinding.binding = 2;
+	instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceLayoutBinding.descriptorCount = 1;
+	instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	instanceLayoutBinding.pImmutableSamplers = nullptr;
+
+	// GPU-driven culling: objects, draw commands, draw counts and objects held back for the second phase
+	VkDescriptorSetLayoutBinding objectLayoutBinding{ instanceLayoutBinding };
+	objectLayoutBinding.binding = 3;
+	objectLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutBinding drawCommandLayoutBinding{ objectLayoutBinding };
+	drawCommandLayoutBinding.binding = 4;
+
+	VkDescriptorSetLayoutBinding drawCountLayoutBinding{ objectLayoutBinding };
+	drawCountLayoutBinding.binding = 5;
+
+	VkDescriptorSetLayoutBinding lateObjectLayoutBinding{ objectLayoutBinding };
+	lateObjectLayoutBinding.binding = 6;
+
+	const std::array<VkDescriptorSetLayoutBinding, 7> bindings
 	{
 		uboLayoutBinding,
-		samplerLayoutBinding
+		samplerLayoutBinding,
+		instanceLayoutBinding,
+		objectLayoutBinding,
+		drawCommandLayoutBinding,
+		drawCountLayoutBinding,
+		lateObjectLayoutBinding
 	};
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
@@ -995,10 +1696,143 @@ void GraphicsAPI::CreateUniformBuffers()
 		BufferDesc ubDesc{
 			.m_Usage = BufferUsageBits_Uniform,
 			.m_Storage = StorageType_HostVisible,
-			.m_Size = sizeof(PerFrameUBO)
+			.m_Size = sizeof(PerFrameUBO),
+			.m_IsSharedWithAsyncCompute = true
 		};
 		m_PerFrameUBO[i] = AcquireBuffer(ubDesc);
 	}
+
+	m_InstanceBuffers.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	m_InstanceBufferCapacities.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	for (uint32_t i{}; i < GfxSwapchain::sk_MaxFramesInFlight; ++i)
+		CreateInstanceBuffer(i, sk_MinInstanceBufferCapacity);
+
+	m_ObjectBuffers.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	m_DrawCommandBuffers.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	m_DrawCountBuffers.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	m_LateObjectBuffers.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	m_ObjectBufferCapacities.resize(GfxSwapchain::sk_MaxFramesInFlight);
+	for (uint32_t i{}; i < GfxSwapchain::sk_MaxFramesInFlight; ++i)
+	{
+		const BufferDesc countDesc{
+			.m_Usage = BufferUsageBits_Storage | BufferUsageBits_Indirect,
+			.m_Storage = StorageType_Device,
+			.m_Size = sizeof(uint32_t) * (sk_LateObjectCountIndex + 1),
+			.m_IsSharedWithAsyncCompute = true
+		};
+		m_DrawCountBuffers[i] = AcquireBuffer(countDesc);
+
+		CreateObjectBuffers(i, sk_MinInstanceBufferCapacity);
+	}
+}
+
+void GraphicsAPI::CreateInstanceBuffer(size_t frameIndex, uint32_t capacity)
+{
+	const BufferDesc sbDesc{
+		.m_Usage = BufferUsageBits_Storage,
+		.m_Storage = StorageType_HostVisible,
+		.m_Size = sizeof(InstanceData) * capacity,
+		.m_IsSharedWithAsyncCompute = true
+	};
+	m_InstanceBuffers[frameIndex] = AcquireBuffer(sbDesc);
+	m_InstanceBufferCapacities[frameIndex] = capacity;
+
+	// Descriptor sets are created after the first buffers, they pick them up then
+	if (m_VkDescriptorSets.empty())
+		return;
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = m_BuffersPool.Get(m_InstanceBuffers[frameIndex])->m_VkBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_VkDescriptorSets[frameIndex];
+	descriptorWrite.dstBinding = 2;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_pGfxDevice->GetDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
+void GraphicsAPI::CreateObjectBuffers(size_t frameIndex, uint32_t capacity)
+{
+	const BufferDesc objectDesc{
+		.m_Usage = BufferUsageBits_Storage,
+		.m_Storage = StorageType_HostVisible,
+		.m_Size = sizeof(ObjectData) * capacity,
+		.m_IsSharedWithAsyncCompute = true
+	};
+	m_ObjectBuffers[frameIndex] = AcquireBuffer(objectDesc);
+
+	// One section of capacity commands per culling phase and vertex format, drawn with that format's pipeline and arena
+	const BufferDesc commandDesc{
+		.m_Usage = BufferUsageBits_Storage | BufferUsageBits_Indirect,
+		.m_Storage = StorageType_Device,
+		.m_Size = sizeof(VkDrawIndexedIndirectCommand) * capacity * g_VertexFormatCount * sk_CullPhaseCount,
+		.m_IsSharedWithAsyncCompute = true
+	};
+	m_DrawCommandBuffers[frameIndex] = AcquireBuffer(commandDesc);
+
+	const BufferDesc lateObjectDesc{
+		.m_Usage = BufferUsageBits_Storage,
+		.m_Storage = StorageType_Device,
+		.m_Size = sizeof(uint32_t) * capacity,
+		.m_IsSharedWithAsyncCompute = true
+	};
+	m_LateObjectBuffers[frameIndex] = AcquireBuffer(lateObjectDesc);
+	m_ObjectBufferCapacities[frameIndex] = capacity;
+
+	// Descriptor sets are created after the first buffers, they pick them up then
+	if (!m_VkDescriptorSets.empty())
+		WriteObjectDescriptors(frameIndex);
+}
+
+void GraphicsAPI::WriteObjectDescriptors(size_t frameIndex) const
+{
+	const VkDescriptorBufferInfo objectBufferInfo{ m_BuffersPool.Get(m_ObjectBuffers[frameIndex])->m_VkBuffer, 0, VK_WHOLE_SIZE };
+	const VkDescriptorBufferInfo commandBufferInfo{ m_BuffersPool.Get(m_DrawCommandBuffers[frameIndex])->m_VkBuffer, 0, VK_WHOLE_SIZE };
+	const VkDescriptorBufferInfo countBufferInfo{ m_BuffersPool.Get(m_DrawCountBuffers[frameIndex])->m_VkBuffer, 0, VK_WHOLE_SIZE };
+	const VkDescriptorBufferInfo lateObjectBufferInfo{ m_BuffersPool.Get(m_LateObjectBuffers[frameIndex])->m_VkBuffer, 0, VK_WHOLE_SIZE };
+
+	std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+
+	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[0].dstSet = m_VkDescriptorSets[frameIndex];
+	descriptorWrites[0].dstBinding = 3;
+	descriptorWrites[0].dstArrayElement = 0;
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[0].descriptorCount = 1;
+	descriptorWrites[0].pBufferInfo = &objectBufferInfo;
+
+	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[1].dstSet = m_VkDescriptorSets[frameIndex];
+	descriptorWrites[1].dstBinding = 4;
+	descriptorWrites[1].dstArrayElement = 0;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[1].descriptorCount = 1;
+	descriptorWrites[1].pBufferInfo = &commandBufferInfo;
+
+	descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[2].dstSet = m_VkDescriptorSets[frameIndex];
+	descriptorWrites[2].dstBinding = 5;
+	descriptorWrites[2].dstArrayElement = 0;
+	descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[2].descriptorCount = 1;
+	descriptorWrites[2].pBufferInfo = &countBufferInfo;
+
+	descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[3].dstSet = m_VkDescriptorSets[frameIndex];
+	descriptorWrites[3].dstBinding = 6;
+	descriptorWrites[3].dstArrayElement = 0;
+	descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[3].descriptorCount = 1;
+	descriptorWrites[3].pBufferInfo = &lateObjectBufferInfo;
+
+	vkUpdateDescriptorSets(m_pGfxDevice->GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
 void GraphicsAPI::UpdatePerFrameUBO() const
@@ -1007,12 +1841,8 @@ void GraphicsAPI::UpdatePerFrameUBO() const
 
 	PerFrameUBO ubo{};
 
-	static XMFLOAT3 eyePos{ 0.0f, 1.5f, -5.0f };
-	static XMFLOAT3 focusPos{ 0.0f, 0.0f, 0.0f };
-	static XMFLOAT3 upDir{ 0.0f, 1.0f, 0.0f };
-
-	const auto viewMat{ XMMatrixLookAtLH(XMLoadFloat3(&eyePos), XMLoadFloat3(&focusPos), XMLoadFloat3(&upDir)) };
-	const auto projMat{ XMMatrixMultiply(XMMatrixPerspectiveFovLH(XM_PIDIV4, m_pGfxSwapchain->AspectRatio(), 0.1f, 10.0f), XMMatrixScaling(1.0f, -1.0f, 1.0f)) };
+	const auto viewMat{ CalculateViewMatrix() };
+	const auto projMat{ CalculateProjMatrix() };
 	const auto viewProjMat{ viewMat * projMat };
 
 	XMStoreFloat4x4(&ubo.m_ViewMat, viewMat);
@@ -1026,15 +1856,27 @@ void GraphicsAPI::UpdatePerFrameUBO() const
 	currentFrameUBO->WriteBufferData(0, sizeof(PerFrameUBO), &ubo);
 }
 
+XMMATRIX GraphicsAPI::CalculateViewMatrix() const
+{
+	return XMMatrixLookAtLH(XMLoadFloat3(&m_CameraPosition), XMLoadFloat3(&m_CameraFocus), XMLoadFloat3(&m_CameraUp));
+}
+
+XMMATRIX GraphicsAPI::CalculateProjMatrix() const
+{
+	return XMMatrixMultiply(XMMatrixPerspectiveFovLH(m_CameraFovY, m_pGfxSwapchain->AspectRatio(), 0.1f, 10.0f), XMMatrixScaling(1.0f, -1.0f, 1.0f));
+}
+
 void GraphicsAPI::CreateDescriptorPool()
 {
 	const auto& device{ m_pGfxDevice->GetDevice() };
 
-	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	poolSizes[0].descriptorCount = static_cast<uint32_t>(GfxSwapchain::sk_MaxFramesInFlight);
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	poolSizes[1].descriptorCount = static_cast<uint32_t>(GfxSwapchain::sk_MaxFramesInFlight);
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = static_cast<uint32_t>(GfxSwapchain::sk_MaxFramesInFlight) * 5; // Instances, objects, draw commands, draw counts and late objects
 
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -1073,7 +1915,12 @@ void GraphicsAPI::CreateDescriptorSets()
 		imageInfo.imageView = m_pTestModelTextureImage->m_ImageView;
 		imageInfo.sampler = m_VkTestModelTextureSampler;
 
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+		VkDescriptorBufferInfo instanceBufferInfo{};
+		instanceBufferInfo.buffer = m_BuffersPool.Get(m_InstanceBuffers[i])->m_VkBuffer;
+		instanceBufferInfo.offset = 0;
+		instanceBufferInfo.range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
 
 		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorWrites[0].dstSet = m_VkDescriptorSets[i];
@@ -1091,7 +1938,17 @@ void GraphicsAPI::CreateDescriptorSets()
 		descriptorWrites[1].descriptorCount = 1;
 		descriptorWrites[1].pImageInfo = &imageInfo;
 
+		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[2].dstSet = m_VkDescriptorSets[i];
+		descriptorWrites[2].dstBinding = 2;
+		descriptorWrites[2].dstArrayElement = 0;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[2].descriptorCount = 1;
+		descriptorWrites[2].pBufferInfo = &instanceBufferInfo;
+
 		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+		WriteObjectDescriptors(i);
 	}
 }
 
@@ -1109,25 +1966,13 @@ void GraphicsAPI::CreateTextureImage()
 
 	const uint32_t mipLevels{ static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1 };
 
-	// TODO: Move staging buffer to separate pool
-	const BufferDesc sbDesc{
-		.m_Usage = BufferUsageBits_Storage,
-		.m_Storage = StorageType_HostVisible,
-		.m_Size = imageSize,
-		.m_Data = pixels
-	};
+	// Row offsets must stay texel aligned for the copy
+	const StagingRegion staging{ m_pGfxStagingRing->Upload(pixels, imageSize, 4) };
 
 	stbi_image_free(pixels);
 
-	const TextureDesc tDesc{
-		.m_Type = TextureType_2D,
-		.m_Format = R8G8B8A8_SRGB,
-		.m_Dimensions = {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1},
-		.m_Usage = TextureUsageBits_Storage | TextureUsageBits_Sampled,
-		.m_NumMipLevels = mipLevels,
-		.m_Storage = StorageType_Device
-	};
-	m_pTestModelTextureImage = std::make_unique<GfxImage>(this);
+	m_pTestModelTextureImage = std::make_unique<GfxImage>();
+	m_pTestModelTextureImage->m_pGraphicsAPI = this;
 	m_pTestModelTextureImage->m_VkUsageFlags = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 	m_pTestModelTextureImage->m_VkExtent = VkExtent3D{ static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 };
 	m_pTestModelTextureImage->m_VkType = VK_IMAGE_TYPE_2D;
@@ -1143,7 +1988,7 @@ void GraphicsAPI::CreateTextureImage()
 							  m_pTestModelTextureImage->m_VkUsageFlags,
 							  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 							  m_pTestModelTextureImage->m_VkImage,
-							  m_pTestModelTextureImage->m_VkMemory);
+							  m_pTestModelTextureImage->m_Allocation);
 
 	m_pTestModelTextureImage->m_ImageView = m_pTestModelTextureImage->CreateImageView(VK_IMAGE_VIEW_TYPE_2D,
 																					  m_pTestModelTextureImage->m_VkImageFormat,
@@ -1156,10 +2001,11 @@ void GraphicsAPI::CreateTextureImage()
 											   VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS });
 
 	m_pGfxDevice->CopyBufferToImage(cmdBuffer, 
-									stagingBuffer.GetBuffer(),
+									staging.m_VkBuffer,
 									m_pTestModelTextureImage->m_VkImage,
 									m_pTestModelTextureImage->m_VkExtent.width,
-									m_pTestModelTextureImage->m_VkExtent.height);
+									m_pTestModelTextureImage->m_VkExtent.height,
+									staging.m_Offset);
 
 	m_pTestModelTextureImage->TransitionLayout(cmdBuffer,
 											   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
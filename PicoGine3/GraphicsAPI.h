@@ -1,18 +1,27 @@
 #ifndef GRAPHICSAPI_H
 #define GRAPHICSAPI_H
 
+#include <span>
+
 #include "GfxStructs.h"
 #include "GfxCommandBuffer.h"
+#include "GfxDepthPyramid.h"
 #include "GfxDevice.h"
+#include "GfxGeometryArena.h"
+#include "GfxGpuTimer.h"
 #include "GfxImmediateCommands.h"
+#include "GfxRenderGraph.h"
+#include "GfxSecondaryCommands.h"
+#include "GfxStagingRing.h"
 #include "GfxSwapchain.h"
+#include "GfxUploadQueue.h"
 #include "ShaderModulePool.h"
+#include "Vertex.h"
 
 #include "Pool.h"
 using BufferHandle = Handle<GfxBuffer>;
 using TextureHandle = Handle<GfxImage>;
 using RenderPipelineHandle = Handle<GfxRenderPipeline>;
-//using ComputePipelineHandle = Handle<GfxComputePipeline>;
 //using RayTracingPipelineHandle = Handle<GfxRayTracingPipeline>;
 //using SamplerHandle = Handle<GfxSampler>;
 
@@ -61,10 +70,52 @@ struct PerFrameUBO
 };
 
 struct PushConstants
+{
+	alignas(16) XMFLOAT3 m_PositionOffset; // Packed vertex decode, identity for full precision meshes and GPU-driven draws
+	alignas(16) XMFLOAT3 m_PositionScale;
+};
+
+// Command buffer a run of draws is recorded into and the state last bound in it, draws only rebind what changed.
+// Each recording thread has its own, the draws of a pass can be split between them
+struct DrawRecorder
+{
+	VkCommandBuffer m_CmdBuffer{ VK_NULL_HANDLE };
+	VkPipeline m_BoundVkPipeline{ VK_NULL_HANDLE };
+	VkBuffer m_BoundVkVertexBuffer{ VK_NULL_HANDLE };
+	VkBuffer m_BoundVkIndexBuffer{ VK_NULL_HANDLE };
+	VkDescriptorSet m_BoundVkDescriptorSet{ VK_NULL_HANDLE };
+	PushConstants m_PushedConstants{};
+	bool m_HasPushedConstants{};
+	uint32_t m_DrawCount{};
+	uint32_t m_BindCount{};
+};
+
+// Per-frame storage buffer at binding 2, indexed by SV_InstanceID, which includes the draw's first instance under Vulkan
+struct InstanceData
 {
 	alignas(16) XMFLOAT4X4 m_ModelMat;
 };
 
+// GPU-driven culling input at binding 3, the transform is the instance at the same index
+struct ObjectData
+{
+	XMFLOAT4 m_BoundsCenter; // Space of the stored vertex positions, before the instance transform
+	XMFLOAT4 m_BoundsExtent;
+	uint32_t m_FirstIndex; // Absolute in the geometry arena
+	uint32_t m_IndexCount;
+	int32_t m_VertexOffset;
+	uint32_t m_VertexFormat;
+};
+
+struct CullPushConstants
+{
+	XMFLOAT4 m_FrustumPlanes[6];
+	uint32_t m_ObjectCount;
+	uint32_t m_MaxDrawsPerFormat;
+	uint32_t m_Phase;
+	uint32_t m_OcclusionCulling;
+};
+
 struct DeferredTask
 {
 	explicit DeferredTask(std::packaged_task<void()>&& task, SubmitHandle handle) : m_Task(std::move(task)), m_Handle(handle) {}
@@ -75,6 +126,9 @@ struct DeferredTask
 class GraphicsAPI final
 {
 public:
+	// Issues the DrawMesh() calls of draws [firstDraw, lastDraw) into the recorder
+	using DrawRangeCallback = std::function<void(DrawRecorder& recorder, uint32_t firstDraw, uint32_t lastDraw)>;
+
 	explicit GraphicsAPI();
 	~GraphicsAPI();
 
@@ -86,12 +140,44 @@ public:
 	[[nodiscard]] bool IsInitialized() const;
 	[[nodiscard]] GfxDevice* GetGfxDevice() const;
 	[[nodiscard]] GfxImmediateCommands* GetGfxImmediateCommands() const;
+	// Null without a compute family separate from the graphics one
+	[[nodiscard]] GfxImmediateCommands* GetGfxComputeCommands() const;
 	[[nodiscard]] VkSemaphore GetTimelineSemaphore() const;
 	[[nodiscard]] const GfxCommandBuffer& GetCurrentCommandBuffer() const;
+	[[nodiscard]] GfxGpuTimer* GetGfxGpuTimer() const;
+	[[nodiscard]] GfxStagingRing* GetGfxStagingRing() const;
+	[[nodiscard]] GfxUploadQueue* GetGfxUploadQueue() const;
+	[[nodiscard]] ShaderModulePool* GetShaderModulePool() const;
 
+	// Frame declaration order: BeginFrame(), SetInstanceData(), CullObjects(), SetMainPassDraws(), EndFrame()
+	// The passes are recorded by the render graph in EndFrame(), once the frame's structure is known
 	void BeginFrame();
 	void EndFrame();
-	void DrawMesh(uint32_t meshDataID, uint32_t materialID, const XMFLOAT4X4& transform) const;
+	// Instances of the whole frame, after BeginFrame() and before the draws referencing them
+	void SetInstanceData(std::span<const InstanceData> instances);
+	// Called while the main pass is recorded, after the GPU-driven draws, to issue the CPU-side DrawMesh() calls.
+	// Large draw lists are split in contiguous ranges recorded in parallel on the job system, then executed in order
+	void SetMainPassDraws(uint32_t drawCount, DrawRangeCallback&& drawCallback);
+	// Thread safe as long as every thread records into its own recorder
+	void DrawMesh(DrawRecorder& recorder, uint32_t meshDataID, uint32_t materialID, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod = 0) const;
+
+	// GPU-driven path, the compute pass frustum culls the objects and writes one indirect command per visible object and vertex format
+	[[nodiscard]] bool IsGpuDrivenSupported() const;
+	// With occlusion culling, objects hidden by last frame's depth pyramid are held back. After the main pass, the depth pyramid
+	// is built from its depth and the held back objects it does not hide are drawn in a second pass
+	// Without occlusion culling, the culling is submitted to the async compute queue when there is one, and overlaps with the
+	// previous frame's rasterization. The frame's graphics submit waits on it before reading the indirect commands
+	void CullObjects(std::span<const ObjectData> objects, bool occlusionCulling = false);
+	[[nodiscard]] bool IsAsyncComputeSupported() const;
+
+	[[nodiscard]] GfxGeometryArena* GetGeometryArena(VertexFormat vertexFormat) const;
+
+	// The camera is still hardcoded, exposed for CPU side decisions like LOD selection
+	[[nodiscard]] const XMFLOAT3& GetCameraPosition() const;
+	// Pixels covered by one unit at a distance of one unit from the camera
+	[[nodiscard]] float GetProjectionScale() const;
+	// World space, normalized, positive inside: left, right, bottom, top, near, far
+	[[nodiscard]] std::array<XMFLOAT4, 6> GetFrustumPlanes() const;
 
 	void AcquireCommandBuffer();
 	SubmitHandle SubmitCommandBuffer(bool present = false);
@@ -107,46 +193,125 @@ public:
 	void Destroy(TextureHandle handle);
 	[[nodiscard]] GfxImage* GetTexture(TextureHandle handle) const;
 
+	QueryPoolHandle AcquireQueryPool(const QueryPoolDesc& desc);
+	void Destroy(QueryPoolHandle handle);
+	[[nodiscard]] GfxQueryPool* GetQueryPool(QueryPoolHandle handle) const;
+	// Returns false instead of waiting if any of the queries is not available yet
+	[[nodiscard]] bool GetQueryPoolResults(QueryPoolHandle handle, uint32_t firstQuery, uint32_t queryCount, uint64_t* pResults) const;
+
+	ComputePipelineHandle AcquireComputePipeline(const ComputePipelineDesc& desc);
+	void Destroy(ComputePipelineHandle handle);
+	[[nodiscard]] GfxComputePipeline* GetComputePipeline(ComputePipelineHandle handle) const;
+
 private:
 	bool m_IsInitialized;
 
 	std::unique_ptr<GfxDevice> m_pGfxDevice;
 	std::unique_ptr<GfxSwapchain> m_pGfxSwapchain;
 	std::unique_ptr<GfxImmediateCommands> m_pGfxImmediateCommands;
+	std::unique_ptr<GfxImmediateCommands> m_pGfxComputeCommands;
 	GfxCommandBuffer m_CurrentCommandBuffer;
 	VkSemaphore m_TimelineSemaphore;
 	std::unique_ptr<ShaderModulePool> m_pShaderModulePool;
+	std::unique_ptr<GfxGpuTimer> m_pGfxGpuTimer;
+	std::unique_ptr<GfxStagingRing> m_pGfxStagingRing;
+	std::unique_ptr<GfxUploadQueue> m_pGfxUploadQueue;
+	std::unique_ptr<GfxDepthPyramid> m_pGfxDepthPyramid;
+	std::unique_ptr<GfxRenderGraph> m_pGfxRenderGraph;
+	std::unique_ptr<GfxSecondaryCommands> m_pGfxSecondaryCommands;
+	DrawRangeCallback m_MainPassDraws;
+	uint32_t m_MainPassDrawCount{};
+	std::vector<DrawRecorder> m_DrawRecorders;
 
 	std::deque<DeferredTask> m_DeferredTasks;
 	
 	VkDescriptorSetLayout m_VkDescriptorSetLayout;
 	VkPipelineLayout m_VkGraphicsPipelineLayout;
 	VkPipeline m_VkGraphicsPipeline;
+	VkPipeline m_VkPackedGraphicsPipeline;
+	ComputePipelineHandle m_CullPipeline;
+
+	uint32_t m_FrameDrawCount{};
+	uint32_t m_FrameBindCount{};
+	// Submit counts of the queues at the previous EndFrame, the benchmark reports the difference
+	uint32_t m_LastGraphicsQueueSubmitCount{};
+	uint32_t m_LastComputeQueueSubmitCount{};
 
 	std::vector<BufferHandle> m_PerFrameUBO;
+	std::vector<BufferHandle> m_InstanceBuffers;
+	std::vector<uint32_t> m_InstanceBufferCapacities;
+	std::vector<BufferHandle> m_ObjectBuffers;
+	std::vector<BufferHandle> m_DrawCommandBuffers;
+	std::vector<BufferHandle> m_DrawCountBuffers;
+	std::vector<BufferHandle> m_LateObjectBuffers;
+	std::vector<uint32_t> m_ObjectBufferCapacities;
+	uint32_t m_CulledObjectCount{};
+	bool m_OcclusionCulling{};
+	// Compute queue timeline value the frame's graphics submit waits on, 0 when the culling is recorded on the graphics queue
+	uint64_t m_AsyncCullTimelineValue{};
 	VkDescriptorPool m_VkDescriptorPool;
 	std::vector<VkDescriptorSet> m_VkDescriptorSets;
 	mutable bool m_AwaitingDescriptorsCreation{};
 
+	XMFLOAT3 m_CameraPosition{ 0.0f, 1.5f, -5.0f };
+	XMFLOAT3 m_CameraFocus{ 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 m_CameraUp{ 0.0f, 1.0f, 0.0f };
+	float m_CameraFovY{ XM_PIDIV4 };
+
+	std::array<std::unique_ptr<GfxGeometryArena>, g_VertexFormatCount> m_GeometryArenas;
+
 	std::unique_ptr<GfxImage> m_pTestModelTextureImage;
 	VkSampler m_VkTestModelTextureSampler;
 
 	Pool<GfxBuffer> m_BuffersPool;
 	Pool<GfxImage> m_TexturesPool;
 	Pool<GfxRenderPipeline> m_RenderPipelinesPool;
+	Pool<GfxQueryPool> m_QueryPoolsPool;
+	Pool<GfxComputePipeline> m_ComputePipelinesPool;
 
 	void ProcessDeferredTasks();
 	void WaitDeferredTasks();
 
 	void CreateGraphicsPipeline();
+	void CreateCullPipeline();
+	void CreateGeometryArenas();
+	void BuildFrameGraph();
+	void RecordMainPass(const GfxCommandBuffer& cmdBuffer);
+	void RecordLatePass(const GfxCommandBuffer& cmdBuffer);
+	void BeginSwapchainRenderPass(VkCommandBuffer cmdBuffer, VkRenderPass renderPass, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) const;
+	void SetSwapchainViewport(VkCommandBuffer cmdBuffer) const;
+	void RecordMainPassDraws(DrawRecorder& recorder, uint32_t firstDraw, uint32_t lastDraw) const;
+	void AddRecorderCounts(const DrawRecorder& recorder);
+	void DispatchCull(GfxCommandBuffer& cmdBuffer, uint32_t phase);
+	void SubmitAsyncCull();
+	void DrawCullPhase(DrawRecorder& recorder, uint32_t phase) const;
+	void BindDrawState(DrawRecorder& recorder, VertexFormat vertexFormat, VkBuffer vertexBuffer, VkBuffer indexBuffer) const;
+	void PushDrawConstants(DrawRecorder& recorder, const XMFLOAT3& positionOffset, const XMFLOAT3& positionScale) const;
 	
 	void CreateDescriptorSetLayout();
 	void CreateUniformBuffers();
+	void CreateInstanceBuffer(size_t frameIndex, uint32_t capacity);
+	void CreateObjectBuffers(size_t frameIndex, uint32_t capacity);
+	void WriteObjectDescriptors(size_t frameIndex) const;
 	void UpdatePerFrameUBO() const;
+	[[nodiscard]] XMMATRIX CalculateViewMatrix() const;
+	[[nodiscard]] XMMATRIX CalculateProjMatrix() const;
 	void CreateDescriptorPool();
 	void CreateDescriptorSets();
 	void CreateTextureImage();
 
+	static constexpr uint32_t sk_MinInstanceBufferCapacity{ 1024 };
+	static constexpr uint32_t sk_GeometryArenaVertexCapacity{ 1u << 20 };
+	static constexpr uint32_t sk_GeometryArenaIndexCapacity{ 1u << 22 };
+	static constexpr uint32_t sk_CullGroupSize{ 64 };
+	// Below this many draws per recording thread, splitting the main pass costs more than it saves
+	static constexpr uint32_t sk_MinDrawsPerRecordingChunk{ 256 };
+	// Draws surviving the first culling phase, then the ones found disoccluded by the second
+	static constexpr uint32_t sk_CullPhaseCount{ 2 };
+	// Draw count buffer: one count per phase and vertex format, then the number of objects held back for the second phase
+	static constexpr uint32_t sk_LateObjectCountIndex{ sk_CullPhaseCount * g_VertexFormatCount };
+	static_assert(sk_CullPhaseCount == 2 && g_VertexFormatCount == 2, "Shaders/CullObjects.hlsl hardcodes VERTEX_FORMAT_COUNT and LATE_OBJECT_COUNT.");
+
 	static uint32_t CalculateMaxMipLevels(uint32_t width, uint32_t height);
 	static VkSampleCountFlagBits GetVulkanSampleCountFlags(uint32_t numSamples, VkSampleCountFlags maxSamplesMask);
 };
@@ -9,6 +9,21 @@ namespace StrUtils
 	}
 }
 
+namespace HashUtils
+{
+	// FNV-1a, stable across runs so it can key files on disk
+	inline uint64_t Fnv1a64(const void* pData, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+	{
+		const auto* pBytes{ static_cast<const uint8_t*>(pData) };
+		for (size_t i{}; i < size; ++i)
+		{
+			hash ^= pBytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+}
+
 inline void HandleHr(HRESULT hr)
 {
 	if (FAILED(hr))
@@ -9,6 +9,13 @@
 
 void InputManager::Initialize()
 {
+	// No window to register raw input against, controllers are still polled
+	if (Settings::Get().IsHeadless())
+	{
+		m_IsInitialized = true;
+		return;
+	}
+
 	const auto& hwnd = WindowManager::Get().GetHWnd();
 
 	m_RawDevices[0] = { HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_KEYBOARD, RIDEV_INPUTSINK, hwnd };
@@ -30,16 +37,21 @@ bool InputManager::IsInitialized() const
 
 void InputManager::UpdateAndExec()
 {
+	PROFILE_FUNCTION();
+
 	UpdateControllerState();
 
 	XMStoreSInt2(&m_MousePosition, XMLoadSInt2(&m_MousePosition) + XMLoadSInt2(&m_MouseDelta));
 
 	// Exec commands
-	if (IsKeyUp(KC_F10) || IsControllerButtonUp(GP_B))
-		WindowManager::Get().SetFullscreenState(WindowFullscreenState::None);
+	if (!Settings::Get().IsHeadless())
+	{
+		if (IsKeyUp(KC_F10) || IsControllerButtonUp(GP_B))
+			WindowManager::Get().SetFullscreenState(WindowFullscreenState::None);
 
-	if (IsKeyUp(KC_F11) || IsControllerButtonUp(GP_A))
-		WindowManager::Get().SetFullscreenState(WindowFullscreenState::Borderless);
+		if (IsKeyUp(KC_F11) || IsControllerButtonUp(GP_A))
+			WindowManager::Get().SetFullscreenState(WindowFullscreenState::Borderless);
+	}
 
 	if (IsKeyUp(KC_V))
 		Settings::Get().SetVSync(!Settings::Get().IsVSyncEnabled());
@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+
+JobSystem::~JobSystem()
+{
+	{
+		const std::lock_guard lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_JobAvailable.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+void JobSystem::Initialize()
+{
+	// Leave one hardware thread to the main thread
+	const uint32_t workerCount{ std::max(std::thread::hardware_concurrency(), 2u) - 1 };
+
+	m_Workers.reserve(workerCount);
+	for (uint32_t i{}; i < workerCount; ++i)
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+
+	Logger::Get().LogInfo(std::format(L"JobSystem started {} worker threads.\n", workerCount), false);
+
+	m_IsInitialized = true;
+}
+
+bool JobSystem::IsInitialized() const
+{
+	return m_IsInitialized;
+}
+
+uint32_t JobSystem::GetWorkerCount() const
+{
+	return static_cast<uint32_t>(m_Workers.size());
+}
+
+void JobSystem::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+	if (count == 0)
+		return;
+
+	// Helpers that only start after the caller returned must not touch its stack, they share this through a shared_ptr
+	struct ParallelForState final
+	{
+		std::atomic<uint32_t> m_NextIndex{};
+		std::atomic<uint32_t> m_DoneCount{};
+		uint32_t m_Count{};
+		const std::function<void(uint32_t)>* m_pFunc{};
+
+		void Run()
+		{
+			for (uint32_t index{ m_NextIndex++ }; index < m_Count; index = m_NextIndex++)
+			{
+				(*m_pFunc)(index);
+				if (++m_DoneCount == m_Count)
+					m_DoneCount.notify_all();
+			}
+		}
+	};
+
+	const auto pState{ std::make_shared<ParallelForState>() };
+	pState->m_Count = count;
+	pState->m_pFunc = &func;
+
+	const uint32_t helperCount{ std::min(count - 1, GetWorkerCount()) };
+	for (uint32_t i{}; i < helperCount; ++i)
+		static_cast<void>(Submit([pState]() { pState->Run(); }));
+
+	pState->Run();
+
+	// Indices claimed by helpers may still be running
+	for (uint32_t done{ pState->m_DoneCount }; done < count; done = pState->m_DoneCount)
+		pState->m_DoneCount.wait(done);
+}
+
+void JobSystem::WorkerLoop()
+{
+	PROFILE_THREAD_NAME("Job Worker");
+
+	while (true)
+	{
+		std::function<void()> job{};
+
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_JobAvailable.wait(lock, [this]() { return m_IsStopping || !m_Jobs.empty(); });
+
+			// Remaining jobs are drained before stopping so no future is left without a value
+			if (m_Jobs.empty())
+				return;
+
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop();
+		}
+
+		job();
+	}
+}
\ No newline at end of file
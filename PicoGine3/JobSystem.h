@@ -0,0 +1,64 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "Singleton.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// Fixed pool of worker threads for CPU work that must stay off the main thread (asset import, ...)
+class JobSystem final : public Singleton<JobSystem>
+{
+	friend class Singleton<JobSystem>;
+	explicit JobSystem() = default;
+
+public:
+	~JobSystem() override;
+
+	JobSystem(const JobSystem&) noexcept = delete;
+	JobSystem& operator=(const JobSystem&) noexcept = delete;
+	JobSystem(JobSystem&&) noexcept = delete;
+	JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+	void Initialize();
+	[[nodiscard]] bool IsInitialized() const;
+
+	[[nodiscard]] uint32_t GetWorkerCount() const;
+
+	template<typename Func>
+	[[nodiscard]] std::future<std::invoke_result_t<Func>> Submit(Func&& func)
+	{
+		using ResultType = std::invoke_result_t<Func>;
+
+		// std::function needs a copyable callable, packaged_task is move only
+		auto pTask{ std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func)) };
+		std::future<ResultType> future{ pTask->get_future() };
+
+		{
+			const std::lock_guard lock{ m_Mutex };
+			m_Jobs.emplace([pTask]() { (*pTask)(); });
+		}
+		m_JobAvailable.notify_one();
+
+		return future;
+	}
+
+	// Runs func(0..count-1) on the workers and the calling thread, returns once every index is done.
+	// The caller takes part instead of blocking on the queue, so it is safe to call from a job.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+private:
+	bool m_IsInitialized{};
+	bool m_IsStopping{};
+
+	std::vector<std::thread> m_Workers{};
+	std::queue<std::function<void()>> m_Jobs{};
+	std::mutex m_Mutex{};
+	std::condition_variable m_JobAvailable{};
+
+	void WorkerLoop();
+};
+
+#endif //JOBSYSTEM_H
\ No newline at end of file
@@ -95,6 +95,8 @@ void Logger::ProcessLog(LogLevel level, const std::wstring& logString, bool deta
 		logEntry << std::format(L"[{}] -> {}\n", levelStr, logString);
 	}
 	
+	const std::lock_guard lock{ m_Mutex };
+
 	m_OutputStream << logEntry.str();
 	m_OutputStream.flush();
 
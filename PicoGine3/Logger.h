@@ -43,6 +43,7 @@ private:
 	inline static const std::wstring k_LevelsToString[]{ L"INFO", L"DEBUG", L"WARNING", L"ERROR", L"TODO" };
 
 	std::wofstream m_OutputStream{};
+	std::mutex m_Mutex{}; // logs also come from job workers
 
 	void ProcessLog(LogLevel level, const std::wstring& logString, bool detailedOutput, const std::source_location& sourceLocation);
 
@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+
+MappedFile::MappedFile(const std::wstring& path)
+{
+	m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_File == INVALID_HANDLE_VALUE)
+		return;
+
+	// Empty files cannot be mapped, they are reported as invalid
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(m_File, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_Mapping)
+		return;
+
+	m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_pData)
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+
+	if (m_File != INVALID_HANDLE_VALUE)
+		CloseHandle(m_File);
+}
+
+bool MappedFile::IsValid() const
+{
+	return m_pData != nullptr;
+}
+
+const uint8_t* MappedFile::GetData() const
+{
+	return m_pData;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return m_Size;
+}
\ No newline at end of file
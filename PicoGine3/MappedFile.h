@@ -0,0 +1,27 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+// Read-only view of a whole file, pages are only read from disk when touched
+class MappedFile final
+{
+public:
+	explicit MappedFile(const std::wstring& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) noexcept = delete;
+	MappedFile& operator=(const MappedFile&) noexcept = delete;
+	MappedFile(MappedFile&&) noexcept = delete;
+	MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+	[[nodiscard]] bool IsValid() const;
+	[[nodiscard]] const uint8_t* GetData() const;
+	[[nodiscard]] size_t GetSize() const;
+
+private:
+	HANDLE m_File{ INVALID_HANDLE_VALUE };
+	HANDLE m_Mapping{};
+	const uint8_t* m_pData{};
+	size_t m_Size{};
+};
+
+#endif //MAPPEDFILE_H
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "MeshCooker.h"
+
+#include <filesystem>
+#include <fstream>
+
+
+namespace
+{
+	constexpr uint64_t sk_SectionAlignment{ 16 };
+
+	uint64_t AlignSection(uint64_t offset)
+	{
+		return (offset + sk_SectionAlignment - 1) & ~(sk_SectionAlignment - 1);
+	}
+
+	std::wstring NormalizePath(const std::wstring& path)
+	{
+		return std::filesystem::path{ path }.lexically_normal().generic_wstring();
+	}
+
+	uint64_t HashPath(const std::wstring& path)
+	{
+		const std::wstring normalized{ NormalizePath(path) };
+		return HashUtils::Fnv1a64(normalized.data(), normalized.size() * sizeof(wchar_t));
+	}
+
+	// 0 when the source is not available, cooked files are then trusted as is
+	uint64_t HashSourceContent(const std::wstring& sourcePath)
+	{
+		const MappedFile source{ sourcePath };
+		return source.IsValid() ? HashUtils::Fnv1a64(source.GetData(), source.GetSize()) : 0;
+	}
+
+	struct SourceStamp final
+	{
+		uint64_t m_Size{};
+		int64_t m_WriteTime{};
+		bool m_IsValid{};
+	};
+
+	// Cheap enough for every load, unlike hashing the whole source
+	SourceStamp GetSourceStamp(const std::wstring& sourcePath)
+	{
+		std::error_code error{};
+		const uint64_t size{ std::filesystem::file_size(sourcePath, error) };
+		if (error)
+			return {};
+
+		const auto writeTime{ std::filesystem::last_write_time(sourcePath, error) };
+		if (error)
+			return {};
+
+		return SourceStamp{ .m_Size = size, .m_WriteTime = static_cast<int64_t>(writeTime.time_since_epoch().count()), .m_IsValid = true };
+	}
+}
+
+std::wstring MeshCooker::GetCookedPath(const std::wstring& sourcePath)
+{
+	return std::format(L"Cache/Meshes/{:016x}.pgmesh", HashPath(sourcePath));
+}
+
+bool MeshCooker::Open(const MappedFile& cookedFile, const std::wstring& sourcePath, CookedMeshView& view)
+{
+	PROFILE_FUNCTION();
+
+	if (!cookedFile.IsValid() || cookedFile.GetSize() < sizeof(CookedMeshHeader))
+		return false;
+
+	const uint8_t* pData{ cookedFile.GetData() };
+	const uint64_t fileSize{ cookedFile.GetSize() };
+
+	CookedMeshHeader header{};
+	memcpy(&header, pData, sizeof(CookedMeshHeader));
+
+	if (header.m_Magic != sk_Magic || header.m_Version != sk_Version || header.m_VertexStride != sizeof(Vertex3D))
+		return false;
+
+	if (header.m_SourcePathHash != HashPath(sourcePath))
+		return false;
+
+	// Same size and write time means the source is unchanged. A different size always means a changed one, a different write
+	// time alone falls back to the content hash so touched or copied sources are not re-cooked
+	const SourceStamp stamp{ GetSourceStamp(sourcePath) };
+	if (stamp.m_IsValid && (stamp.m_Size != header.m_SourceSize || stamp.m_WriteTime != header.m_SourceWriteTime))
+	{
+		if (stamp.m_Size != header.m_SourceSize)
+			return false;
+
+		const uint64_t sourceHash{ HashSourceContent(sourcePath) };
+		if (sourceHash && sourceHash != header.m_SourceContentHash)
+			return false;
+	}
+
+	// Never trust offsets read from disk
+	const auto isInFile{ [fileSize](uint64_t offset, uint64_t size) { return offset % sk_SectionAlignment == 0 && offset <= fileSize && size <= fileSize - offset; } };
+	if (!isInFile(header.m_SubmeshOffset, uint64_t{ header.m_SubmeshCount } * sizeof(CookedSubmesh))
+		|| !isInFile(header.m_LodOffset, uint64_t{ header.m_LodCount } * sizeof(CookedLod))
+		|| !isInFile(header.m_VertexOffset, uint64_t{ header.m_VertexCount } * sizeof(Vertex3D))
+		|| !isInFile(header.m_IndexOffset, uint64_t{ header.m_IndexCount } * sizeof(uint32_t))
+		|| !isInFile(header.m_MeshletOffset, uint64_t{ header.m_MeshletCount } * sizeof(Meshlet))
+		|| !isInFile(header.m_MeshletVertexOffset, uint64_t{ header.m_MeshletVertexCount } * sizeof(uint32_t))
+		|| !isInFile(header.m_MeshletTriangleOffset, header.m_MeshletTriangleBytes))
+		return false;
+
+	view.m_Submeshes = { reinterpret_cast<const CookedSubmesh*>(pData + header.m_SubmeshOffset), header.m_SubmeshCount };
+	view.m_Lods = { reinterpret_cast<const CookedLod*>(pData + header.m_LodOffset), header.m_LodCount };
+	view.m_Vertices = { reinterpret_cast<const Vertex3D*>(pData + header.m_VertexOffset), header.m_VertexCount };
+	view.m_Indices = { reinterpret_cast<const uint32_t*>(pData + header.m_IndexOffset), header.m_IndexCount };
+	view.m_Meshlets = { reinterpret_cast<const Meshlet*>(pData + header.m_MeshletOffset), header.m_MeshletCount };
+	view.m_MeshletVertices = { reinterpret_cast<const uint32_t*>(pData + header.m_MeshletVertexOffset), header.m_MeshletVertexCount };
+	view.m_MeshletTriangles = { pData + header.m_MeshletTriangleOffset, header.m_MeshletTriangleBytes };
+	view.m_BoundsMin = header.m_BoundsMin;
+	view.m_BoundsMax = header.m_BoundsMax;
+
+	// LOD ranges end up in draw calls
+	for (const CookedLod& lod : view.m_Lods)
+	{
+		if (lod.m_FirstIndex > header.m_IndexCount || lod.m_IndexCount > header.m_IndexCount - lod.m_FirstIndex
+			|| lod.m_FirstMeshlet > header.m_MeshletCount || lod.m_MeshletCount > header.m_MeshletCount - lod.m_FirstMeshlet)
+			return false;
+	}
+
+	// So are meshlet ranges, through the cluster culling shaders
+	for (const Meshlet& meshlet : view.m_Meshlets)
+	{
+		if (uint64_t{ meshlet.m_VertexOffset } + meshlet.m_VertexCount > header.m_MeshletVertexCount
+			|| uint64_t{ meshlet.m_TriangleOffset } + uint64_t{ meshlet.m_TriangleCount } * 3 > header.m_MeshletTriangleBytes)
+			return false;
+	}
+
+	return true;
+}
+
+bool MeshCooker::Write(const std::wstring& sourcePath, const CookedMeshView& mesh)
+{
+	PROFILE_FUNCTION();
+
+	const std::filesystem::path cookedPath{ GetCookedPath(sourcePath) };
+	std::filesystem::path tempPath{ cookedPath };
+	tempPath += L".tmp";
+
+	std::error_code error{};
+	std::filesystem::create_directories(cookedPath.parent_path(), error);
+
+	CookedMeshHeader header{};
+	header.m_Magic = sk_Magic;
+	header.m_Version = sk_Version;
+	header.m_SourcePathHash = HashPath(sourcePath);
+	header.m_SourceContentHash = HashSourceContent(sourcePath);
+	const SourceStamp stamp{ GetSourceStamp(sourcePath) };
+	header.m_SourceSize = stamp.m_Size;
+	header.m_SourceWriteTime = stamp.m_WriteTime;
+	header.m_VertexStride = sizeof(Vertex3D);
+	header.m_VertexCount = static_cast<uint32_t>(mesh.m_Vertices.size());
+	header.m_IndexCount = static_cast<uint32_t>(mesh.m_Indices.size());
+	header.m_SubmeshCount = static_cast<uint32_t>(mesh.m_Submeshes.size());
+	header.m_LodCount = static_cast<uint32_t>(mesh.m_Lods.size());
+	header.m_MeshletCount = static_cast<uint32_t>(mesh.m_Meshlets.size());
+	header.m_MeshletVertexCount = static_cast<uint32_t>(mesh.m_MeshletVertices.size());
+	header.m_MeshletTriangleBytes = static_cast<uint32_t>(mesh.m_MeshletTriangles.size());
+	header.m_SubmeshOffset = AlignSection(sizeof(CookedMeshHeader));
+	header.m_LodOffset = AlignSection(header.m_SubmeshOffset + mesh.m_Submeshes.size_bytes());
+	header.m_VertexOffset = AlignSection(header.m_LodOffset + mesh.m_Lods.size_bytes());
+	header.m_IndexOffset = AlignSection(header.m_VertexOffset + mesh.m_Vertices.size_bytes());
+	header.m_MeshletOffset = AlignSection(header.m_IndexOffset + mesh.m_Indices.size_bytes());
+	header.m_MeshletVertexOffset = AlignSection(header.m_MeshletOffset + mesh.m_Meshlets.size_bytes());
+	header.m_MeshletTriangleOffset = AlignSection(header.m_MeshletVertexOffset + mesh.m_MeshletVertices.size_bytes());
+	header.m_BoundsMin = mesh.m_BoundsMin;
+	header.m_BoundsMax = mesh.m_BoundsMax;
+
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+		{
+			Logger::Get().LogWarning(std::format(L"Unable to write cooked mesh {}.", tempPath.wstring()));
+			return false;
+		}
+
+		constexpr char padding[sk_SectionAlignment]{};
+		const auto writeSection{ [&file, &padding](uint64_t offset, const void* pData, size_t size)
+		{
+			file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+			file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+		} };
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(CookedMeshHeader));
+		writeSection(header.m_SubmeshOffset, mesh.m_Submeshes.data(), mesh.m_Submeshes.size_bytes());
+		writeSection(header.m_LodOffset, mesh.m_Lods.data(), mesh.m_Lods.size_bytes());
+		writeSection(header.m_VertexOffset, mesh.m_Vertices.data(), mesh.m_Vertices.size_bytes());
+		writeSection(header.m_IndexOffset, mesh.m_Indices.data(), mesh.m_Indices.size_bytes());
+		writeSection(header.m_MeshletOffset, mesh.m_Meshlets.data(), mesh.m_Meshlets.size_bytes());
+		writeSection(header.m_MeshletVertexOffset, mesh.m_MeshletVertices.data(), mesh.m_MeshletVertices.size_bytes());
+		writeSection(header.m_MeshletTriangleOffset, mesh.m_MeshletTriangles.data(), mesh.m_MeshletTriangles.size_bytes());
+
+		if (!file.good())
+			return false;
+	}
+
+	// Written under a temporary name so a crash never leaves a truncated cooked file behind
+	std::filesystem::rename(tempPath, cookedPath, error);
+	if (error)
+	{
+		Logger::Get().LogWarning(std::format(L"Unable to write cooked mesh {}.", cookedPath.wstring()));
+		return false;
+	}
+
+	Logger::Get().LogInfo(std::format(L"Cooked {} into {}.\n", sourcePath, cookedPath.wstring()), false);
+	return true;
+}
\ No newline at end of file
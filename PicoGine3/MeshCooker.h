@@ -0,0 +1,83 @@
+#ifndef MESHCOOKER_H
+#define MESHCOOKER_H
+
+#include <span>
+
+#include "MappedFile.h"
+#include "MeshletBuilder.h"
+#include "Vertex.h"
+
+struct CookedSubmesh final
+{
+	uint32_t m_FirstIndex{};
+	uint32_t m_IndexCount{};
+	XMFLOAT3 m_BoundsMin{};
+	XMFLOAT3 m_BoundsMax{};
+};
+
+// Index range into the shared index stream, LOD 0 is the full resolution mesh
+struct CookedLod final
+{
+	uint32_t m_FirstIndex{};
+	uint32_t m_IndexCount{};
+	float m_Error{}; // Object space distance from the full resolution surface
+	uint32_t m_FirstMeshlet{};
+	uint32_t m_MeshletCount{};
+};
+
+// Header, submesh table, LOD table, vertex and index streams, then the meshlet streams, every section starts on a 16 bytes boundary
+struct CookedMeshHeader final
+{
+	uint32_t m_Magic{};
+	uint32_t m_Version{};
+	uint64_t m_SourcePathHash{};
+	uint64_t m_SourceContentHash{};
+	uint64_t m_SourceSize{};
+	int64_t m_SourceWriteTime{}; // std::filesystem::file_time_type ticks
+	uint32_t m_VertexStride{};
+	uint32_t m_VertexCount{};
+	uint32_t m_IndexCount{};
+	uint32_t m_SubmeshCount{};
+	uint32_t m_LodCount{};
+	uint32_t m_MeshletCount{};
+	uint32_t m_MeshletVertexCount{};
+	uint32_t m_MeshletTriangleBytes{};
+	uint64_t m_SubmeshOffset{};
+	uint64_t m_LodOffset{};
+	uint64_t m_VertexOffset{};
+	uint64_t m_IndexOffset{};
+	uint64_t m_MeshletOffset{};
+	uint64_t m_MeshletVertexOffset{};
+	uint64_t m_MeshletTriangleOffset{};
+	XMFLOAT3 m_BoundsMin{};
+	XMFLOAT3 m_BoundsMax{};
+};
+
+// Points into a mapped cooked file (or into the cooker's input), only valid while that memory is
+struct CookedMeshView final
+{
+	std::span<const Vertex3D> m_Vertices{};
+	std::span<const uint32_t> m_Indices{};
+	std::span<const CookedSubmesh> m_Submeshes{};
+	std::span<const CookedLod> m_Lods{};
+	std::span<const Meshlet> m_Meshlets{};
+	std::span<const uint32_t> m_MeshletVertices{};
+	std::span<const uint8_t> m_MeshletTriangles{};
+	XMFLOAT3 m_BoundsMin{};
+	XMFLOAT3 m_BoundsMax{};
+};
+
+namespace MeshCooker
+{
+	constexpr uint32_t sk_Magic{ 0x4853454D }; // "MESH"
+	// Bump whenever the layout or the vertex format changes, older files are re-cooked
+	constexpr uint32_t sk_Version{ 5 };
+
+	[[nodiscard]] std::wstring GetCookedPath(const std::wstring& sourcePath);
+
+	// False when the file is not a cooked mesh of this version or its source changed since it was cooked
+	[[nodiscard]] bool Open(const MappedFile& cookedFile, const std::wstring& sourcePath, CookedMeshView& view);
+	bool Write(const std::wstring& sourcePath, const CookedMeshView& mesh);
+}
+
+#endif //MESHCOOKER_H
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+#include <functional>
+
+
+namespace
+{
+	// Triangles referencing each vertex, stored as one flat array
+	struct TriangleAdjacency final
+	{
+		std::vector<uint32_t> m_Counts{};
+		std::vector<uint32_t> m_Offsets{};
+		std::vector<uint32_t> m_Data{};
+
+		TriangleAdjacency(std::span<const uint32_t> indices, uint32_t vertexCount) :
+			m_Counts(vertexCount, 0),
+			m_Offsets(vertexCount, 0),
+			m_Data(indices.size())
+		{
+			for (const uint32_t index : indices)
+				++m_Counts[index];
+
+			uint32_t offset{};
+			for (uint32_t v{}; v < vertexCount; ++v)
+			{
+				m_Offsets[v] = offset;
+				offset += m_Counts[v];
+			}
+
+			std::vector<uint32_t> fill{ m_Offsets };
+			for (uint32_t i{}; i < indices.size(); ++i)
+				m_Data[fill[indices[i]]++] = i / 3;
+		}
+	};
+
+	// Cache miss count of each triangle for a FIFO cache, shared by the analysis and the overdraw clustering
+	uint32_t SimulateFifo(std::span<const uint32_t> indices, uint32_t cacheSize, std::vector<uint8_t>* pTriangleMisses = nullptr)
+	{
+		if (indices.empty())
+			return 0;
+
+		// Timestamps only cover the referenced vertex range, a submesh does not pay for the whole mesh
+		const auto [minVertex, maxVertex]{ std::ranges::minmax_element(indices) };
+		const uint32_t firstVertex{ *minVertex };
+		std::vector<uint32_t> timestamps(*maxVertex - firstVertex + 1, 0);
+		uint32_t time{ cacheSize + 1 };
+		uint32_t misses{};
+
+		for (size_t i{}; i < indices.size(); i += 3)
+		{
+			uint8_t triangleMisses{};
+			for (size_t k{}; k < 3; ++k)
+			{
+				const uint32_t v{ indices[i + k] - firstVertex };
+				if (time - timestamps[v] > cacheSize)
+				{
+					timestamps[v] = time++;
+					++triangleMisses;
+				}
+			}
+
+			misses += triangleMisses;
+			if (pTriangleMisses)
+				pTriangleMisses->push_back(triangleMisses);
+		}
+
+		return misses;
+	}
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, [[maybe_unused]] uint32_t vertexCount, uint32_t cacheSize)
+{
+	PROFILE_FUNCTION();
+
+	const size_t triangleCount{ indices.size() / 3 };
+	if (triangleCount == 0)
+		return;
+
+	// Submeshes and LODs only reference part of the vertices, the per vertex arrays cover just that range
+	const auto [minVertex, maxVertex]{ std::ranges::minmax_element(indices) };
+	assert(*maxVertex < vertexCount && L"Index out of the vertex range.");
+	const uint32_t firstVertex{ *minVertex };
+	const uint32_t rangeSize{ *maxVertex - firstVertex + 1 };
+
+	std::vector<uint32_t> localIndices(indices.size());
+	std::ranges::transform(indices, localIndices.begin(), [firstVertex](uint32_t index) { return index - firstVertex; });
+
+	const TriangleAdjacency adjacency{ localIndices, rangeSize };
+
+	std::vector<uint32_t> liveTriangles{ adjacency.m_Counts };
+	std::vector<uint32_t> timestamps(rangeSize, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEndStack{};
+	std::vector<uint32_t> candidates{};
+	std::vector<uint32_t> output{};
+	output.reserve(indices.size());
+
+	uint32_t time{ cacheSize + 1 };
+	uint32_t cursor{};
+	int64_t fanningVertex{ 0 };
+
+	while (fanningVertex >= 0)
+	{
+		const uint32_t f{ static_cast<uint32_t>(fanningVertex) };
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex
+		for (uint32_t i{}; i < adjacency.m_Counts[f]; ++i)
+		{
+			const uint32_t triangle{ adjacency.m_Data[adjacency.m_Offsets[f] + i] };
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t k{}; k < 3; ++k)
+			{
+				const uint32_t v{ localIndices[triangle * 3 + k] };
+				output.push_back(v);
+				deadEndStack.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+
+				if (time - timestamps[v] > cacheSize)
+					timestamps[v] = time++;
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// Next fanning vertex: the candidate that stays in cache the longest while its remaining fan is emitted
+		fanningVertex = -1;
+		int64_t bestPriority{ -1 };
+		for (const uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+				continue;
+
+			int64_t priority{};
+			if (time - timestamps[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = time - timestamps[v];
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanningVertex = v;
+			}
+		}
+
+		if (fanningVertex >= 0)
+			continue;
+
+		// Dead end: recently used vertices first, then the first vertex that still has triangles
+		while (!deadEndStack.empty() && fanningVertex < 0)
+		{
+			const uint32_t v{ deadEndStack.back() };
+			deadEndStack.pop_back();
+			if (liveTriangles[v] > 0)
+				fanningVertex = v;
+		}
+
+		while (cursor < rangeSize && fanningVertex < 0)
+		{
+			if (liveTriangles[cursor] > 0)
+				fanningVertex = cursor;
+			++cursor;
+		}
+	}
+
+	assert(output.size() == indices.size() && L"Vertex cache optimization lost triangles.");
+	std::ranges::transform(output, indices.begin(), [firstVertex](uint32_t v) { return v + firstVertex; });
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex3D> vertices, float threshold, uint32_t cacheSize)
+{
+	PROFILE_FUNCTION();
+
+	const size_t triangleCount{ indices.size() / 3 };
+	if (triangleCount < 2)
+		return;
+
+	// Hard boundaries: triangles that miss on all 3 vertices, the cache was effectively flushed there
+	std::vector<uint8_t> triangleMisses{};
+	triangleMisses.reserve(triangleCount);
+	SimulateFifo(indices, cacheSize, &triangleMisses);
+
+	std::vector<uint32_t> hardClusters{};
+	for (uint32_t t{}; t < triangleCount; ++t)
+		if (t == 0 || triangleMisses[t] == 3)
+			hardClusters.push_back(t);
+
+	// Soft boundaries: split hard clusters wherever the running ACMR is already within threshold of the whole cluster's
+	std::vector<uint32_t> clusters{};
+	for (size_t c{}; c < hardClusters.size(); ++c)
+	{
+		const uint32_t begin{ hardClusters[c] };
+		const uint32_t end{ c + 1 < hardClusters.size() ? hardClusters[c + 1] : static_cast<uint32_t>(triangleCount) };
+
+		uint32_t clusterMisses{};
+		for (uint32_t t{ begin }; t < end; ++t)
+			clusterMisses += triangleMisses[t];
+
+		const float clusterACMR{ static_cast<float>(clusterMisses) / static_cast<float>(end - begin) };
+
+		clusters.push_back(begin);
+		uint32_t runningMisses{};
+		uint32_t runningStart{ begin };
+		for (uint32_t t{ begin }; t < end; ++t)
+		{
+			runningMisses += triangleMisses[t];
+			const float runningACMR{ static_cast<float>(runningMisses) / static_cast<float>(t - runningStart + 1) };
+
+			// Triangles at runningStart miss more than average, keep a few in each cluster
+			if (t + 1 < end && t - runningStart >= 8 && runningACMR <= clusterACMR * threshold)
+			{
+				clusters.push_back(t + 1);
+				runningStart = t + 1;
+				runningMisses = 0;
+			}
+		}
+	}
+
+	// Mesh centroid
+	XMVECTOR meshCenter{ XMVectorZero() };
+	for (const uint32_t index : indices)
+		meshCenter = XMVectorAdd(meshCenter, XMLoadFloat3(&vertices[index].m_Position));
+	meshCenter = XMVectorScale(meshCenter, 1.0f / static_cast<float>(indices.size()));
+
+	// Clusters facing away from the center are drawn first, they are the most likely to occlude the others
+	std::vector<std::pair<float, uint32_t>> sortKeys(clusters.size());
+	for (uint32_t c{}; c < clusters.size(); ++c)
+	{
+		const uint32_t begin{ clusters[c] };
+		const uint32_t end{ c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount) };
+
+		XMVECTOR center{ XMVectorZero() };
+		XMVECTOR normal{ XMVectorZero() };
+		float area{};
+
+		for (uint32_t t{ begin }; t < end; ++t)
+		{
+			const XMVECTOR p0{ XMLoadFloat3(&vertices[indices[t * 3 + 0]].m_Position) };
+			const XMVECTOR p1{ XMLoadFloat3(&vertices[indices[t * 3 + 1]].m_Position) };
+			const XMVECTOR p2{ XMLoadFloat3(&vertices[indices[t * 3 + 2]].m_Position) };
+
+			// Cross product length is twice the area, weights both the normal and the centroid
+			const XMVECTOR cross{ XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)) };
+			const float triangleArea{ XMVectorGetX(XMVector3Length(cross)) };
+
+			center = XMVectorAdd(center, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triangleArea / 3.0f));
+			normal = XMVectorAdd(normal, cross);
+			area += triangleArea;
+		}
+
+		center = area > 0.0f ? XMVectorScale(center, 1.0f / area) : center;
+		normal = XMVector3Normalize(normal);
+
+		sortKeys[c] = { XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, meshCenter), normal)), c };
+	}
+
+	std::ranges::stable_sort(sortKeys, std::greater{}, &std::pair<float, uint32_t>::first);
+
+	std::vector<uint32_t> output{};
+	output.reserve(indices.size());
+	for (const auto& [key, c] : sortKeys)
+	{
+		const uint32_t begin{ clusters[c] };
+		const uint32_t end{ c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount) };
+		output.insert(output.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+	}
+
+	std::ranges::copy(output, indices.begin());
+}
+
+uint32_t MeshOptimizer::OptimizeVertexFetch(std::span<Vertex3D> vertices, std::span<uint32_t> indices)
+{
+	PROFILE_FUNCTION();
+
+	constexpr uint32_t unused{ std::numeric_limits<uint32_t>::max() };
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<Vertex3D> reordered{};
+	reordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	std::ranges::copy(reordered, vertices.begin());
+	return static_cast<uint32_t>(reordered.size());
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats{};
+	if (indices.empty())
+		return stats;
+
+	const uint32_t misses{ SimulateFifo(indices, cacheSize) };
+
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t uniqueVertices{};
+	for (const uint32_t index : indices)
+	{
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++uniqueVertices;
+		}
+	}
+
+	stats.m_ACMR = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.m_ATVR = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <span>
+
+#include "Vertex.h"
+
+struct VertexCacheStats final
+{
+	float m_ACMR{}; // transformed vertices per triangle, 0.5 is the ideal for a regular grid, 3 the worst case
+	float m_ATVR{}; // transformed vertices per referenced vertex, 1 is the ideal
+};
+
+// Import time mesh optimizations, in the order they should run: vertex cache, overdraw, then vertex fetch
+namespace MeshOptimizer
+{
+	constexpr uint32_t sk_DefaultCacheSize{ 16 };
+
+	// Tipsify (Sander, Nehab, Barczak 2007), reorders triangles for a FIFO post-transform cache
+	void OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = sk_DefaultCacheSize);
+
+	// Splits the cache optimized order into clusters and draws the ones facing outwards from the mesh center first,
+	// threshold bounds how much ACMR can be traded for less overdraw
+	void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex3D> vertices, float threshold = 1.05f, uint32_t cacheSize = sk_DefaultCacheSize);
+
+	// Sorts vertices in order of first use and drops unreferenced ones, returns the new vertex count
+	uint32_t OptimizeVertexFetch(std::span<Vertex3D> vertices, std::span<uint32_t> indices);
+
+	[[nodiscard]] VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = sk_DefaultCacheSize);
+}
+
+#endif //MESHOPTIMIZER_H
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+
+#include <functional>
+
+
+namespace
+{
+	// Symmetric 4x4 matrix, only the upper triangle is stored
+	struct Quadric final
+	{
+		std::array<double, 10> m_Coefficients{};
+
+		static Quadric FromPlane(double a, double b, double c, double d)
+		{
+			return Quadric{ { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d } };
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			for (size_t i{}; i < m_Coefficients.size(); ++i)
+				m_Coefficients[i] += other.m_Coefficients[i];
+
+			return *this;
+		}
+
+		// Sum of the squared distances to the accumulated planes
+		[[nodiscard]] double Evaluate(const XMFLOAT3& p) const
+		{
+			const auto& q{ m_Coefficients };
+			const double x{ p.x }, y{ p.y }, z{ p.z };
+
+			return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+				+ q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+				+ q[7] * z * z + 2.0 * q[8] * z
+				+ q[9];
+		}
+	};
+
+	struct Collapse final
+	{
+		double m_Cost{};
+		uint32_t m_From{};
+		uint32_t m_To{};
+		uint32_t m_FromVersion{};
+		uint32_t m_ToVersion{};
+
+		bool operator>(const Collapse& other) const { return m_Cost > other.m_Cost; }
+	};
+
+	XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		const XMVECTOR v0{ XMLoadFloat3(&p0) };
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+	}
+
+	class Simplifier final
+	{
+	public:
+		Simplifier(std::span<const uint32_t> indices, std::span<const Vertex3D> vertices) :
+			m_Vertices{ vertices },
+			m_Indices(indices.begin(), indices.end()),
+			m_TriangleRemoved(indices.size() / 3, false),
+			m_VertexTriangles(vertices.size()),
+			m_Quadrics(vertices.size()),
+			m_Versions(vertices.size(), 0),
+			m_Locked(vertices.size(), false),
+			m_Removed(vertices.size(), false),
+			m_LiveTriangles{ indices.size() / 3 }
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeUseCounts{};
+			edgeUseCounts.reserve(indices.size());
+
+			for (uint32_t t{}; t < m_LiveTriangles; ++t)
+			{
+				const uint32_t* pTriangle{ &m_Indices[t * 3] };
+				const XMFLOAT3& p0{ m_Vertices[pTriangle[0]].m_Position };
+
+				XMFLOAT3 normal{};
+				XMStoreFloat3(&normal, XMVector3Normalize(TriangleNormal(p0, m_Vertices[pTriangle[1]].m_Position, m_Vertices[pTriangle[2]].m_Position)));
+				const double d{ -(double{ normal.x } * p0.x + double{ normal.y } * p0.y + double{ normal.z } * p0.z) };
+				const Quadric plane{ Quadric::FromPlane(normal.x, normal.y, normal.z, d) };
+
+				for (uint32_t k{}; k < 3; ++k)
+				{
+					const uint32_t a{ pTriangle[k] };
+					const uint32_t b{ pTriangle[(k + 1) % 3] };
+
+					m_Quadrics[a] += plane;
+					m_VertexTriangles[a].emplace_back(t);
+					++edgeUseCounts[(uint64_t{ std::min(a, b) } << 32) | std::max(a, b)];
+				}
+			}
+
+			// Seams are split into distinct vertices by the welder, to the index topology they look like open borders
+			for (const auto& [edge, useCount] : edgeUseCounts)
+			{
+				if (useCount != 2)
+				{
+					m_Locked[static_cast<uint32_t>(edge >> 32)] = true;
+					m_Locked[static_cast<uint32_t>(edge)] = true;
+				}
+			}
+		}
+
+		float Run(size_t targetIndexCount, float targetError, std::vector<uint32_t>& result)
+		{
+			for (uint32_t t{}; t < m_LiveTriangles; ++t)
+			{
+				for (uint32_t k{}; k < 3; ++k)
+					PushCollapse(m_Indices[t * 3 + k], m_Indices[t * 3 + (k + 1) % 3]);
+			}
+
+			const double maxCost{ double{ targetError } * targetError };
+			double acceptedCost{};
+
+			while (!m_Collapses.empty() && m_LiveTriangles * 3 > targetIndexCount)
+			{
+				const Collapse collapse{ m_Collapses.top() };
+				m_Collapses.pop();
+
+				if (m_Removed[collapse.m_From] || m_Removed[collapse.m_To]
+					|| collapse.m_FromVersion != m_Versions[collapse.m_From] || collapse.m_ToVersion != m_Versions[collapse.m_To])
+					continue;
+
+				if (collapse.m_Cost > maxCost)
+					break;
+
+				if (!IsCollapseValid(collapse.m_From, collapse.m_To))
+					continue;
+
+				ApplyCollapse(collapse.m_From, collapse.m_To);
+				acceptedCost = std::max(acceptedCost, collapse.m_Cost);
+			}
+
+			result.clear();
+			result.reserve(m_LiveTriangles * 3);
+			for (size_t t{}; t < m_TriangleRemoved.size(); ++t)
+			{
+				if (!m_TriangleRemoved[t])
+					result.insert(result.end(), m_Indices.begin() + t * 3, m_Indices.begin() + t * 3 + 3);
+			}
+
+			return static_cast<float>(std::sqrt(acceptedCost));
+		}
+
+	private:
+		std::span<const Vertex3D> m_Vertices;
+		std::vector<uint32_t> m_Indices;
+		std::vector<bool> m_TriangleRemoved;
+		std::vector<std::vector<uint32_t>> m_VertexTriangles;
+		std::vector<Quadric> m_Quadrics;
+		std::vector<uint32_t> m_Versions;
+		std::vector<bool> m_Locked;
+		std::vector<bool> m_Removed;
+		size_t m_LiveTriangles;
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> m_Collapses{};
+		std::vector<uint32_t> m_FromNeighbours{};
+		std::vector<uint32_t> m_ToNeighbours{};
+
+		void PushCollapse(uint32_t from, uint32_t to)
+		{
+			if (m_Locked[from])
+				return;
+
+			Quadric quadric{ m_Quadrics[from] };
+			quadric += m_Quadrics[to];
+
+			m_Collapses.emplace(Collapse{ std::max(quadric.Evaluate(m_Vertices[to].m_Position), 0.0), from, to, m_Versions[from], m_Versions[to] });
+		}
+
+		void GatherNeighbours(uint32_t v, std::vector<uint32_t>& neighbours) const
+		{
+			neighbours.clear();
+			for (const uint32_t t : m_VertexTriangles[v])
+			{
+				if (m_TriangleRemoved[t])
+					continue;
+
+				for (uint32_t k{}; k < 3; ++k)
+				{
+					const uint32_t w{ m_Indices[t * 3 + k] };
+					if (w != v && std::ranges::find(neighbours, w) == neighbours.end())
+						neighbours.emplace_back(w);
+				}
+			}
+		}
+
+		bool IsCollapseValid(uint32_t from, uint32_t to)
+		{
+			// Link condition: an interior edge has exactly two opposite vertices, sharing more would pinch the surface
+			GatherNeighbours(from, m_FromNeighbours);
+			GatherNeighbours(to, m_ToNeighbours);
+
+			uint32_t sharedNeighbours{};
+			for (const uint32_t w : m_FromNeighbours)
+				sharedNeighbours += std::ranges::find(m_ToNeighbours, w) != m_ToNeighbours.end();
+
+			if (sharedNeighbours > 2)
+				return false;
+
+			// Triangles that survive the collapse must not flip or degenerate
+			for (const uint32_t t : m_VertexTriangles[from])
+			{
+				if (m_TriangleRemoved[t])
+					continue;
+
+				const uint32_t* pTriangle{ &m_Indices[t * 3] };
+				if (pTriangle[0] == to || pTriangle[1] == to || pTriangle[2] == to)
+					continue;
+
+				XMFLOAT3 positions[3]{};
+				for (uint32_t k{}; k < 3; ++k)
+					positions[k] = m_Vertices[pTriangle[k]].m_Position;
+
+				const XMVECTOR before{ TriangleNormal(positions[0], positions[1], positions[2]) };
+				for (uint32_t k{}; k < 3; ++k)
+				{
+					if (pTriangle[k] == from)
+						positions[k] = m_Vertices[to].m_Position;
+				}
+				const XMVECTOR after{ TriangleNormal(positions[0], positions[1], positions[2]) };
+
+				if (XMVectorGetX(XMVector3LengthSq(after)) == 0.0f || XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f)
+					return false;
+			}
+
+			return true;
+		}
+
+		void ApplyCollapse(uint32_t from, uint32_t to)
+		{
+			for (const uint32_t t : m_VertexTriangles[from])
+			{
+				if (m_TriangleRemoved[t])
+					continue;
+
+				uint32_t* pTriangle{ &m_Indices[t * 3] };
+				if (pTriangle[0] == to || pTriangle[1] == to || pTriangle[2] == to)
+				{
+					m_TriangleRemoved[t] = true;
+					--m_LiveTriangles;
+					continue;
+				}
+
+				for (uint32_t k{}; k < 3; ++k)
+				{
+					if (pTriangle[k] == from)
+						pTriangle[k] = to;
+				}
+				m_VertexTriangles[to].emplace_back(t);
+			}
+
+			m_VertexTriangles[from].clear();
+			m_Removed[from] = true;
+			m_Quadrics[to] += m_Quadrics[from];
+			++m_Versions[to];
+
+			// Costs around the merged vertex changed, older entries are skipped thanks to the version bump
+			std::erase_if(m_VertexTriangles[to], [this](uint32_t t) { return m_TriangleRemoved[t]; });
+			GatherNeighbours(to, m_ToNeighbours);
+			for (const uint32_t w : m_ToNeighbours)
+			{
+				PushCollapse(w, to);
+				PushCollapse(to, w);
+			}
+		}
+	};
+}
+
+float MeshSimplifier::Simplify(std::span<const uint32_t> indices, std::span<const Vertex3D> vertices, size_t targetIndexCount, float targetError, std::vector<uint32_t>& result)
+{
+	PROFILE_FUNCTION();
+
+	Simplifier simplifier{ indices, vertices };
+	return simplifier.Run(targetIndexCount, targetError, result);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <span>
+
+#include "Vertex.h"
+
+namespace MeshSimplifier
+{
+	// Quadric error edge collapses (Garland, Heckbert 1997) onto existing vertices, so LODs can share the source vertex buffer.
+	// Vertices on open borders and attribute seams never move. Stops at targetIndexCount or when the next collapse would
+	// exceed targetError, returns the largest error accepted, in mesh units.
+	float Simplify(std::span<const uint32_t> indices, std::span<const Vertex3D> vertices, size_t targetIndexCount, float targetError, std::vector<uint32_t>& result);
+}
+
+#endif //MESHSIMPLIFIER_H
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "MeshletBuilder.h"
+
+
+namespace
+{
+	constexpr uint8_t sk_NotInMeshlet{ 0xFF };
+
+	void ComputeBounds(Meshlet& meshlet, std::span<const Vertex3D> vertices, std::span<const uint32_t> meshletVertices, std::span<const uint8_t> meshletTriangles)
+	{
+		XMVECTOR boundsMin{ g_XMFltMax };
+		XMVECTOR boundsMax{ XMVectorNegate(g_XMFltMax) };
+		for (const uint32_t v : meshletVertices)
+		{
+			const XMVECTOR position{ XMLoadFloat3(&vertices[v].m_Position) };
+			boundsMin = XMVectorMin(boundsMin, position);
+			boundsMax = XMVectorMax(boundsMax, position);
+		}
+
+		const XMVECTOR center{ XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f) };
+		XMVECTOR radius{ XMVectorZero() };
+		for (const uint32_t v : meshletVertices)
+			radius = XMVectorMax(radius, XMVector3Length(XMVectorSubtract(XMLoadFloat3(&vertices[v].m_Position), center)));
+
+		XMStoreFloat3(&meshlet.m_Center, center);
+		meshlet.m_Radius = XMVectorGetX(radius);
+
+		std::vector<XMVECTOR> normals{};
+		normals.reserve(meshlet.m_TriangleCount);
+
+		XMVECTOR axis{ XMVectorZero() };
+		for (uint32_t t{}; t < meshlet.m_TriangleCount; ++t)
+		{
+			const XMVECTOR p0{ XMLoadFloat3(&vertices[meshletVertices[meshletTriangles[t * 3 + 0]]].m_Position) };
+			const XMVECTOR p1{ XMLoadFloat3(&vertices[meshletVertices[meshletTriangles[t * 3 + 1]]].m_Position) };
+			const XMVECTOR p2{ XMLoadFloat3(&vertices[meshletVertices[meshletTriangles[t * 3 + 2]]].m_Position) };
+
+			const XMVECTOR normal{ XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)) };
+			if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+				continue;
+
+			normals.emplace_back(XMVector3Normalize(normal));
+			axis = XMVectorAdd(axis, normals.back());
+		}
+
+		meshlet.m_ConeAxis = XMFLOAT3{ 0.0f, 0.0f, 0.0f };
+		meshlet.m_ConeCutoff = 1.0f;
+
+		if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) < 1e-8f)
+			return;
+
+		axis = XMVector3Normalize(axis);
+
+		float minDot{ 1.0f };
+		for (const XMVECTOR& normal : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(normal, axis)));
+
+		// Normals spread over more than a hemisphere, some triangle always faces the camera
+		if (minDot <= 0.0f)
+			return;
+
+		XMStoreFloat3(&meshlet.m_ConeAxis, axis);
+		meshlet.m_ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void MeshletBuilder::Build(std::span<const uint32_t> indices, std::span<const Vertex3D> vertices, std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+{
+	PROFILE_FUNCTION();
+
+	std::vector<uint8_t> localIndices(vertices.size(), sk_NotInMeshlet);
+
+	Meshlet current{
+		.m_VertexOffset = static_cast<uint32_t>(meshletVertices.size()),
+		.m_TriangleOffset = static_cast<uint32_t>(meshletTriangles.size()),
+	};
+
+	const auto flush{ [&]()
+	{
+		if (current.m_TriangleCount == 0)
+			return;
+
+		const std::span<const uint32_t> currentVertices{ meshletVertices.data() + current.m_VertexOffset, current.m_VertexCount };
+		for (const uint32_t v : currentVertices)
+			localIndices[v] = sk_NotInMeshlet;
+
+		ComputeBounds(current, vertices, currentVertices, { meshletTriangles.data() + current.m_TriangleOffset, current.m_TriangleCount * 3 });
+		meshlets.emplace_back(current);
+
+		// Keeps every meshlet's triangles readable as whole uint32 words
+		meshletTriangles.resize((meshletTriangles.size() + 3) & ~size_t{ 3 });
+
+		current = Meshlet{
+			.m_VertexOffset = static_cast<uint32_t>(meshletVertices.size()),
+			.m_TriangleOffset = static_cast<uint32_t>(meshletTriangles.size()),
+		};
+	} };
+
+	for (size_t i{}; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t newVertices{};
+		for (size_t k{}; k < 3; ++k)
+			newVertices += localIndices[indices[i + k]] == sk_NotInMeshlet;
+
+		if (current.m_VertexCount + newVertices > sk_MaxVertices || current.m_TriangleCount == sk_MaxTriangles)
+			flush();
+
+		for (size_t k{}; k < 3; ++k)
+		{
+			const uint32_t v{ indices[i + k] };
+			if (localIndices[v] == sk_NotInMeshlet)
+			{
+				localIndices[v] = static_cast<uint8_t>(current.m_VertexCount++);
+				meshletVertices.emplace_back(v);
+			}
+
+			meshletTriangles.emplace_back(localIndices[v]);
+		}
+
+		++current.m_TriangleCount;
+	}
+
+	flush();
+}
\ No newline at end of file
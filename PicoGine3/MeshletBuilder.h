@@ -0,0 +1,34 @@
+#ifndef MESHLETBUILDER_H
+#define MESHLETBUILDER_H
+
+#include <span>
+
+#include "Vertex.h"
+
+// Cluster of up to sk_MaxVertices vertices and sk_MaxTriangles triangles, laid out for std430 storage buffers
+struct Meshlet final
+{
+	uint32_t m_VertexOffset{};   // Into the meshlet vertex stream, which holds indices into the vertex buffer
+	uint32_t m_TriangleOffset{}; // Into the meshlet triangle stream, in bytes, always 4 bytes aligned
+	uint32_t m_VertexCount{};
+	uint32_t m_TriangleCount{};
+	XMFLOAT3 m_Center{};
+	float m_Radius{};
+	// Backface cone, the whole meshlet faces away when dot(center - camera, axis) >= cutoff * length(center - camera) + radius.
+	// Normals follow the index winding (cross(p1 - p0, p2 - p0)), a cutoff of 1 never culls.
+	XMFLOAT3 m_ConeAxis{};
+	float m_ConeCutoff{};
+};
+
+namespace MeshletBuilder
+{
+	// Mesh shader friendly output sizes, 124 triangles keep the 3 bytes per triangle stream a multiple of 4
+	constexpr uint32_t sk_MaxVertices{ 64 };
+	constexpr uint32_t sk_MaxTriangles{ 124 };
+
+	// Splits the triangles in index order, run it after the vertex cache optimization so neighbouring triangles stay together.
+	// Appends to the output streams, the triangle stream holds 3 local vertex indices per triangle.
+	void Build(std::span<const uint32_t> indices, std::span<const Vertex3D> vertices, std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles);
+}
+
+#endif //MESHLETBUILDER_H
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "MicroBenchmarks.h"
+
+#include <fstream>
+
+#pragma warning(push)
+#pragma warning(disable:26495)
+#pragma warning(disable:26819)
+#include <nlohmann/json.hpp>
+#pragma warning(pop)
+
+#include "Vertex.h"
+#include "VertexWelder.h"
+
+using namespace std::chrono;
+
+namespace
+{
+	constexpr uint32_t sk_NumIterations{ 7 };
+
+	template<typename Func>
+	nlohmann::json TimeCase(const std::string& name, Func&& func)
+	{
+		std::vector<double> samples{};
+		samples.reserve(sk_NumIterations);
+
+		for (uint32_t i{}; i < sk_NumIterations; ++i)
+		{
+			const auto start{ steady_clock::now() };
+			func();
+			samples.emplace_back(duration<double, std::milli>(steady_clock::now() - start).count());
+		}
+
+		std::ranges::sort(samples);
+		const double minMs{ samples.front() };
+		const double medianMs{ samples[samples.size() / 2] };
+
+		Logger::Get().LogInfo(std::format(L"  {:<24} min {:8.2f} ms, median {:8.2f} ms", std::wstring{ name.begin(), name.end() }, minMs, medianMs));
+
+		return {
+			{ "name", name },
+			{ "min", minMs },
+			{ "p50", medianMs },
+		};
+	}
+
+	// Unwelded triangle list of a gridSize x gridSize quad grid, 6 corners per quad like Assimp produces for obj files
+	std::vector<Vertex3D> GenerateCornerGrid(uint32_t gridSize)
+	{
+		std::vector<Vertex3D> corners{};
+		corners.reserve(size_t{ gridSize } * gridSize * 6);
+
+		const float invSize{ 1.0f / static_cast<float>(gridSize) };
+		auto corner = [&](uint32_t x, uint32_t z)
+		{
+			Vertex3D& vertex{ corners.emplace_back() };
+			vertex.m_Position = { static_cast<float>(x), 0.0f, static_cast<float>(z) };
+			vertex.m_Texcoord = { static_cast<float>(x) * invSize, static_cast<float>(z) * invSize };
+		};
+
+		for (uint32_t z{}; z < gridSize; ++z)
+		{
+			for (uint32_t x{}; x < gridSize; ++x)
+			{
+				corner(x, z);
+				corner(x, z + 1);
+				corner(x + 1, z + 1);
+				corner(x, z);
+				corner(x + 1, z + 1);
+				corner(x + 1, z);
+			}
+		}
+
+		return corners;
+	}
+
+	nlohmann::json RunVertexWeld(uint32_t gridSize)
+	{
+		const std::vector<Vertex3D> corners{ GenerateCornerGrid(gridSize) };
+		const uint32_t expectedUnique{ (gridSize + 1) * (gridSize + 1) };
+
+		Logger::Get().LogInfo(std::format(L"Vertex weld, {} corners -> {} unique vertices", corners.size(), expectedUnique));
+
+		std::vector<Vertex3D> uniqueVertices{};
+		std::vector<uint32_t> indices{};
+		std::vector<uint32_t> remap(corners.size());
+		bool isValid{ true };
+
+		nlohmann::json cases{ nlohmann::json::array() };
+
+		// The import path before the welder, kept here as the reference
+		cases.emplace_back(TimeCase("unordered_map", [&]
+		{
+			uniqueVertices.clear();
+			indices.clear();
+			indices.reserve(corners.size());
+			std::unordered_map<Vertex3D, uint32_t> lookup;
+
+			for (const Vertex3D& vertex : corners)
+			{
+				if (!lookup.contains(vertex))
+				{
+					lookup[vertex] = static_cast<uint32_t>(uniqueVertices.size());
+					uniqueVertices.emplace_back(vertex);
+				}
+
+				indices.emplace_back(lookup[vertex]);
+			}
+
+			isValid &= uniqueVertices.size() == expectedUnique;
+		}));
+
+		cases.emplace_back(TimeCase("VertexWelder::Weld", [&]
+		{
+			isValid &= VertexWelder::Weld(corners, uniqueVertices, remap) == expectedUnique;
+		}));
+
+		cases.emplace_back(TimeCase("VertexWelder::WeldParallel", [&]
+		{
+			isValid &= VertexWelder::WeldParallel(corners, uniqueVertices, remap) == expectedUnique;
+		}));
+
+		if (!isValid)
+			Logger::Get().LogWarning(L"Vertex weld benchmark produced an unexpected unique vertex count.");
+
+		return {
+			{ "name", "VertexWeld" },
+			{ "inputVertices", corners.size() },
+			{ "uniqueVertices", expectedUnique },
+			{ "valid", isValid },
+			{ "cases", cases },
+		};
+	}
+}
+
+void MicroBenchmarks::Run(const std::wstring& reportPath)
+{
+	PROFILE_FUNCTION();
+
+	nlohmann::json report{};
+	report["iterations"] = sk_NumIterations;
+
+	nlohmann::json& benchmarks{ report["benchmarks"] = nlohmann::json::array() };
+	benchmarks.emplace_back(RunVertexWeld(256));
+	benchmarks.emplace_back(RunVertexWeld(1024));
+
+	std::ofstream file{ reportPath };
+	if (!file)
+	{
+		Logger::Get().LogWarning(std::format(L"Could not open micro-benchmark report file {}", reportPath));
+		return;
+	}
+
+	file << report.dump(4);
+	Logger::Get().LogInfo(std::format(L"Micro-benchmark report written to {}", reportPath));
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#ifndef MICROBENCHMARKS_H
+#define MICROBENCHMARKS_H
+
+// Isolated CPU benchmarks of engine algorithms against the code they replaced, run with --microbench
+namespace MicroBenchmarks
+{
+	void Run(const std::wstring& reportPath);
+}
+
+#endif //MICROBENCHMARKS_H
\ No newline at end of file
@@ -80,9 +80,9 @@ public:
 		uint32_t idx;
 		if (m_FreeListHead != sk_EndOfList)
 		{
-			idx = sk_EndOfList;
-			m_FreeListHead = m_Objects[idx].nextFree_;
-			m_Objects[idx].obj_ = std::move(obj);
+			idx = m_FreeListHead;
+			m_FreeListHead = m_Objects[idx].m_NextFree;
+			m_Objects[idx].m_Obj = std::move(obj);
 		}
 		else
 		{
@@ -90,34 +90,34 @@ public:
 			m_Objects.emplace_back(obj);
 		}
 		++m_ObjectCount;
-		return Handle<ObjType>(idx, m_Objects[idx].gen_);
+		return Handle<ObjType>(idx, m_Objects[idx].m_Gen);
 	}
 
 	void Remove(Handle<ObjType> handle)
 	{
-		if (handle.empty())
+		if (handle.Empty())
 			return;
 
 		assert(m_ObjectCount > 0); // double deletion
-		const uint32_t index{ handle.index() };
+		const uint32_t index{ handle.Index() };
 		assert(index < m_Objects.size());
-		assert(handle.gen() == m_Objects[index].gen_); // double deletion
-		m_Objects[index].obj_ = ObjType{};
-		++m_Objects[index].gen_;
-		m_Objects[index].nextFree_ = m_FreeListHead;
+		assert(handle.Gen() == m_Objects[index].m_Gen); // double deletion
+		m_Objects[index].m_Obj = ObjType{};
+		++m_Objects[index].m_Gen;
+		m_Objects[index].m_NextFree = m_FreeListHead;
 		m_FreeListHead = index;
 		--m_ObjectCount;
 	}
 
 	[[nodiscard]] ObjType* Get(Handle<ObjType> handle) const
 	{
-		if (handle.empty())
+		if (handle.Empty())
 			return nullptr;
 
-		const uint32_t index = handle.index();
+		const uint32_t index = handle.Index();
 		assert(index < m_Objects.size());
-		assert(handle.gen() == m_Objects[index].gen_); // accessing deleted object
-		return &m_Objects[index].obj_;
+		assert(handle.Gen() == m_Objects[index].m_Gen); // accessing deleted object
+		return &m_Objects[index].m_Obj;
 	}
 
 	[[nodiscard]] uint32_t GetObjectCount() const
@@ -143,9 +143,10 @@ private:
 		explicit PoolEntry(ObjType& obj) : m_Obj(std::move(obj)) {}
 	};
 
-	std::vector<PoolEntry> m_Objects;
-	uint32_t m_FreeListHead;
-	uint32_t m_ObjectCount;
+	// Handles give out mutable access to pooled objects, even through a const pool
+	mutable std::vector<PoolEntry> m_Objects;
+	uint32_t m_FreeListHead{ sk_EndOfList };
+	uint32_t m_ObjectCount{};
 };
 
 #endif //SIMPLEPOOL_H
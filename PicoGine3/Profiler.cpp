@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#include <fstream>
+
+#include "Settings.h"
+
+namespace
+{
+	void WriteEscaped(std::ofstream& file, const char* str)
+	{
+		for (; *str; ++str)
+		{
+			if (*str == '"' || *str == '\\')
+				file << '\\';
+			file << *str;
+		}
+	}
+}
+
+void Profiler::Initialize()
+{
+	const auto& settings{ Settings::Get() };
+
+	if (settings.IsProfilingEnabled())
+	{
+#if defined(_PROFILE)
+		m_CaptureBeginNs = Now();
+		m_IsCapturing.store(true, std::memory_order_relaxed);
+#else
+		Logger::Get().LogWarning(L"--profile was requested but this build was compiled without _PROFILE, no trace will be written.");
+#endif //defined(_PROFILE)
+	}
+
+	m_IsInitialized = true;
+}
+
+bool Profiler::IsInitialized() const
+{
+	return m_IsInitialized;
+}
+
+void Profiler::RecordZone(const char* name, int64_t beginNs, int64_t endNs)
+{
+	ThreadEventBuffer* pBuffer{ GetThreadBuffer() };
+
+	const uint32_t index{ pBuffer->m_Count.load(std::memory_order_relaxed) };
+	if (index >= sk_EventsPerThread)
+	{
+		pBuffer->m_Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	pBuffer->m_pEvents[index] = ZoneEvent{ name, beginNs, endNs };
+	pBuffer->m_Count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	if (!IsCapturing())
+		return;
+
+	GetThreadBuffer()->m_ThreadName.store(name, std::memory_order_release);
+}
+
+void Profiler::WriteTrace()
+{
+	if (!m_IsCapturing.exchange(false))
+		return;
+
+	const std::wstring& tracePath{ Settings::Get().GetProfileOutputPath() };
+	std::ofstream file{ tracePath };
+	if (!file.is_open())
+	{
+		Logger::Get().LogWarning(std::format(L"Could not open profiler trace file {}", tracePath));
+		return;
+	}
+
+	// Streamed by hand, a DOM of every zone would be several times the size of the capture itself
+	const std::lock_guard lock{ m_BuffersMutex };
+
+	size_t numEvents{};
+	size_t numDropped{};
+	bool isFirstEvent{ true };
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	file << std::fixed;
+	file.precision(3);
+
+	for (const auto& pBuffer : m_ThreadBuffers)
+	{
+		const uint32_t count{ pBuffer->m_Count.load(std::memory_order_acquire) };
+		numEvents += count;
+		numDropped += pBuffer->m_Dropped.load(std::memory_order_relaxed);
+
+		if (const char* threadName{ pBuffer->m_ThreadName.load(std::memory_order_acquire) })
+		{
+			file << (isFirstEvent ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << pBuffer->m_ThreadIndex << ",\"args\":{\"name\":\"";
+			WriteEscaped(file, threadName);
+			file << "\"}}";
+			isFirstEvent = false;
+		}
+
+		for (uint32_t i{}; i < count; ++i)
+		{
+			const ZoneEvent& event{ pBuffer->m_pEvents[i] };
+
+			file << (isFirstEvent ? "" : ",") << "\n{\"ph\":\"X\",\"name\":\"";
+			WriteEscaped(file, event.m_Name);
+			file << "\",\"pid\":1,\"tid\":" << pBuffer->m_ThreadIndex
+				<< ",\"ts\":" << static_cast<double>(event.m_BeginNs - m_CaptureBeginNs) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(event.m_EndNs - event.m_BeginNs) / 1000.0 << "}";
+			isFirstEvent = false;
+		}
+	}
+
+	file << "\n]}";
+
+	if (numDropped > 0)
+		Logger::Get().LogWarning(std::format(L"Profiler dropped {} zones, per-thread buffers hold {} events.", numDropped, sk_EventsPerThread));
+
+	Logger::Get().LogInfo(std::format(L"Profiler trace written to {} ({} zones)", tracePath, numEvents));
+}
+
+Profiler::ThreadEventBuffer* Profiler::GetThreadBuffer()
+{
+	thread_local ThreadEventBuffer* pThreadBuffer{};
+
+	if (!pThreadBuffer)
+	{
+		auto pBuffer{ std::make_unique<ThreadEventBuffer>() };
+		pBuffer->m_pEvents = std::make_unique<ZoneEvent[]>(sk_EventsPerThread);
+
+		// Only taken once per thread
+		const std::lock_guard lock{ m_BuffersMutex };
+		pBuffer->m_ThreadIndex = static_cast<uint32_t>(m_ThreadBuffers.size());
+		pThreadBuffer = pBuffer.get();
+		m_ThreadBuffers.emplace_back(std::move(pBuffer));
+	}
+
+	return pThreadBuffer;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "Singleton.h"
+
+// Zones are compiled out entirely unless _PROFILE is defined, at runtime they only record while a capture is running (--profile <file>)
+#if defined(_PROFILE)
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) const ProfileZone PROFILE_CONCAT(profileZone, __LINE__){ name }
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::Get().SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+#endif //defined(_PROFILE)
+
+class Profiler final : public Singleton<Profiler>
+{
+	friend class Singleton<Profiler>;
+	explicit Profiler() = default;
+
+public:
+	~Profiler() override = default;
+
+	Profiler(const Profiler&) noexcept = delete;
+	Profiler& operator=(const Profiler&) noexcept = delete;
+	Profiler(Profiler&&) noexcept = delete;
+	Profiler& operator=(Profiler&&) noexcept = delete;
+
+	void Initialize();
+	[[nodiscard]] bool IsInitialized() const;
+
+	[[nodiscard]] bool IsCapturing() const { return m_IsCapturing.load(std::memory_order_relaxed); }
+	[[nodiscard]] static int64_t Now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+	// name must outlive the capture (string literals, __FUNCTION__)
+	void RecordZone(const char* name, int64_t beginNs, int64_t endNs);
+	void SetThreadName(const char* name);
+
+	// Stops the capture and writes every recorded zone as Chrome trace events (chrome://tracing, ui.perfetto.dev)
+	void WriteTrace();
+
+private:
+	struct ZoneEvent final
+	{
+		const char* m_Name;
+		int64_t m_BeginNs;
+		int64_t m_EndNs;
+	};
+
+	// Written by its owning thread only, m_Count is published with release semantics so the exporter never takes a lock on the hot path
+	struct ThreadEventBuffer final
+	{
+		uint32_t m_ThreadIndex{};
+		std::atomic<const char*> m_ThreadName{};
+		std::unique_ptr<ZoneEvent[]> m_pEvents{};
+		std::atomic<uint32_t> m_Count{};
+		std::atomic<uint32_t> m_Dropped{};
+	};
+
+	static constexpr uint32_t sk_EventsPerThread{ 1u << 18 };
+
+	bool m_IsInitialized{};
+	std::atomic<bool> m_IsCapturing{};
+	int64_t m_CaptureBeginNs{};
+
+	std::mutex m_BuffersMutex{};
+	std::vector<std::unique_ptr<ThreadEventBuffer>> m_ThreadBuffers{};
+
+	ThreadEventBuffer* GetThreadBuffer();
+};
+
+class ProfileZone final
+{
+public:
+	explicit ProfileZone(const char* name) noexcept
+		: m_Name{ Profiler::Get().IsCapturing() ? name : nullptr }
+		, m_BeginNs{ m_Name ? Profiler::Now() : 0 }
+	{
+	}
+
+	~ProfileZone()
+	{
+		if (m_Name)
+			Profiler::Get().RecordZone(m_Name, m_BeginNs, Profiler::Now());
+	}
+
+	ProfileZone(const ProfileZone&) noexcept = delete;
+	ProfileZone& operator=(const ProfileZone&) noexcept = delete;
+	ProfileZone(ProfileZone&&) noexcept = delete;
+	ProfileZone& operator=(ProfileZone&&) noexcept = delete;
+
+private:
+	const char* m_Name;
+	int64_t m_BeginNs;
+};
+
+#endif //PROFILER_H
\ No newline at end of file
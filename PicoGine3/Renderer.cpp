@@ -1,11 +1,50 @@
 #include "pch.h"
 #include "Renderer.h"
 
+#include <bit>
+
+#include "Benchmark.h"
+#include "ResourceManager.h"
+#include "Settings.h"
+
+
+Renderer::~Renderer()
+{
+	if (!m_RenderThread.joinable())
+		return;
+
+	{
+		const std::lock_guard lock{ m_RenderMutex };
+		m_IsStopping = true;
+	}
+	m_RenderCondition.notify_all();
+
+	m_RenderThread.join();
+}
 
 void Renderer::Initialize()
 {
 	m_pGraphicsAPI = std::make_unique<GraphicsAPI>();
 	m_IsInitialized = m_pGraphicsAPI->IsInitialized();
+
+	if (Settings::Get().IsGpuDrivenEnabled())
+	{
+		m_GpuDriven = m_pGraphicsAPI->IsGpuDrivenSupported();
+		if (!m_GpuDriven)
+			Logger::Get().LogWarning(L"drawIndirectCount is not supported, --gpu-driven is ignored.");
+	}
+
+	if (Settings::Get().IsOcclusionCullingEnabled())
+	{
+		m_OcclusionCulling = m_GpuDriven;
+		if (!m_OcclusionCulling)
+			Logger::Get().LogWarning(L"--occlusion-culling requires the GPU-driven path, it is ignored.");
+	}
+
+	// The GPU is then only driven by the render thread, or by the main thread while the render thread waits for a frame
+	m_ThreadedRender = Settings::Get().IsThreadedRenderEnabled();
+	if (m_ThreadedRender)
+		m_RenderThread = std::thread{ &Renderer::RenderThreadLoop, this };
 }
 
 bool Renderer::IsInitialized() const
@@ -20,18 +59,340 @@ GraphicsAPI* Renderer::GetGraphicsAPI() const
 
 void Renderer::DrawMesh(uint32_t meshDataID, uint32_t materialID, const XMFLOAT4X4& transform)
 {
-	m_RenderEntries.emplace_back(RenderEntry{ meshDataID, materialID, transform });
+	// Runs on the main thread while the render thread records with --threaded-render, which decides alone whether the
+	// placeholder is drawn. The LOD is clamped to the placeholder's single level then
+	const MeshData& meshData{ ResourceManager::Get().GetFinalizedMeshData(meshDataID) };
+	const uint32_t lod{ SelectLod(meshData, transform) };
+	m_SimulationEntries.emplace_back(RenderEntry{ meshDataID, materialID, transform, lod, MakeSortKey(meshData, meshDataID, materialID, lod, transform) });
 }
 
 void Renderer::DrawFrame()
 {
-	// For now, brute force rendering, no batching no instancing, simply rendering all models in order.
+	PROFILE_FUNCTION();
+
+	// The previous frame's entries are done with once it is submitted
+	WaitForRenderThread();
+
+	// Meshes finished by the job system are uploaded before BeginFrame() flushes the upload queue. With the render thread idle,
+	// the mesh table and the finalized mesh data only change here and in the loads, upload completion is up to the render thread
+	ResourceManager::Get().FinalizePendingLoads();
+
+	m_RenderEntries.swap(m_SimulationEntries);
+
+	if (!m_ThreadedRender)
+	{
+		RenderFrame();
+		return;
+	}
+
+	{
+		const std::lock_guard lock{ m_RenderMutex };
+		m_IsFramePending = true;
+	}
+	m_RenderCondition.notify_all();
+}
+
+void Renderer::WaitForRenderThread()
+{
+	if (!m_ThreadedRender)
+		return;
+
+	PROFILE_FUNCTION();
+
+	std::unique_lock lock{ m_RenderMutex };
+	m_RenderCondition.wait(lock, [this]() { return !m_IsFramePending; });
+}
+
+void Renderer::RenderThreadLoop()
+{
+	PROFILE_THREAD_NAME("Render");
+
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_RenderMutex };
+			m_RenderCondition.wait(lock, [this]() { return m_IsFramePending || m_IsStopping; });
+
+			// A frame handed over is always finished, the main thread may be waiting on it
+			if (!m_IsFramePending)
+				return;
+		}
+
+		RenderFrame();
+
+		{
+			const std::lock_guard lock{ m_RenderMutex };
+			m_IsFramePending = false;
+		}
+		m_RenderCondition.notify_all();
+	}
+}
+
+void Renderer::RenderFrame()
+{
+	PROFILE_FUNCTION();
+
+	m_Instances.clear();
+	m_Objects.clear();
+
+	// Objects come first in the instance buffer, instance i is culled as object i
+	if (m_GpuDriven)
+		GatherGpuObjects();
+
+	CullEntries();
+
+	const uint32_t firstSortedInstance{ static_cast<uint32_t>(m_Instances.size()) };
+
+	m_SortItems.clear();
+	m_SortItems.reserve(m_RenderEntries.size());
+	for (uint32_t i{}; i < m_RenderEntries.size(); ++i)
+		m_SortItems.emplace_back(SortItem{ m_RenderEntries[i].m_SortKey, i });
+
+	RadixSort(m_SortItems, m_SortScratch);
+
+	m_Instances.reserve(m_Instances.size() + m_SortItems.size());
+	for (const auto& item : m_SortItems)
+		m_Instances.emplace_back(InstanceData{ m_RenderEntries[item.m_EntryIndex].m_TransformMatrix });
+
 	m_pGraphicsAPI->BeginFrame();
+	m_pGraphicsAPI->SetInstanceData(m_Instances);
+
+	if (m_GpuDriven)
+		m_pGraphicsAPI->CullObjects(m_Objects, m_OcclusionCulling);
 
-	for (const auto& entry : m_RenderEntries)
-		m_pGraphicsAPI->DrawMesh(entry.m_MeshDataID, entry.m_MaterialID, entry.m_TransformMatrix);
+	// Runs of keys only differing by depth bucket are a single instanced draw, already ordered front to back
+	m_DrawRunStarts.clear();
+	for (uint32_t i{}; i < m_SortItems.size(); ++i)
+	{
+		if (i == 0 || m_SortItems[i].m_Key >> sk_DepthBits != m_SortItems[i - 1].m_Key >> sk_DepthBits)
+			m_DrawRunStarts.emplace_back(i);
+	}
+	m_DrawRunStarts.emplace_back(static_cast<uint32_t>(m_SortItems.size()));
+
+	// May be called from several threads at once, for disjoint ranges of draws
+	const uint32_t drawCount{ static_cast<uint32_t>(m_DrawRunStarts.size() - 1) };
+	m_pGraphicsAPI->SetMainPassDraws(drawCount, [this, firstSortedInstance](DrawRecorder& recorder, uint32_t firstDraw, uint32_t lastDraw)
+	{
+		for (uint32_t draw{ firstDraw }; draw < lastDraw; ++draw)
+		{
+			const uint32_t first{ m_DrawRunStarts[draw] };
+			const uint32_t last{ m_DrawRunStarts[draw + 1] };
+
+			const RenderEntry& entry{ m_RenderEntries[m_SortItems[first].m_EntryIndex] };
+			m_pGraphicsAPI->DrawMesh(recorder, entry.m_MeshDataID, entry.m_MaterialID, firstSortedInstance + first, last - first, entry.m_Lod);
+		}
+	});
 
 	m_pGraphicsAPI->EndFrame();
 
 	m_RenderEntries.clear();
 }
+
+
+void Renderer::GatherGpuObjects()
+{
+	PROFILE_FUNCTION();
+
+	const auto& resourceManager{ ResourceManager::Get() };
+
+	// Entries the GPU can draw leave the list, the rest keep going through the sorted CPU path
+	size_t remaining{};
+	for (const RenderEntry& entry : m_RenderEntries)
+	{
+		const MeshData& meshData{ resourceManager.GetMeshData(entry.m_MeshDataID) };
+		if (!meshData.m_pGeometryArena || !meshData.IsReady())
+		{
+			m_RenderEntries[remaining++] = entry;
+			continue;
+		}
+
+		const XMVECTOR offset{ XMLoadFloat3(&meshData.m_PositionOffset) };
+		const XMVECTOR scale{ XMLoadFloat3(&meshData.m_PositionScale) };
+
+		// Packed positions are decoded by the instance transform, the shader gets an identity decode
+		const XMMATRIX decode{ XMMatrixMultiply(XMMatrixScalingFromVector(scale), XMMatrixTranslationFromVector(offset)) };
+		InstanceData& instance{ m_Instances.emplace_back() };
+		XMStoreFloat4x4(&instance.m_ModelMat, XMMatrixMultiply(decode, XMLoadFloat4x4(&entry.m_TransformMatrix)));
+
+		// Bounds in stored position space, flat axes of packed meshes have a zero scale
+		const XMVECTOR safeScale{ XMVectorSelect(scale, XMVectorSplatOne(), XMVectorEqual(scale, XMVectorZero())) };
+		const XMVECTOR boundsMin{ XMLoadFloat3(&meshData.m_BoundsMin) };
+		const XMVECTOR boundsMax{ XMLoadFloat3(&meshData.m_BoundsMax) };
+		const XMVECTOR center{ XMVectorDivide(XMVectorSubtract(XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f), offset), safeScale) };
+		const XMVECTOR extent{ XMVectorDivide(XMVectorScale(XMVectorSubtract(boundsMax, boundsMin), 0.5f), safeScale) };
+
+		const MeshLod& meshLod{ meshData.m_Lods[std::min(entry.m_Lod, static_cast<uint32_t>(meshData.m_Lods.size()) - 1)] };
+
+		ObjectData& object{ m_Objects.emplace_back() };
+		XMStoreFloat4(&object.m_BoundsCenter, center);
+		XMStoreFloat4(&object.m_BoundsExtent, extent);
+		object.m_FirstIndex = meshData.m_GeometryRange.m_FirstIndex + meshLod.m_FirstIndex;
+		object.m_IndexCount = meshLod.m_IndexCount;
+		object.m_VertexOffset = static_cast<int32_t>(meshData.m_GeometryRange.m_FirstVertex);
+		object.m_VertexFormat = static_cast<uint32_t>(meshData.m_VertexFormat);
+	}
+
+	m_RenderEntries.resize(remaining);
+}
+
+void Renderer::CullEntries()
+{
+	PROFILE_FUNCTION();
+
+	const auto& resourceManager{ ResourceManager::Get() };
+	const size_t entryCount{ m_RenderEntries.size() };
+	const size_t paddedCount{ (entryCount + sk_CullBatchSize - 1) / sk_CullBatchSize * sk_CullBatchSize };
+
+	for (std::vector<float>* pComponent : { &m_CullBounds.m_CenterX, &m_CullBounds.m_CenterY, &m_CullBounds.m_CenterZ, &m_CullBounds.m_ExtentX, &m_CullBounds.m_ExtentY, &m_CullBounds.m_ExtentZ })
+		pComponent->assign(paddedCount, 0.0f);
+
+	// World space box around the transformed mesh bounds, the extent is the absolute transform applied to the local extent
+	for (size_t i{}; i < entryCount; ++i)
+	{
+		const RenderEntry& entry{ m_RenderEntries[i] };
+		const MeshData& meshData{ resourceManager.GetMeshData(entry.m_MeshDataID) };
+
+		const XMMATRIX world{ XMLoadFloat4x4(&entry.m_TransformMatrix) };
+		const XMVECTOR boundsMin{ XMLoadFloat3(&meshData.m_BoundsMin) };
+		const XMVECTOR boundsMax{ XMLoadFloat3(&meshData.m_BoundsMax) };
+		const XMVECTOR localExtent{ XMVectorScale(XMVectorSubtract(boundsMax, boundsMin), 0.5f) };
+
+		const XMVECTOR center{ XMVector3Transform(XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f), world) };
+		const XMVECTOR extent{ XMVectorAdd(XMVectorAdd(
+			XMVectorMultiply(XMVectorAbs(world.r[0]), XMVectorSplatX(localExtent)),
+			XMVectorMultiply(XMVectorAbs(world.r[1]), XMVectorSplatY(localExtent))),
+			XMVectorMultiply(XMVectorAbs(world.r[2]), XMVectorSplatZ(localExtent))) };
+
+		m_CullBounds.m_CenterX[i] = XMVectorGetX(center);
+		m_CullBounds.m_CenterY[i] = XMVectorGetY(center);
+		m_CullBounds.m_CenterZ[i] = XMVectorGetZ(center);
+		m_CullBounds.m_ExtentX[i] = XMVectorGetX(extent);
+		m_CullBounds.m_ExtentY[i] = XMVectorGetY(extent);
+		m_CullBounds.m_ExtentZ[i] = XMVectorGetZ(extent);
+	}
+
+	struct SplatPlane
+	{
+		XMVECTOR m_X, m_Y, m_Z, m_W;
+		XMVECTOR m_AbsX, m_AbsY, m_AbsZ;
+	};
+
+	const auto frustumPlanes{ m_pGraphicsAPI->GetFrustumPlanes() };
+	std::array<SplatPlane, 6> planes{};
+	for (size_t p{}; p < planes.size(); ++p)
+	{
+		const XMFLOAT4& plane{ frustumPlanes[p] };
+		planes[p] = SplatPlane{ XMVectorReplicate(plane.x), XMVectorReplicate(plane.y), XMVectorReplicate(plane.z), XMVectorReplicate(plane.w),
+			XMVectorReplicate(std::abs(plane.x)), XMVectorReplicate(std::abs(plane.y)), XMVectorReplicate(std::abs(plane.z)) };
+	}
+
+	// Four boxes against one plane per iteration, a box is out when its center is further behind any plane than its projected radius
+	m_CullResults.resize(paddedCount);
+	for (size_t i{}; i < paddedCount; i += sk_CullBatchSize)
+	{
+		const XMVECTOR centerX{ XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_CullBounds.m_CenterX[i])) };
+		const XMVECTOR centerY{ XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_CullBounds.m_CenterY[i])) };
+		const XMVECTOR centerZ{ XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_CullBounds.m_CenterZ[i])) };
+		const XMVECTOR extentX{ XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_CullBounds.m_ExtentX[i])) };
+		const XMVECTOR extentY{ XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_CullBounds.m_ExtentY[i])) };
+		const XMVECTOR extentZ{ XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_CullBounds.m_ExtentZ[i])) };
+
+		XMVECTOR outside{ XMVectorFalseInt() };
+		for (const SplatPlane& plane : planes)
+		{
+			const XMVECTOR distance{ XMVectorMultiplyAdd(plane.m_Z, centerZ, XMVectorMultiplyAdd(plane.m_Y, centerY, XMVectorMultiplyAdd(plane.m_X, centerX, plane.m_W))) };
+			const XMVECTOR radius{ XMVectorMultiplyAdd(plane.m_AbsZ, extentZ, XMVectorMultiplyAdd(plane.m_AbsY, extentY, XMVectorMultiply(plane.m_AbsX, extentX))) };
+			outside = XMVectorOrInt(outside, XMVectorLess(distance, XMVectorNegate(radius)));
+		}
+
+		XMStoreInt4(&m_CullResults[i], outside);
+	}
+
+	size_t visibleCount{};
+	for (size_t i{}; i < entryCount; ++i)
+	{
+		if (!m_CullResults[i])
+			m_RenderEntries[visibleCount++] = m_RenderEntries[i];
+	}
+	m_RenderEntries.resize(visibleCount);
+
+	auto& benchmark{ Benchmark::Get() };
+	if (benchmark.IsEnabled())
+	{
+		benchmark.SetCounter("cpuCullVisibleEntries", visibleCount);
+		benchmark.SetCounter("cpuCullCulledEntries", entryCount - visibleCount);
+	}
+}
+
+uint32_t Renderer::SelectLod(const MeshData& meshData, const XMFLOAT4X4& transform) const
+{
+	if (meshData.m_Lods.size() < 2)
+		return 0;
+
+	const XMMATRIX world{ XMLoadFloat4x4(&transform) };
+	const XMVECTOR boundsMin{ XMLoadFloat3(&meshData.m_BoundsMin) };
+	const XMVECTOR boundsMax{ XMLoadFloat3(&meshData.m_BoundsMax) };
+
+	// Bounding sphere in world space, scaled by the largest axis scale
+	const XMVECTOR center{ XMVector3Transform(XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f), world) };
+	const float scale{ std::max({ XMVectorGetX(XMVector3Length(world.r[0])), XMVectorGetX(XMVector3Length(world.r[1])), XMVectorGetX(XMVector3Length(world.r[2])) }) };
+	const float radius{ XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin))) * 0.5f * scale };
+
+	const float distance{ XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&m_pGraphicsAPI->GetCameraPosition())))) - radius };
+	if (distance <= 0.0f)
+		return 0;
+
+	// Projected size of one object space unit at the closest point of the bounds
+	const float pixelsPerUnit{ m_pGraphicsAPI->GetProjectionScale() * scale / distance };
+
+	uint32_t lod{};
+	while (lod + 1 < meshData.m_Lods.size() && meshData.m_Lods[lod + 1].m_Error * pixelsPerUnit <= sk_LodErrorThresholdPixels)
+		++lod;
+
+	return lod;
+}
+
+uint64_t Renderer::MakeSortKey(const MeshData& meshData, uint32_t meshDataID, uint32_t materialID, uint32_t lod, const XMFLOAT4X4& transform) const
+{
+	const XMVECTOR position{ XMVectorSet(transform._41, transform._42, transform._43, 1.0f) };
+	const float distance{ XMVectorGetX(XMVector3Length(XMVectorSubtract(position, XMLoadFloat3(&m_pGraphicsAPI->GetCameraPosition())))) };
+
+	// Positive floats order like their bit patterns, the upper bits give a logarithmic bucket without knowing the far plane
+	const uint64_t depthBucket{ std::bit_cast<uint32_t>(distance) >> (32 - sk_DepthBits) };
+
+	assert(meshDataID < 1ull << sk_MeshBits && materialID < 1ull << sk_MaterialBits && L"Sort key field overflow.");
+
+	uint64_t key{ static_cast<uint64_t>(meshData.m_VertexFormat) };
+	key = key << sk_MaterialBits | materialID;
+	key = key << sk_MeshBits | meshDataID;
+	key = key << sk_LodBits | std::min(lod, (1u << sk_LodBits) - 1);
+	key = key << sk_DepthBits | depthBucket;
+
+	return key;
+}
+
+void Renderer::RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch)
+{
+	PROFILE_FUNCTION();
+
+	scratch.resize(items.size());
+
+	for (uint32_t shift{}; shift < 64; shift += 8)
+	{
+		std::array<uint32_t, 256> offsets{};
+		for (const auto& item : items)
+			++offsets[item.m_Key >> shift & 0xFF];
+
+		if (std::ranges::find(offsets, static_cast<uint32_t>(items.size())) != offsets.end())
+			continue;
+
+		uint32_t sum{};
+		for (auto& offset : offsets)
+			sum += std::exchange(offset, sum);
+
+		for (const auto& item : items)
+			scratch[offsets[item.m_Key >> shift & 0xFF]++] = item;
+
+		items.swap(scratch);
+	}
+}
@@ -3,8 +3,12 @@
 
 #include "Singleton.h"
 
+#include <condition_variable>
+#include <thread>
+
 #include "GraphicsAPI.h"
 
+struct MeshData;
 
 class Renderer final : public Singleton<Renderer>
 {
@@ -16,10 +20,29 @@ class Renderer final : public Singleton<Renderer>
 		uint32_t m_MeshDataID{};
 		uint32_t m_MaterialID{};
 		XMFLOAT4X4 m_TransformMatrix{};
+		uint32_t m_Lod{};
+		uint64_t m_SortKey{};
+	};
+
+	// World space boxes of the frame's entries, one array per component, padded to a multiple of sk_CullBatchSize
+	struct CullBounds
+	{
+		std::vector<float> m_CenterX{};
+		std::vector<float> m_CenterY{};
+		std::vector<float> m_CenterZ{};
+		std::vector<float> m_ExtentX{};
+		std::vector<float> m_ExtentY{};
+		std::vector<float> m_ExtentZ{};
+	};
+
+	struct SortItem
+	{
+		uint64_t m_Key{};
+		uint32_t m_EntryIndex{};
 	};
 
 public:
-	~Renderer() override = default;
+	~Renderer() override;
 
 	Renderer(const Renderer&) noexcept = delete;
 	Renderer& operator=(const Renderer&) noexcept = delete;
@@ -32,14 +55,68 @@ public:
 	[[nodiscard]] GraphicsAPI* GetGraphicsAPI() const;
 
 	void DrawMesh(uint32_t meshDataID, uint32_t materialID, const XMFLOAT4X4& transform);
+	// With --threaded-render, hands the frame's entries over to the render thread once it is done with the previous frame, and
+	// returns while it records and submits them. The simulation of the next frame then overlaps with the rendering of this one
 	void DrawFrame();
+	// Returns once the last frame handed over has been submitted, before reading what the render thread writes
+	void WaitForRenderThread();
 
 private:
 	bool m_IsInitialized{};
+	bool m_GpuDriven{};
+	bool m_OcclusionCulling{};
+	bool m_ThreadedRender{};
 
 	std::unique_ptr<GraphicsAPI> m_pGraphicsAPI{};
 
+	// Double buffered: DrawMesh() fills the simulation entries, swapped with the rendered ones when the frame is handed over.
+	// The camera is still hardcoded in GraphicsAPI, there is no camera state to hand over with them
+	std::vector<RenderEntry> m_SimulationEntries{};
 	std::vector<RenderEntry> m_RenderEntries{};
+	std::thread m_RenderThread{};
+	std::mutex m_RenderMutex{};
+	std::condition_variable m_RenderCondition{};
+	bool m_IsFramePending{}; // Handed over and not submitted yet
+	bool m_IsStopping{};
+
+	// Only touched by the thread rendering
+	std::vector<InstanceData> m_Instances{};
+	std::vector<ObjectData> m_Objects{};
+	std::vector<SortItem> m_SortItems{};
+	std::vector<SortItem> m_SortScratch{};
+	// Index of the first sorted item of every instanced draw, followed by the item count
+	std::vector<uint32_t> m_DrawRunStarts{};
+	CullBounds m_CullBounds{};
+	std::vector<uint32_t> m_CullResults{};
+
+	// Coarsest level whose error stays under this many pixels once projected
+	static constexpr float sk_LodErrorThresholdPixels{ 1.0f };
+
+	// Sort key layout, most significant first: pipeline | material | mesh | LOD | depth bucket
+	// Everything above the depth bucket identifies an instanced draw, the state changes between draws follow the same order
+	static constexpr uint32_t sk_DepthBits{ 16 };
+	static constexpr uint32_t sk_LodBits{ 4 };
+	static constexpr uint32_t sk_MeshBits{ 24 };
+	static constexpr uint32_t sk_MaterialBits{ 16 };
+	static constexpr uint32_t sk_PipelineBits{ 4 };
+	static_assert(sk_DepthBits + sk_LodBits + sk_MeshBits + sk_MaterialBits + sk_PipelineBits == 64);
+
+	// One XMVECTOR lane per entry
+	static constexpr size_t sk_CullBatchSize{ 4 };
+
+	void RenderThreadLoop();
+	// Records and submits m_RenderEntries, then clears them for the next swap
+	void RenderFrame();
+	// Moves the entries drawable by the GPU-driven path into m_Objects and m_Instances
+	void GatherGpuObjects();
+	// Removes the entries whose world space bounds are fully outside the frustum
+	void CullEntries();
+
+	[[nodiscard]] uint32_t SelectLod(const MeshData& meshData, const XMFLOAT4X4& transform) const;
+	[[nodiscard]] uint64_t MakeSortKey(const MeshData& meshData, uint32_t meshDataID, uint32_t materialID, uint32_t lod, const XMFLOAT4X4& transform) const;
+
+	// LSD radix sort on the keys, 8 bits per pass, passes where every key shares the digit are skipped
+	static void RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
 };
 
 #endif //RENDERER_H
\ No newline at end of file
@@ -1,23 +1,139 @@
 #ifndef RESOURCEDATA_H
 #define RESOURCEDATA_H
 
+#include <span>
+
 #include "GfxStructs.h"
 #include "GraphicsAPI.h"
+#include "MeshletBuilder.h"
 #include "Vertex.h"
 
+// Index range drawn for one level of detail, all levels share the vertex buffer
+struct MeshLod
+{
+	uint32_t m_FirstIndex{};
+	uint32_t m_IndexCount{};
+	float m_Error{}; // Object space distance from the full resolution surface
+	uint32_t m_FirstMeshlet{};
+	uint32_t m_MeshletCount{};
+};
+
 struct MeshData
 {
-	explicit MeshData(GraphicsAPI* pGraphicsAPI, const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices) :
+	// The streams are copied into the staging ring before returning, they may point into a mapped file
+	explicit MeshData(GraphicsAPI* pGraphicsAPI, std::span<const Vertex3D> vertices, std::span<const uint32_t> indices) :
+		MeshData(pGraphicsAPI, VertexFormat::Full, std::as_bytes(vertices), indices)
+	{
+	}
+
+	// Positions are decoded in the vertex shader as m_PositionOffset + position * m_PositionScale
+	explicit MeshData(GraphicsAPI* pGraphicsAPI, std::span<const PackedVertex3D> vertices, std::span<const uint32_t> indices, const XMFLOAT3& positionOffset, const XMFLOAT3& positionScale) :
+		MeshData(pGraphicsAPI, VertexFormat::Packed, std::as_bytes(vertices), indices)
+	{
+		m_PositionOffset = positionOffset;
+		m_PositionScale = positionScale;
+	}
+
+	~MeshData()
+	{
+		if (m_pGeometryArena)
+			m_pGeometryArena->Free(m_GeometryRange);
+		else
+		{
+			m_pGraphicsAPI->Destroy(m_pVertexBufferHandle);
+			m_pGraphicsAPI->Destroy(m_pIndexBufferHandle);
+		}
+		m_pGraphicsAPI->Destroy(m_pMeshletBufferHandle);
+		m_pGraphicsAPI->Destroy(m_pMeshletVertexBufferHandle);
+		m_pGraphicsAPI->Destroy(m_pMeshletTriangleBufferHandle);
+	}
+
+	MeshData(const MeshData&) noexcept = delete;
+	MeshData& operator=(const MeshData&) noexcept = delete;
+	MeshData(MeshData&&) noexcept = delete;
+	MeshData& operator=(MeshData&&) noexcept = delete;
+
+	[[nodiscard]] bool IsReady() const
+	{
+		return m_pGraphicsAPI->GetGfxUploadQueue()->IsComplete(m_UploadHandle);
+	}
+
+	// Cluster culling data, storage buffers only, the meshlet vertices index into the regular vertex buffer
+	void UploadMeshlets(std::span<const Meshlet> meshlets, std::span<const uint32_t> meshletVertices, std::span<const uint8_t> meshletTriangles)
+	{
+		auto& uploadQueue{ *m_pGraphicsAPI->GetGfxUploadQueue() };
+		const auto acquireAndUpload{ [this, &uploadQueue](const void* pData, size_t size) -> BufferHandle
+		{
+			const BufferDesc desc{
+				.m_Usage = BufferUsageBits_Storage,
+				.m_Storage = StorageType_Device,
+				.m_Size = size
+			};
+			const BufferHandle handle{ m_pGraphicsAPI->AcquireBuffer(desc) };
+			const auto& buffer{ m_pGraphicsAPI->GetBuffer(handle) };
+			assert(buffer && L"Unable to create meshlet buffer");
+
+			// Later uploads land in the same or a later transfer submit, the last handle covers the whole mesh
+			m_UploadHandle = uploadQueue.UploadBuffer(buffer, pData, size);
+			return handle;
+		} };
+
+		m_pMeshletBufferHandle = acquireAndUpload(meshlets.data(), meshlets.size_bytes());
+		m_pMeshletVertexBufferHandle = acquireAndUpload(meshletVertices.data(), meshletVertices.size_bytes());
+		m_pMeshletTriangleBufferHandle = acquireAndUpload(meshletTriangles.data(), meshletTriangles.size_bytes());
+		m_MeshletCount = static_cast<uint32_t>(meshlets.size());
+	}
+
+	GraphicsAPI* m_pGraphicsAPI;
+	// Shared arena buffers unless the arena was full, m_GeometryRange locates the mesh in them either way
+	GfxGeometryArena* m_pGeometryArena{};
+	GeometryRange m_GeometryRange{};
+	BufferHandle m_pVertexBufferHandle;
+	BufferHandle m_pIndexBufferHandle;
+	BufferHandle m_pMeshletBufferHandle{};
+	BufferHandle m_pMeshletVertexBufferHandle{};
+	BufferHandle m_pMeshletTriangleBufferHandle{};
+	uint32_t m_MeshletCount{};
+	std::vector<MeshLod> m_Lods;
+	VertexFormat m_VertexFormat;
+	XMFLOAT3 m_PositionOffset{ 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 m_PositionScale{ 1.0f, 1.0f, 1.0f };
+	XMFLOAT3 m_BoundsMin{};
+	XMFLOAT3 m_BoundsMax{};
+	UploadHandle m_UploadHandle{};
+
+private:
+	explicit MeshData(GraphicsAPI* pGraphicsAPI, VertexFormat vertexFormat, std::span<const std::byte> vertexData, std::span<const uint32_t> indices) :
 		m_pGraphicsAPI{ pGraphicsAPI },
-		m_IndexCount{ static_cast<uint32_t>(indices.size()) }
+		m_Lods{ MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f } },
+		m_VertexFormat{ vertexFormat }
 	{
-		const auto pDevice{ m_pGraphicsAPI->GetGfxDevice() };
-		const auto cmdBuffer{ m_pGraphicsAPI->GetCurrentCommandBuffer().GetCmdBuffer() };
+		auto& uploadQueue{ *m_pGraphicsAPI->GetGfxUploadQueue() };
+
+		GfxGeometryArena* pArena{ m_pGraphicsAPI->GetGeometryArena(vertexFormat) };
+		const uint32_t vertexCount{ static_cast<uint32_t>(vertexData.size() / pArena->GetVertexStride()) };
+		const uint32_t indexCount{ static_cast<uint32_t>(indices.size()) };
+
+		m_GeometryRange = pArena->Allocate(vertexCount, indexCount);
+		if (!m_GeometryRange.Empty())
+		{
+			m_pGeometryArena = pArena;
+			m_pVertexBufferHandle = pArena->GetVertexBuffer();
+			m_pIndexBufferHandle = pArena->GetIndexBuffer();
+
+			// Both copies land in the same transfer submit, the index upload handle covers the vertex upload too
+			uploadQueue.UploadBuffer(m_pGraphicsAPI->GetBuffer(m_pVertexBufferHandle), vertexData.data(), vertexData.size(), static_cast<VkDeviceSize>(m_GeometryRange.m_FirstVertex) * pArena->GetVertexStride());
+			m_UploadHandle = uploadQueue.UploadBuffer(m_pGraphicsAPI->GetBuffer(m_pIndexBufferHandle), indices.data(), indices.size_bytes(), sizeof(uint32_t) * static_cast<VkDeviceSize>(m_GeometryRange.m_FirstIndex));
+			return;
+		}
+
+		Logger::Get().LogWarning(L"Geometry arena full, mesh falls back to dedicated buffers and is skipped by the GPU-driven path.");
+		m_GeometryRange = GeometryRange{ 0, vertexCount, 0, indexCount };
 
 		const BufferDesc vbDesc{
 			.m_Usage = BufferUsageBits_Storage | BufferUsageBits_Vertex,
 			.m_Storage = StorageType_Device,
-			.m_Size = sizeof(Vertex3D) * vertices.size()
+			.m_Size = vertexData.size()
 		};
 		m_pVertexBufferHandle = m_pGraphicsAPI->AcquireBuffer(vbDesc);
 		const auto& vertexBuffer{ m_pGraphicsAPI->GetBuffer(m_pVertexBufferHandle) };
@@ -26,55 +142,15 @@ struct MeshData
 		const BufferDesc ibDesc{
 			.m_Usage = BufferUsageBits_Storage | BufferUsageBits_Index,
 			.m_Storage = StorageType_Device,
-			.m_Size = sizeof(uint32_t) * indices.size()
+			.m_Size = indices.size_bytes()
 		};
 		m_pIndexBufferHandle = m_pGraphicsAPI->AcquireBuffer(ibDesc);
 		const auto& indexBuffer{ m_pGraphicsAPI->GetBuffer(m_pIndexBufferHandle) };
 		assert(indexBuffer && L"Unable to create index buffer");
 
-		// TODO: move staging buffer to a dedicated pool to avoid useless acquire/destroy on the main pool.
-		const BufferDesc svbDesc{
-			.m_Usage = BufferUsageBits_Storage,
-			.m_Storage = StorageType_HostVisible,
-			.m_Size = sizeof(Vertex3D) * vertices.size(),
-			.m_Data = vertices.data()
-		};
-		const BufferHandle stagingVertexBufferHandle{ m_pGraphicsAPI->AcquireBuffer(svbDesc) };
-		const auto& stagingVertexBuffer{ m_pGraphicsAPI->GetBuffer(stagingVertexBufferHandle) };
-		assert(stagingVertexBuffer && L"Unable to create staging vertex buffer");
-
-		const BufferDesc sibDesc{
-			.m_Usage = BufferUsageBits_Storage,
-			.m_Storage = StorageType_HostVisible,
-			.m_Size = sizeof(uint32_t) * indices.size(),
-			.m_Data = indices.data()
-		};
-		const BufferHandle stagingIndexBufferHandle{ m_pGraphicsAPI->AcquireBuffer(sibDesc) };
-		const auto& stagingIndexBuffer{ m_pGraphicsAPI->GetBuffer(stagingIndexBufferHandle) };
-		assert(stagingIndexBuffer && L"Unable to create staging vertex buffer");
-
-		pDevice->CopyBuffer(cmdBuffer, stagingVertexBuffer->m_VkBuffer, vertexBuffer->m_VkBuffer, stagingVertexBuffer->m_BufferSize);
-		pDevice->CopyBuffer(cmdBuffer, stagingIndexBuffer->m_VkBuffer, indexBuffer->m_VkBuffer, stagingIndexBuffer->m_BufferSize);
-
-		m_pGraphicsAPI->Destroy(stagingVertexBufferHandle);
-		m_pGraphicsAPI->Destroy(stagingIndexBufferHandle);
+		uploadQueue.UploadBuffer(vertexBuffer, vertexData.data(), vbDesc.m_Size);
+		m_UploadHandle = uploadQueue.UploadBuffer(indexBuffer, indices.data(), ibDesc.m_Size);
 	}
-
-	~MeshData()
-	{
-		m_pGraphicsAPI->Destroy(m_pVertexBufferHandle);
-		m_pGraphicsAPI->Destroy(m_pIndexBufferHandle);
-	}
-
-	MeshData(const MeshData&) noexcept = delete;
-	MeshData& operator=(const MeshData&) noexcept = delete;
-	MeshData(MeshData&&) noexcept = delete;
-	MeshData& operator=(MeshData&&) noexcept = delete;
-
-	GraphicsAPI* m_pGraphicsAPI;
-	BufferHandle m_pVertexBufferHandle;
-	BufferHandle m_pIndexBufferHandle;
-	uint32_t m_IndexCount;
 };
 
 //struct TextureData
@@ -1,35 +1,241 @@
 #include "pch.h"
 #include "ResourceManager.h"
 
+#include <filesystem>
+
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "JobSystem.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "Renderer.h"
+#include "VertexWelder.h"
 #include "Vertex.h"
 
 
-uint32_t ResourceManager::MeshManager::Load(const std::wstring& filename)
+uint32_t ResourceManager::MeshManager::Load(const std::wstring& filename, VertexFormat vertexFormat)
+{
+	PROFILE_FUNCTION();
+
+	const LoadKey key{ filename, vertexFormat };
+	if (!m_LoadedFiles.contains(key))
+	{
+		const ImportedMesh mesh{ Import(filename, vertexFormat) };
+
+		m_LoadedFiles[key] = static_cast<uint32_t>(m_MeshData.size());
+		m_MeshData.emplace_back();
+
+		// The slot stays empty, its id resolves to the placeholder
+		if (mesh.m_IsValid)
+			Finalize(m_LoadedFiles[key], mesh);
+		else
+		{
+			Logger::Get().LogError(std::format(L"Unable to load mesh {}, using the placeholder.", filename));
+			if (!m_pPlaceholder)
+				CreatePlaceholder();
+		}
+	}
+
+	const uint32_t id{ m_LoadedFiles[key] };
+
+	// Already requested asynchronously, finish that load now
+	if (!m_MeshData[id])
+	{
+		const auto it{ std::ranges::find(m_PendingLoads, id, &PendingLoad::m_MeshDataID) };
+		if (it != m_PendingLoads.end())
+		{
+			const ImportedMesh mesh{ it->m_Future.get() };
+			if (mesh.m_IsValid)
+				Finalize(id, mesh);
+			else
+				Logger::Get().LogError(std::format(L"Unable to load mesh {}, using the placeholder.", filename));
+
+			m_PendingLoads.erase(it);
+		}
+	}
+
+	return id;
+}
+
+uint32_t ResourceManager::MeshManager::LoadAsync(const std::wstring& filename, VertexFormat vertexFormat)
+{
+	PROFILE_FUNCTION();
+
+	const LoadKey key{ filename, vertexFormat };
+	if (!m_LoadedFiles.contains(key))
+	{
+		if (!m_pPlaceholder)
+			CreatePlaceholder();
+
+		const uint32_t id{ static_cast<uint32_t>(m_MeshData.size()) };
+		m_LoadedFiles[key] = id;
+		m_MeshData.emplace_back();
+
+		m_PendingLoads.emplace_back(PendingLoad{
+			.m_MeshDataID = id,
+			.m_Filename = filename,
+			.m_Future = JobSystem::Get().Submit([filename, vertexFormat]() { return Import(filename, vertexFormat); }),
+		});
+	}
+
+	return m_LoadedFiles[key];
+}
+
+const MeshData& ResourceManager::MeshManager::GetMeshData(uint32_t id) const
+{
+	assert(id < m_MeshData.size() && L"MeshData fetch with id out of range!");
+
+	if (m_pPlaceholder && (!m_MeshData[id] || !m_MeshData[id]->IsReady()))
+		return *m_pPlaceholder;
+
+	assert(m_MeshData[id] && L"Mesh is not loaded and no placeholder exists.");
+	return *m_MeshData[id];
+}
+
+const MeshData& ResourceManager::MeshManager::GetFinalizedMeshData(uint32_t id) const
+{
+	assert(id < m_MeshData.size() && L"MeshData fetch with id out of range!");
+
+	if (m_pPlaceholder && !m_MeshData[id])
+		return *m_pPlaceholder;
+
+	assert(m_MeshData[id] && L"Mesh is not loaded and no placeholder exists.");
+	return *m_MeshData[id];
+}
+
+bool ResourceManager::MeshManager::IsReady(uint32_t id) const
+{
+	assert(id < m_MeshData.size() && L"MeshData fetch with id out of range!");
+	return m_MeshData[id] && m_MeshData[id]->IsReady();
+}
+
+void ResourceManager::MeshManager::FinalizePendingLoads()
+{
+	PROFILE_FUNCTION();
+
+	size_t uploadedBytes{};
+
+	// Pending loads finish in any order, only look at the ones that are done
+	for (auto it{ m_PendingLoads.begin() }; it != m_PendingLoads.end() && uploadedBytes < sk_UploadBudgetPerFrame;)
+	{
+		if (it->m_Future.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		const ImportedMesh mesh{ it->m_Future.get() };
+		if (mesh.m_IsValid)
+		{
+			Finalize(it->m_MeshDataID, mesh);
+			const size_t vertexBytes{ mesh.m_VertexFormat == VertexFormat::Packed ? mesh.m_PackedVertices.size() * sizeof(PackedVertex3D) : mesh.m_View.m_Vertices.size_bytes() };
+			uploadedBytes += vertexBytes + mesh.m_View.m_Indices.size_bytes()
+				+ mesh.m_View.m_Meshlets.size_bytes() + mesh.m_View.m_MeshletVertices.size_bytes() + mesh.m_View.m_MeshletTriangles.size_bytes();
+		}
+		else
+			Logger::Get().LogWarning(std::format(L"Unable to load mesh {}, keeping the placeholder.", it->m_Filename));
+
+		it = m_PendingLoads.erase(it);
+	}
+}
+
+void ResourceManager::MeshManager::ReleaseGPUBuffers()
+{
+	// Workers must not outlive the GPU resources they are about to be finalized into
+	for (auto& pendingLoad : m_PendingLoads)
+		pendingLoad.m_Future.wait();
+
+	m_PendingLoads.clear();
+	m_MeshData.clear();
+	m_pPlaceholder.reset();
+}
+
+ResourceManager::MeshManager::ImportedMesh ResourceManager::MeshManager::Import(const std::wstring& filename, VertexFormat vertexFormat)
+{
+	PROFILE_FUNCTION();
+
+	ImportedMesh importedMesh{ ImportCooked(filename) };
+
+	// Zero sized vertex or index buffers cannot be created
+	if (importedMesh.m_View.m_Vertices.empty() || importedMesh.m_View.m_Indices.empty())
+		importedMesh.m_IsValid = false;
+
+	if (importedMesh.m_IsValid && vertexFormat == VertexFormat::Packed)
+		Pack(importedMesh);
+
+	return importedMesh;
+}
+
+ResourceManager::MeshManager::ImportedMesh ResourceManager::MeshManager::ImportCooked(const std::wstring& filename)
+{
+	ImportedMesh importedMesh{};
+
+	importedMesh.m_pCookedFile = std::make_unique<MappedFile>(MeshCooker::GetCookedPath(filename));
+	if (MeshCooker::Open(*importedMesh.m_pCookedFile, filename, importedMesh.m_View))
+	{
+		importedMesh.m_IsValid = true;
+		return importedMesh;
+	}
+
+	// Stale or missing, unmapped first so it can be replaced
+	importedMesh.m_pCookedFile.reset();
+
+	if (!ImportWithAssimp(filename, importedMesh))
+		return importedMesh;
+
+	Optimize(filename, importedMesh);
+	GenerateLods(filename, importedMesh);
+	GenerateMeshlets(filename, importedMesh);
+
+	// Moving the vectors later keeps their storage, the view stays valid
+	importedMesh.m_View.m_Vertices = importedMesh.m_Vertices;
+	importedMesh.m_View.m_Indices = importedMesh.m_Indices;
+	importedMesh.m_View.m_Submeshes = importedMesh.m_Submeshes;
+	importedMesh.m_View.m_Lods = importedMesh.m_Lods;
+	importedMesh.m_View.m_Meshlets = importedMesh.m_Meshlets;
+	importedMesh.m_View.m_MeshletVertices = importedMesh.m_MeshletVertices;
+	importedMesh.m_View.m_MeshletTriangles = importedMesh.m_MeshletTriangles;
+
+	MeshCooker::Write(filename, importedMesh.m_View);
+
+	importedMesh.m_IsValid = true;
+	return importedMesh;
+}
+
+bool ResourceManager::MeshManager::ImportWithAssimp(const std::wstring& filename, ImportedMesh& importedMesh)
 {
-	if (!m_LoadedFiles.contains(filename))
+	PROFILE_FUNCTION();
+
+	Assimp::Importer importer;
+
+	const aiScene* scene{ importer.ReadFile(std::filesystem::path{ filename }.string(), aiProcess_Triangulate | aiProcess_MakeLeftHanded | aiProcess_FlipUVs) };
+
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode || !scene->mNumMeshes)
 	{
-		std::vector<Vertex3D> vertices{};
-		std::vector<uint32_t> indices{};
+		Logger::Get().LogWarning(L"Error::Assimp: " + StrUtils::cstr2stdwstr(importer.GetErrorString()) + L"\n");
+		return false;
+	}
 
-		Assimp::Importer importer;
+	auto& vertices{ importedMesh.m_Vertices };
+	auto& indices{ importedMesh.m_Indices };
 
-		const aiScene* scene{ importer.ReadFile("Resources/Models/viking_room.obj", aiProcess_Triangulate | aiProcess_MakeLeftHanded | aiProcess_FlipUVs) };
+	XMVECTOR meshMin{ g_XMFltMax };
+	XMVECTOR meshMax{ XMVectorNegate(g_XMFltMax) };
 
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-			Logger::Get().LogError(L"Error::Assimp: " + StrUtils::cstr2stdwstr(importer.GetErrorString()) + L"\n");
+	for (uint32_t meshIndex{}; meshIndex < scene->mNumMeshes; ++meshIndex)
+	{
+		const aiMesh* mesh{ scene->mMeshes[meshIndex] };
 
-		const aiMesh* mesh{ scene->mMeshes[0] };
-		indices.reserve(mesh->mNumVertices); // Can't reserve for vertices since size is unknown
-		std::unordered_map<Vertex3D, uint32_t> uniqueVertices;
+		CookedSubmesh& submesh{ importedMesh.m_Submeshes.emplace_back() };
+		submesh.m_FirstIndex = static_cast<uint32_t>(indices.size());
 
+		std::vector<Vertex3D> meshVertices(mesh->mNumVertices);
 		for (uint32_t i{}; i < mesh->mNumVertices; ++i)
 		{
-			Vertex3D vertex{};
+			Vertex3D& vertex{ meshVertices[i] };
 
 			// Extract position
 			vertex.m_Position.x = mesh->mVertices[i].x;
@@ -42,36 +248,214 @@ uint32_t ResourceManager::MeshManager::Load(const std::wstring& filename)
 				vertex.m_Texcoord.x = mesh->mTextureCoords[0][i].x;
 				vertex.m_Texcoord.y = mesh->mTextureCoords[0][i].y;
 			}
+		}
 
-			if (!uniqueVertices.contains(vertex))
-			{
-				// Add new vertex
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.emplace_back(vertex);
-			}
+		// Assimp duplicates vertices per face corner for formats like obj
+		std::vector<uint32_t> remap(mesh->mNumVertices);
+		std::vector<Vertex3D> uniqueVertices{};
+		if (meshVertices.size() >= VertexWelder::sk_ParallelThreshold)
+			VertexWelder::WeldParallel(meshVertices, uniqueVertices, remap);
+		else
+			VertexWelder::Weld(meshVertices, uniqueVertices, remap);
 
-			indices.emplace_back(uniqueVertices[vertex]);
+		XMVECTOR submeshMin{ g_XMFltMax };
+		XMVECTOR submeshMax{ XMVectorNegate(g_XMFltMax) };
+		for (const Vertex3D& vertex : uniqueVertices)
+		{
+			const XMVECTOR position{ XMLoadFloat3(&vertex.m_Position) };
+			submeshMin = XMVectorMin(submeshMin, position);
+			submeshMax = XMVectorMax(submeshMax, position);
 		}
 
-		m_LoadedFiles[filename] = static_cast<uint32_t>(m_MeshData.size());
+		const uint32_t baseVertex{ static_cast<uint32_t>(vertices.size()) };
+		vertices.insert(vertices.end(), uniqueVertices.begin(), uniqueVertices.end());
 
-		const auto graphicsAPI{ Renderer::Get().GetGraphicsAPI() };
+		// Points and lines left over by aiProcess_Triangulate are dropped
+		indices.reserve(indices.size() + size_t{ mesh->mNumFaces } * 3);
+		for (uint32_t f{}; f < mesh->mNumFaces; ++f)
+		{
+			const aiFace& face{ mesh->mFaces[f] };
+			if (face.mNumIndices != 3)
+				continue;
 
-		m_MeshData.emplace_back(MeshData{ graphicsAPI, vertices, indices });
+			for (uint32_t k{}; k < 3; ++k)
+				indices.emplace_back(baseVertex + remap[face.mIndices[k]]);
+		}
+
+		submesh.m_IndexCount = static_cast<uint32_t>(indices.size()) - submesh.m_FirstIndex;
+		XMStoreFloat3(&submesh.m_BoundsMin, submeshMin);
+		XMStoreFloat3(&submesh.m_BoundsMax, submeshMax);
+
+		meshMin = XMVectorMin(meshMin, submeshMin);
+		meshMax = XMVectorMax(meshMax, submeshMax);
 	}
 
-	return m_LoadedFiles[filename];
+	XMStoreFloat3(&importedMesh.m_View.m_BoundsMin, meshMin);
+	XMStoreFloat3(&importedMesh.m_View.m_BoundsMax, meshMax);
+
+	return true;
 }
 
-const MeshData& ResourceManager::MeshManager::GetMeshData(uint32_t id) const
+void ResourceManager::MeshManager::Optimize(const std::wstring& filename, ImportedMesh& importedMesh)
 {
-	assert(id < m_MeshData.size() && L"MeshData fetch with id out of range!");
-	return m_MeshData[id];
+	PROFILE_FUNCTION();
+
+	auto& vertices{ importedMesh.m_Vertices };
+	auto& indices{ importedMesh.m_Indices };
+	const uint32_t vertexCount{ static_cast<uint32_t>(vertices.size()) };
+
+	const VertexCacheStats before{ MeshOptimizer::AnalyzeVertexCache(indices, vertexCount) };
+	const auto start{ std::chrono::steady_clock::now() };
+
+	// Triangles never move across submeshes
+	for (const CookedSubmesh& submesh : importedMesh.m_Submeshes)
+	{
+		const std::span<uint32_t> submeshIndices{ indices.data() + submesh.m_FirstIndex, submesh.m_IndexCount };
+		MeshOptimizer::OptimizeVertexCache(submeshIndices, vertexCount);
+		MeshOptimizer::OptimizeOverdraw(submeshIndices, vertices);
+	}
+
+	vertices.resize(MeshOptimizer::OptimizeVertexFetch(vertices, indices));
+
+	const float elapsedMs{ std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() };
+	const VertexCacheStats after{ MeshOptimizer::AnalyzeVertexCache(indices, static_cast<uint32_t>(vertices.size())) };
+
+	Logger::Get().LogInfo(std::format(L"Optimized {} in {:.2f}ms: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n",
+		filename, elapsedMs, before.m_ACMR, after.m_ACMR, before.m_ATVR, after.m_ATVR), false);
 }
 
-void ResourceManager::MeshManager::ReleaseGPUBuffers()
+void ResourceManager::MeshManager::GenerateLods(const std::wstring& filename, ImportedMesh& importedMesh)
 {
-	m_MeshData.clear();
+	PROFILE_FUNCTION();
+
+	const auto& vertices{ importedMesh.m_Vertices };
+	auto& indices{ importedMesh.m_Indices };
+	auto& lods{ importedMesh.m_Lods };
+
+	lods.emplace_back(CookedLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	const XMVECTOR extent{ XMVectorSubtract(XMLoadFloat3(&importedMesh.m_View.m_BoundsMax), XMLoadFloat3(&importedMesh.m_View.m_BoundsMin)) };
+	const float maxError{ XMVectorGetX(XMVector3Length(extent)) * sk_MaxLodError };
+	const uint32_t vertexCount{ static_cast<uint32_t>(vertices.size()) };
+
+	// Every level is simplified from the previous one, the errors add up
+	std::vector<uint32_t> sourceIndices{ indices };
+	std::vector<uint32_t> lodIndices{};
+	float error{};
+
+	while (lods.size() < sk_MaxLodCount)
+	{
+		const size_t targetIndexCount{ sourceIndices.size() / 6 * 3 };
+		if (targetIndexCount < size_t{ sk_MinLodTriangles } * 3 || error >= maxError)
+			break;
+
+		error += MeshSimplifier::Simplify(sourceIndices, vertices, targetIndexCount, maxError - error, lodIndices);
+
+		// Borders and seams are locked, some meshes stop simplifying early
+		if (lodIndices.empty() || lodIndices.size() * 4 > sourceIndices.size() * 3)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(lodIndices, vertexCount);
+
+		lods.emplace_back(CookedLod{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), error });
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		std::swap(sourceIndices, lodIndices);
+	}
+
+	std::wstring triangleCounts{};
+	for (const CookedLod& lod : lods)
+		triangleCounts += std::format(L" {}", lod.m_IndexCount / 3);
+
+	Logger::Get().LogInfo(std::format(L"Generated {} LODs for {}, triangles:{}\n", lods.size(), filename, triangleCounts), false);
+}
+
+void ResourceManager::MeshManager::GenerateMeshlets(const std::wstring& filename, ImportedMesh& importedMesh)
+{
+	PROFILE_FUNCTION();
+
+	const std::span<const uint32_t> indices{ importedMesh.m_Indices };
+
+	// Every LOD gets its own clusters, they are the unit of the GPU culling
+	for (CookedLod& lod : importedMesh.m_Lods)
+	{
+		lod.m_FirstMeshlet = static_cast<uint32_t>(importedMesh.m_Meshlets.size());
+		MeshletBuilder::Build(indices.subspan(lod.m_FirstIndex, lod.m_IndexCount), importedMesh.m_Vertices,
+			importedMesh.m_Meshlets, importedMesh.m_MeshletVertices, importedMesh.m_MeshletTriangles);
+		lod.m_MeshletCount = static_cast<uint32_t>(importedMesh.m_Meshlets.size()) - lod.m_FirstMeshlet;
+	}
+
+	Logger::Get().LogInfo(std::format(L"Built {} meshlets for {} ({} vertex references, {} triangle bytes)\n",
+		importedMesh.m_Meshlets.size(), filename, importedMesh.m_MeshletVertices.size(), importedMesh.m_MeshletTriangles.size()), false);
+}
+
+void ResourceManager::MeshManager::Pack(ImportedMesh& importedMesh)
+{
+	PROFILE_FUNCTION();
+
+	const CookedMeshView& view{ importedMesh.m_View };
+	const XMVECTOR boundsMin{ XMLoadFloat3(&view.m_BoundsMin) };
+	const XMVECTOR extent{ XMVectorSubtract(XMLoadFloat3(&view.m_BoundsMax), boundsMin) };
+
+	// Flat axes get a zero scale, every vertex decodes to the bounds minimum on them
+	const XMVECTOR encodeScale{ XMVectorSelect(XMVectorReciprocal(extent), XMVectorZero(), XMVectorEqual(extent, XMVectorZero())) };
+
+	importedMesh.m_PackedVertices.reserve(view.m_Vertices.size());
+	for (const Vertex3D& vertex : view.m_Vertices)
+		importedMesh.m_PackedVertices.emplace_back(PackedVertex3D::Encode(vertex, boundsMin, encodeScale));
+
+	importedMesh.m_VertexFormat = VertexFormat::Packed;
+	importedMesh.m_PositionOffset = view.m_BoundsMin;
+	XMStoreFloat3(&importedMesh.m_PositionScale, extent);
+}
+
+void ResourceManager::MeshManager::Finalize(uint32_t id, const ImportedMesh& mesh)
+{
+	const auto graphicsAPI{ Renderer::Get().GetGraphicsAPI() };
+	if (mesh.m_VertexFormat == VertexFormat::Packed)
+		m_MeshData[id] = std::make_unique<MeshData>(graphicsAPI, std::span<const PackedVertex3D>{ mesh.m_PackedVertices }, mesh.m_View.m_Indices, mesh.m_PositionOffset, mesh.m_PositionScale);
+	else
+		m_MeshData[id] = std::make_unique<MeshData>(graphicsAPI, mesh.m_View.m_Vertices, mesh.m_View.m_Indices);
+	m_MeshData[id]->m_BoundsMin = mesh.m_View.m_BoundsMin;
+	m_MeshData[id]->m_BoundsMax = mesh.m_View.m_BoundsMax;
+
+	// Files cooked without LODs keep the single full range
+	if (!mesh.m_View.m_Lods.empty())
+	{
+		auto& lods{ m_MeshData[id]->m_Lods };
+		lods.clear();
+		for (const CookedLod& lod : mesh.m_View.m_Lods)
+			lods.emplace_back(MeshLod{ lod.m_FirstIndex, lod.m_IndexCount, lod.m_Error, lod.m_FirstMeshlet, lod.m_MeshletCount });
+	}
+
+	if (!mesh.m_View.m_Meshlets.empty())
+		m_MeshData[id]->UploadMeshlets(mesh.m_View.m_Meshlets, mesh.m_View.m_MeshletVertices, mesh.m_View.m_MeshletTriangles);
+}
+
+void ResourceManager::MeshManager::CreatePlaceholder()
+{
+	// Unit cube, drawn in place of meshes that are still loading
+	std::vector<Vertex3D> vertices{};
+	vertices.reserve(8);
+	for (uint32_t i{}; i < 8; ++i)
+	{
+		Vertex3D& vertex{ vertices.emplace_back() };
+		vertex.m_Position = XMFLOAT3{ (i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f };
+		vertex.m_Color = XMFLOAT3{ 1.0f, 0.0f, 1.0f };
+	}
+
+	const std::vector<uint32_t> indices
+	{
+		0, 2, 1, 1, 2, 3, // -z
+		4, 5, 6, 5, 7, 6, // +z
+		0, 1, 4, 1, 5, 4, // -y
+		2, 6, 3, 3, 6, 7, // +y
+		0, 4, 2, 2, 4, 6, // -x
+		1, 3, 5, 3, 7, 5, // +x
+	};
+
+	m_pPlaceholder = std::make_unique<MeshData>(Renderer::Get().GetGraphicsAPI(), vertices, indices);
+	m_pPlaceholder->m_BoundsMin = XMFLOAT3{ -0.5f, -0.5f, -0.5f };
+	m_pPlaceholder->m_BoundsMax = XMFLOAT3{ 0.5f, 0.5f, 0.5f };
 }
 
 void ResourceManager::Initialize()
@@ -91,9 +475,32 @@ const MeshData& ResourceManager::GetMeshData(uint32_t id) const
 	return m_pMeshManager->GetMeshData(id);
 }
 
-uint32_t ResourceManager::LoadMesh(const std::wstring& filename) const
+const MeshData& ResourceManager::GetFinalizedMeshData(uint32_t id) const
+{
+	return m_pMeshManager->GetFinalizedMeshData(id);
+}
+
+bool ResourceManager::IsMeshReady(uint32_t id) const
+{
+	return m_pMeshManager->IsReady(id);
+}
+
+uint32_t ResourceManager::LoadMesh(const std::wstring& filename, VertexFormat vertexFormat) const
+{
+	// The mesh table and the GPU only change while no frame is being recorded
+	Renderer::Get().WaitForRenderThread();
+	return m_pMeshManager->Load(filename, vertexFormat);
+}
+
+uint32_t ResourceManager::LoadMeshAsync(const std::wstring& filename, VertexFormat vertexFormat) const
+{
+	Renderer::Get().WaitForRenderThread();
+	return m_pMeshManager->LoadAsync(filename, vertexFormat);
+}
+
+void ResourceManager::FinalizePendingLoads() const
 {
-	return m_pMeshManager->Load(filename);
+	m_pMeshManager->FinalizePendingLoads();
 }
 
 void ResourceManager::ReleaseGPUBuffers() const
@@ -3,6 +3,7 @@
 
 #include "Singleton.h"
 
+#include "MeshCooker.h"
 #include "ResourceData.h"
 
 class ResourceManager final : public Singleton<ResourceManager>
@@ -12,13 +13,75 @@ class ResourceManager final : public Singleton<ResourceManager>
 
 	struct MeshManager
 	{
-		[[nodiscard]] uint32_t Load(const std::wstring& filename);
+		[[nodiscard]] uint32_t Load(const std::wstring& filename, VertexFormat vertexFormat);
+		[[nodiscard]] uint32_t LoadAsync(const std::wstring& filename, VertexFormat vertexFormat);
+		// Returns the placeholder mesh while the load is still in flight
 		[[nodiscard]] const MeshData& GetMeshData(uint32_t id) const;
+		// Returns the placeholder mesh until the load is finalized, without looking at the upload
+		[[nodiscard]] const MeshData& GetFinalizedMeshData(uint32_t id) const;
+		[[nodiscard]] bool IsReady(uint32_t id) const;
+		void FinalizePendingLoads();
 		void ReleaseGPUBuffers();
 
 	private:
-		std::unordered_map<std::wstring, uint32_t> m_LoadedFiles{};
-		std::vector<MeshData> m_MeshData{};
+		// Cooked meshes are read straight from the mapped file, Assimp imports own their streams until the upload
+		struct ImportedMesh final
+		{
+			std::unique_ptr<MappedFile> m_pCookedFile{};
+			std::vector<Vertex3D> m_Vertices{};
+			std::vector<uint32_t> m_Indices{};
+			std::vector<CookedSubmesh> m_Submeshes{};
+			std::vector<CookedLod> m_Lods{};
+			std::vector<Meshlet> m_Meshlets{};
+			std::vector<uint32_t> m_MeshletVertices{};
+			std::vector<uint8_t> m_MeshletTriangles{};
+			CookedMeshView m_View{};
+			VertexFormat m_VertexFormat{ VertexFormat::Full };
+			std::vector<PackedVertex3D> m_PackedVertices{};
+			XMFLOAT3 m_PositionOffset{};
+			XMFLOAT3 m_PositionScale{};
+			bool m_IsValid{};
+		};
+
+		struct PendingLoad final
+		{
+			uint32_t m_MeshDataID{};
+			std::wstring m_Filename{};
+			std::future<ImportedMesh> m_Future{};
+		};
+
+		// The same file can be loaded in both vertex formats
+		using LoadKey = std::pair<std::wstring, VertexFormat>;
+		struct LoadKeyHash final
+		{
+			size_t operator()(const LoadKey& key) const noexcept
+			{
+				return std::hash<std::wstring>{}(key.first) ^ static_cast<size_t>(key.second);
+			}
+		};
+
+		// Keeps the staging ring from overflowing when a whole scene finishes importing at once
+		static constexpr size_t sk_UploadBudgetPerFrame{ size_t{ 16 } << 20 };
+
+		// Each level targets half the triangles of the previous one, until the error or the reduction is no longer worth it
+		static constexpr uint32_t sk_MaxLodCount{ 5 };
+		static constexpr uint32_t sk_MinLodTriangles{ 64 };
+		static constexpr float sk_MaxLodError{ 0.05f }; // Relative to the bounds diagonal
+
+		std::unordered_map<LoadKey, uint32_t, LoadKeyHash> m_LoadedFiles{};
+		std::vector<std::unique_ptr<MeshData>> m_MeshData{};
+		std::deque<PendingLoad> m_PendingLoads{};
+		std::unique_ptr<MeshData> m_pPlaceholder{};
+
+		[[nodiscard]] static ImportedMesh Import(const std::wstring& filename, VertexFormat vertexFormat);
+		[[nodiscard]] static ImportedMesh ImportCooked(const std::wstring& filename);
+		[[nodiscard]] static bool ImportWithAssimp(const std::wstring& filename, ImportedMesh& mesh);
+		static void Optimize(const std::wstring& filename, ImportedMesh& mesh);
+		static void GenerateLods(const std::wstring& filename, ImportedMesh& mesh);
+		static void GenerateMeshlets(const std::wstring& filename, ImportedMesh& mesh);
+		static void Pack(ImportedMesh& mesh);
+		void Finalize(uint32_t id, const ImportedMesh& mesh);
+		void CreatePlaceholder();
 	};
 
 public:
@@ -32,9 +95,22 @@ public:
 	void Initialize();
 	[[nodiscard]] bool IsInitialized() const;
 
+	// Recording side, the placeholder stands in until the mesh's upload has been acquired by the graphics queue
 	[[nodiscard]] const MeshData& GetMeshData(uint32_t id) const;
+	// Simulation side, the bounds and LODs only change when the loads are finalized, while no frame is being recorded.
+	// Whether the placeholder is drawn instead is left to the render thread
+	[[nodiscard]] const MeshData& GetFinalizedMeshData(uint32_t id) const;
+	// False until the mesh's transfer queue upload has been handed over to the graphics queue
+	[[nodiscard]] bool IsMeshReady(uint32_t id) const;
 
-	[[nodiscard]] uint32_t LoadMesh(const std::wstring& filename) const;
+	// Packed meshes use half the vertex memory and bandwidth, at the cost of 16 bits positions relative to the mesh bounds.
+	// Both loads first wait for the frame the render thread may be recording with --threaded-render
+	// Meshes that fail to import or have no geometry keep an id that resolves to the placeholder
+	[[nodiscard]] uint32_t LoadMesh(const std::wstring& filename, VertexFormat vertexFormat = VertexFormat::Full) const;
+	// Returns immediately, the file is imported on the job system and uploaded by FinalizePendingLoads()
+	[[nodiscard]] uint32_t LoadMeshAsync(const std::wstring& filename, VertexFormat vertexFormat = VertexFormat::Full) const;
+	// Once per frame before recording, while no other thread records or reads the mesh data
+	void FinalizePendingLoads() const;
 	//[[nodiscard]] uint32_t LoadTexture(const std::wstring& filename, bool singleChannel = false) const;
 
 	void ReleaseGPUBuffers() const;
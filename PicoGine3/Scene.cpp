@@ -8,8 +8,6 @@ void Scene::Initialize()
 	using namespace Systems;
 	using namespace Components;
 
-	Renderer::Get().GetGraphicsAPI()->AcquireCommandBuffer();
-
 	// SYSTEMS
 	m_RenderSystems.emplace_back(MeshRenderer);
 
@@ -22,9 +20,7 @@ void Scene::Initialize()
 
 	entity = m_Ecs.create();
 	m_Ecs.emplace<Transform>(entity, XMFLOAT3{ 2.0f, 0.0f, 0.0f }, XMFLOAT3{ 0.0f, 0.0f, 0.0f }, XMFLOAT3{ 1.0f, 1.0f, 1.0f });
-	m_Ecs.emplace<Mesh>(entity, L"Resources/Models/viking_room.obj");
-
-	Renderer::Get().GetGraphicsAPI()->SubmitCommandBuffer();
+	m_Ecs.emplace<Mesh>(entity, L"Resources/Models/viking_room.obj", 0u, VertexFormat::Packed);
 }
 
 void Scene::Start()
@@ -35,24 +31,32 @@ void Scene::Start()
 
 void Scene::Update()
 {
+	PROFILE_FUNCTION();
+
 	for (const auto& system : m_UpdateSystems)
 		system(m_Ecs);
 }
 
 void Scene::LateUpdate()
 {
+	PROFILE_FUNCTION();
+
 	for (const auto& system : m_LateUpdateSystems)
 		system(m_Ecs);
 }
 
 void Scene::FixedUpdate()
 {
+	PROFILE_FUNCTION();
+
 	for (const auto& system : m_FixedUpdateSystems)
 		system(m_Ecs);
 }
 
 void Scene::Render()
 {
+	PROFILE_FUNCTION();
+
 	for (const auto& system : m_RenderSystems)
 		system(m_Ecs);
 }
@@ -1,9 +1,25 @@
 #include "pch.h"
 #include "Settings.h"
 
+#include <sstream>
 
-void Settings::Initialize()
+
+void Settings::Initialize(const wchar_t* commandLine)
 {
+	if (commandLine)
+		ParseCommandLine(commandLine);
+
+	if (m_Headless && m_FrameCount == 0)
+		m_FrameCount = sk_DefaultHeadlessFrameCount;
+
+	// Presentation pacing would hide the CPU cost we want to measure
+	if (m_Benchmark)
+	{
+		m_VSync = false;
+		m_FrameCap = false;
+		m_FrameCount += m_BenchmarkWarmupFrames;
+	}
+
 	m_IsInitialized = true;
 }
 
@@ -42,7 +58,118 @@ WindowFullscreenState Settings::GetWindowFullscreenStartState() const
 	return m_WindowFullscreenStartState;
 }
 
+bool Settings::IsHeadless() const
+{
+	return m_Headless;
+}
+
+uint32_t Settings::GetFrameCount() const
+{
+	return m_FrameCount;
+}
+
+bool Settings::IsBenchmarkEnabled() const
+{
+	return m_Benchmark;
+}
+
+uint32_t Settings::GetBenchmarkWarmupFrames() const
+{
+	return m_BenchmarkWarmupFrames;
+}
+
+const std::wstring& Settings::GetBenchmarkReportPath() const
+{
+	return m_BenchmarkReportPath;
+}
+
+bool Settings::IsMicroBenchmarkEnabled() const
+{
+	return m_MicroBenchmark;
+}
+
+const std::wstring& Settings::GetMicroBenchmarkReportPath() const
+{
+	return m_MicroBenchmarkReportPath;
+}
+
+bool Settings::IsProfilingEnabled() const
+{
+	return !m_ProfileOutputPath.empty();
+}
+
+const std::wstring& Settings::GetProfileOutputPath() const
+{
+	return m_ProfileOutputPath;
+}
+
+bool Settings::IsGpuDrivenEnabled() const
+{
+	return m_GpuDriven;
+}
+
+bool Settings::IsOcclusionCullingEnabled() const
+{
+	return m_OcclusionCulling;
+}
+
+bool Settings::IsThreadedRenderEnabled() const
+{
+	return m_ThreadedRender;
+}
+
 void Settings::SetVSync(bool value)
 {
 	m_VSync = value;
 }
+
+void Settings::ParseCommandLine(const wchar_t* commandLine)
+{
+	std::wistringstream stream{ commandLine };
+	std::wstring argument;
+
+	while (stream >> argument)
+	{
+		if (argument == L"--headless")
+		{
+			m_Headless = true;
+			m_VSync = false;
+		}
+		else if (argument == L"--frames")
+		{
+			if (!(stream >> m_FrameCount))
+				Logger::Get().LogWarning(L"--frames expects a frame count, ignoring.");
+		}
+		else if (argument == L"--benchmark")
+		{
+			m_Benchmark = true;
+			if (!(stream >> m_FrameCount))
+				Logger::Get().LogError(L"--benchmark expects a frame count.");
+		}
+		else if (argument == L"--benchmark-output")
+		{
+			if (!(stream >> m_BenchmarkReportPath))
+				Logger::Get().LogWarning(L"--benchmark-output expects a file path, ignoring.");
+		}
+		else if (argument == L"--microbench")
+			m_MicroBenchmark = true;
+		else if (argument == L"--microbench-output")
+		{
+			if (!(stream >> m_MicroBenchmarkReportPath))
+				Logger::Get().LogWarning(L"--microbench-output expects a file path, ignoring.");
+		}
+		else if (argument == L"--profile")
+		{
+			if (!(stream >> m_ProfileOutputPath))
+				Logger::Get().LogWarning(L"--profile expects a file path, ignoring.");
+		}
+		else if (argument == L"--gpu-driven")
+			m_GpuDriven = true;
+		else if (argument == L"--occlusion-culling")
+			m_OcclusionCulling = true;
+		else if (argument == L"--threaded-render")
+			m_ThreadedRender = true;
+		else
+			Logger::Get().LogWarning(std::format(L"Unknown command line argument: {}", argument));
+	}
+}
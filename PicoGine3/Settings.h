@@ -16,7 +16,7 @@ public:
 	Settings(Settings&&) noexcept = delete;
 	Settings& operator=(Settings&&) noexcept = delete;
 
-	void Initialize();
+	void Initialize(const wchar_t* commandLine = nullptr);
 	[[nodiscard]] bool IsInitialized() const;
 
 	[[nodiscard]] const wchar_t* GetWindowName() const;
@@ -25,6 +25,18 @@ public:
 	[[nodiscard]] bool IsFrameCapEnabled() const;
 	[[nodiscard]] float GetMaxFPS() const;
 	[[nodiscard]] WindowFullscreenState GetWindowFullscreenStartState() const;
+	[[nodiscard]] bool IsHeadless() const;
+	[[nodiscard]] uint32_t GetFrameCount() const;
+	[[nodiscard]] bool IsBenchmarkEnabled() const;
+	[[nodiscard]] uint32_t GetBenchmarkWarmupFrames() const;
+	[[nodiscard]] const std::wstring& GetBenchmarkReportPath() const;
+	[[nodiscard]] bool IsMicroBenchmarkEnabled() const;
+	[[nodiscard]] const std::wstring& GetMicroBenchmarkReportPath() const;
+	[[nodiscard]] bool IsProfilingEnabled() const;
+	[[nodiscard]] const std::wstring& GetProfileOutputPath() const;
+	[[nodiscard]] bool IsGpuDrivenEnabled() const;
+	[[nodiscard]] bool IsOcclusionCullingEnabled() const;
+	[[nodiscard]] bool IsThreadedRenderEnabled() const;
 
 	void SetVSync(bool value);
 
@@ -49,6 +61,32 @@ private:
 	float m_MaxFPS{ 240.0f };
 	WindowFullscreenState m_WindowFullscreenStartState{ WindowFullscreenState::None };
 
+	// Headless runs render into offscreen targets and exit after m_FrameCount frames (0 = run until quit)
+	bool m_Headless{ false };
+	uint32_t m_FrameCount{ 0 };
+
+	// Benchmark runs record per-phase CPU timings for m_FrameCount frames after the warmup and write a JSON report
+	bool m_Benchmark{ false };
+	uint32_t m_BenchmarkWarmupFrames{ 16 };
+	std::wstring m_BenchmarkReportPath{ L"BenchmarkReport.json" };
+
+	// Micro-benchmarks run once after initialization and exit without entering the core loop
+	bool m_MicroBenchmark{ false };
+	std::wstring m_MicroBenchmarkReportPath{ L"MicroBenchmarkReport.json" };
+
+	// Profiler capture, written as a Chrome trace on exit (empty = no capture)
+	std::wstring m_ProfileOutputPath{};
+
+	// Culling and draw generation run in a compute pass, the CPU only uploads the object list
+	bool m_GpuDriven{ false };
+	// Two-phase Hi-Z occlusion culling on top of the GPU-driven path
+	bool m_OcclusionCulling{ false };
+	// Frames are recorded and submitted on a render thread while the main thread simulates the next one
+	bool m_ThreadedRender{ false };
+
+	static constexpr uint32_t sk_DefaultHeadlessFrameCount{ 1000 };
+
+	void ParseCommandLine(const wchar_t* commandLine);
 };
 
 #endif //SETTINGS_H
\ No newline at end of file
@@ -1,6 +1,16 @@
 #ifndef VERTEX_H
 #define VERTEX_H
 
+#include <DirectXPackedVector.h>
+
+// Chosen per mesh at load time, cooked files always keep the full precision stream
+enum class VertexFormat : uint8_t
+{
+	Full,
+	Packed,
+};
+static constexpr uint32_t g_VertexFormatCount{ 2 };
+
 #pragma region vertex3d
 
 struct Vertex3D
@@ -71,6 +81,69 @@ struct std::hash<Vertex3D>
 
 #pragma endregion
 
+#pragma region packedvertex3d
+
+// 16 bytes instead of 32: positions are normalized to the mesh bounds, decoded with the offset and scale pushed by the draw
+struct PackedVertex3D
+{
+	PackedVector::XMUSHORTN4 m_Position{}; // w is padding, 3 component 16 bits formats are rarely supported as vertex input
+	PackedVector::XMUBYTEN4 m_Color{};
+	PackedVector::XMHALF2 m_Texcoord{};
+
+	// encodeScale is the inverse of the bounds extent, 0 on flat axes
+	static PackedVertex3D Encode(const Vertex3D& vertex, FXMVECTOR boundsMin, FXMVECTOR encodeScale)
+	{
+		PackedVertex3D packed{};
+
+		const XMVECTOR position{ XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertex.m_Position), boundsMin), encodeScale) };
+		PackedVector::XMStoreUShortN4(&packed.m_Position, XMVectorSetW(position, 0.0f));
+		PackedVector::XMStoreUByteN4(&packed.m_Color, XMVectorSetW(XMLoadFloat3(&vertex.m_Color), 1.0f));
+		PackedVector::XMStoreHalf2(&packed.m_Texcoord, XMLoadFloat2(&vertex.m_Texcoord));
+
+		return packed;
+	}
+
+#if defined(_VK)
+	static const VkVertexInputBindingDescription& GetBindingDescription()
+	{
+		static VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = sizeof(PackedVertex3D);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	// Same locations as Vertex3D, the fixed function fetch expands everything to floats
+	static const std::array<VkVertexInputAttributeDescription, 3>& GetAttributeDescriptions()
+	{
+		static std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributeDescriptions[0].offset = offsetof(PackedVertex3D, m_Position);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attributeDescriptions[1].offset = offsetof(PackedVertex3D, m_Color);
+
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[2].offset = offsetof(PackedVertex3D, m_Texcoord);
+
+		return attributeDescriptions;
+	}
+#elif defined(_DX)
+
+#endif
+};
+
+static_assert(sizeof(PackedVertex3D) == 16);
+
+#pragma endregion
+
 #pragma region vertex2d
 
 struct Vertex2D
@@ -0,0 +1,184 @@
+#include "pch.h"
+#include "VertexWelder.h"
+
+#include <bit>
+
+#include "JobSystem.h"
+
+
+namespace
+{
+	static_assert(sizeof(Vertex3D) % sizeof(uint64_t) == 0, "Vertex3D is hashed and compared as 64-bit words.");
+
+	constexpr uint32_t sk_Empty{ std::numeric_limits<uint32_t>::max() };
+
+	bool AreBitwiseEqual(const Vertex3D& a, const Vertex3D& b)
+	{
+		return memcmp(&a, &b, sizeof(Vertex3D)) == 0;
+	}
+
+	// Linear probing over a power of two table kept at most half full, slots hold the first input index of each unique vertex
+	class WeldTable final
+	{
+	public:
+		explicit WeldTable(size_t vertexCount) :
+			m_Slots(std::bit_ceil(std::max<size_t>(vertexCount * 2, 16)), sk_Empty),
+			m_Mask{ m_Slots.size() - 1 }
+		{
+		}
+
+		// Returns the first input index equal to vertices[index], inserting index if it is the first one
+		uint32_t FindOrInsert(std::span<const Vertex3D> vertices, uint32_t index, uint64_t hash)
+		{
+			for (size_t slot{ hash & m_Mask };; slot = (slot + 1) & m_Mask)
+			{
+				const uint32_t candidate{ m_Slots[slot] };
+				if (candidate == sk_Empty)
+				{
+					m_Slots[slot] = index;
+					return index;
+				}
+
+				if (AreBitwiseEqual(vertices[candidate], vertices[index]))
+					return candidate;
+			}
+		}
+
+	private:
+		std::vector<uint32_t> m_Slots;
+		size_t m_Mask;
+	};
+
+	// Assigns output indices in input order from each vertex's first occurrence
+	uint32_t Compact(std::span<const Vertex3D> vertices, std::span<const uint32_t> firstOccurrence, std::vector<Vertex3D>& uniqueVertices, std::span<uint32_t> remap)
+	{
+		uniqueVertices.clear();
+
+		for (uint32_t i{}; i < vertices.size(); ++i)
+		{
+			if (firstOccurrence[i] == i)
+			{
+				remap[i] = static_cast<uint32_t>(uniqueVertices.size());
+				uniqueVertices.push_back(vertices[i]);
+			}
+			else
+				remap[i] = remap[firstOccurrence[i]];
+		}
+
+		return static_cast<uint32_t>(uniqueVertices.size());
+	}
+}
+
+uint64_t VertexWelder::HashVertex(const Vertex3D& vertex)
+{
+	uint64_t words[sizeof(Vertex3D) / sizeof(uint64_t)];
+	memcpy(words, &vertex, sizeof(Vertex3D));
+
+	// Multiply-xorshift mixing of each word, every input bit affects every output bit
+	uint64_t hash{ 0x9E3779B97F4A7C15ull };
+	for (const uint64_t word : words)
+	{
+		hash ^= word;
+		hash *= 0xBF58476D1CE4E5B9ull;
+		hash ^= hash >> 31;
+	}
+
+	hash *= 0x94D049BB133111EBull;
+	return hash ^ (hash >> 29);
+}
+
+uint32_t VertexWelder::Weld(std::span<const Vertex3D> vertices, std::vector<Vertex3D>& uniqueVertices, std::span<uint32_t> remap)
+{
+	PROFILE_FUNCTION();
+
+	assert(remap.size() >= vertices.size() && L"Remap table is too small.");
+
+	WeldTable table{ vertices.size() };
+	uniqueVertices.clear();
+	uniqueVertices.reserve(vertices.size());
+
+	for (uint32_t i{}; i < vertices.size(); ++i)
+	{
+		const uint32_t first{ table.FindOrInsert(vertices, i, HashVertex(vertices[i])) };
+		if (first == i)
+		{
+			remap[i] = static_cast<uint32_t>(uniqueVertices.size());
+			uniqueVertices.push_back(vertices[i]);
+		}
+		else
+			remap[i] = remap[first];
+	}
+
+	return static_cast<uint32_t>(uniqueVertices.size());
+}
+
+uint32_t VertexWelder::WeldParallel(std::span<const Vertex3D> vertices, std::vector<Vertex3D>& uniqueVertices, std::span<uint32_t> remap)
+{
+	PROFILE_FUNCTION();
+
+	assert(remap.size() >= vertices.size() && L"Remap table is too small.");
+
+	auto& jobSystem{ JobSystem::Get() };
+	const uint32_t vertexCount{ static_cast<uint32_t>(vertices.size()) };
+
+	// Equal vertices always land in the same shard, each shard is welded independently
+	const uint32_t shardCount{ std::bit_ceil(std::max(jobSystem.GetWorkerCount() + 1, 2u) * 2) };
+	const uint32_t shardShift{ 64 - static_cast<uint32_t>(std::countr_zero(shardCount)) };
+
+	std::vector<uint64_t> hashes(vertexCount);
+	std::vector<uint32_t> firstOccurrence(vertexCount);
+
+	constexpr uint32_t chunkSize{ 1 << 16 };
+	const uint32_t chunkCount{ (vertexCount + chunkSize - 1) / chunkSize };
+
+	// Shard by the top bits, the table probes with the low ones
+	std::vector<uint32_t> chunkShardOffsets(static_cast<size_t>(chunkCount) * shardCount);
+	jobSystem.ParallelFor(chunkCount, [&](uint32_t chunk)
+	{
+		uint32_t* pCounts{ &chunkShardOffsets[static_cast<size_t>(chunk) * shardCount] };
+		const uint32_t end{ std::min(vertexCount, (chunk + 1) * chunkSize) };
+		for (uint32_t i{ chunk * chunkSize }; i < end; ++i)
+		{
+			hashes[i] = VertexWelder::HashVertex(vertices[i]);
+			++pCounts[hashes[i] >> shardShift];
+		}
+	});
+
+	// Counting sort of the indices by shard, shard major then chunk so each shard keeps its indices in input order
+	std::vector<uint32_t> shardStarts(shardCount + 1);
+	uint32_t offset{};
+	for (uint32_t shard{}; shard < shardCount; ++shard)
+	{
+		shardStarts[shard] = offset;
+		for (uint32_t chunk{}; chunk < chunkCount; ++chunk)
+		{
+			uint32_t& count{ chunkShardOffsets[static_cast<size_t>(chunk) * shardCount + shard] };
+			const uint32_t chunkShardCount{ count };
+			count = offset;
+			offset += chunkShardCount;
+		}
+	}
+	shardStarts[shardCount] = offset;
+
+	std::vector<uint32_t> sortedIndices(vertexCount);
+	jobSystem.ParallelFor(chunkCount, [&](uint32_t chunk)
+	{
+		uint32_t* pOffsets{ &chunkShardOffsets[static_cast<size_t>(chunk) * shardCount] };
+		const uint32_t end{ std::min(vertexCount, (chunk + 1) * chunkSize) };
+		for (uint32_t i{ chunk * chunkSize }; i < end; ++i)
+			sortedIndices[pOffsets[hashes[i] >> shardShift]++] = i;
+	});
+
+	jobSystem.ParallelFor(shardCount, [&](uint32_t shard)
+	{
+		const std::span<const uint32_t> shardIndices{ sortedIndices.data() + shardStarts[shard], sortedIndices.data() + shardStarts[shard + 1] };
+
+		// Sized from the actual shard population, a full table would never terminate
+		WeldTable table{ shardIndices.size() };
+		for (const uint32_t i : shardIndices)
+			firstOccurrence[i] = table.FindOrInsert(vertices, i, hashes[i]);
+	});
+
+	uniqueVertices.reserve(vertexCount);
+	return Compact(vertices, firstOccurrence, uniqueVertices, remap);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef VERTEXWELDER_H
+#define VERTEXWELDER_H
+
+#include <span>
+
+#include "Vertex.h"
+
+// Bit-exact vertex deduplication: two vertices are merged only when all their bytes match (0.0f and -0.0f stay distinct).
+// Unique vertices keep the order of their first occurrence, both variants produce the same output.
+namespace VertexWelder
+{
+	// Worth the thread overhead above this many input vertices
+	constexpr size_t sk_ParallelThreshold{ size_t{ 1 } << 20 };
+
+	// remap[i] receives the index of vertices[i] in uniqueVertices, returns the unique vertex count
+	uint32_t Weld(std::span<const Vertex3D> vertices, std::vector<Vertex3D>& uniqueVertices, std::span<uint32_t> remap);
+	// Shards the vertices by hash on the job system, safe to call from a job
+	uint32_t WeldParallel(std::span<const Vertex3D> vertices, std::vector<Vertex3D>& uniqueVertices, std::span<uint32_t> remap);
+
+	[[nodiscard]] uint64_t HashVertex(const Vertex3D& vertex);
+}
+
+#endif //VERTEXWELDER_H
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "CoreSystems.h"
 
-int APIENTRY wWinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPWSTR /*lpCmdLine*/, int /*nCmdShow*/)
+int APIENTRY wWinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPWSTR lpCmdLine, int /*nCmdShow*/)
 {
 	// Check for DirectX Math library support.
 	if (!XMVerifyCPUSupport())
@@ -18,7 +18,7 @@ int APIENTRY wWinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/, LPWS
 
 	auto& core = CoreSystems::Get();
 
-	core.Initialize();
+	core.Initialize(lpCmdLine);
 
 	if (!core.IsInitialized())
 		return 1;
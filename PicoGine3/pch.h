@@ -46,6 +46,7 @@ using namespace DirectX;
 
 /* --- PROJECT FILES --- */
 #include "Logger.h"
+#include "Profiler.h"
 
 #include "Helpers.h"
 
@@ -0,0 +1,179 @@
+/* @metadata
+{
+	"shader_model": "6_0",
+	"entry_points": ["CSMain"]
+}
+*/
+
+// STRUCTS
+struct InstanceData
+{
+	row_major float4x4 modelMat;
+};
+
+struct ObjectData
+{
+	float4 boundsCenter; // Stored vertex space, the instance transform maps it to world space
+	float4 boundsExtent;
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+	uint vertexFormat;
+};
+
+struct DrawIndexedIndirectCommand
+{
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+struct PerFrameUBO
+{
+	row_major float4x4 viewMat;
+	row_major float4x4 projMat;
+	row_major float4x4 viewInvMat;
+	row_major float4x4 projInvMat;
+	row_major float4x4 viewProjMat;
+	row_major float4x4 viewProjInvMat;
+};
+cbuffer ubo : register(b0, space0) { PerFrameUBO ubo; }
+
+struct PushConstants
+{
+	float4 frustumPlanes[6]; // World space, positive inside
+	uint objectCount;
+	uint maxDrawsPerFormat;
+	uint phase; // 0 tests every object against last frame's pyramid, 1 tests the ones it rejected against this frame's
+	uint occlusionCulling; // 0 until the pyramid has been built once
+};
+#if defined(_VK)
+[[vk::push_constant]]
+#else //DX12
+[[rootconstant(0)]]
+#endif
+PushConstants push;
+
+StructuredBuffer<InstanceData> instances : register(t2);
+StructuredBuffer<ObjectData> objects : register(t3);
+RWStructuredBuffer<DrawIndexedIndirectCommand> drawCommands : register(u4);
+RWStructuredBuffer<uint> drawCounts : register(u5); // One per phase and vertex format, then the late object count
+RWStructuredBuffer<uint> lateObjects : register(u6);
+Texture2D<float> depthPyramid : register(t0, space1);
+
+#define VERTEX_FORMAT_COUNT 2 // g_VertexFormatCount, GraphicsAPI.h static_asserts that they match
+#define LATE_OBJECT_COUNT (2 * VERTEX_FORMAT_COUNT)
+
+// Screen rectangle in UV and nearest depth of the box, false when part of it is behind the camera
+bool ProjectBox(float3 center, float3 axisX, float3 axisY, float3 axisZ, out float4 uvRect, out float nearestDepth)
+{
+	uvRect = float4(1.0f, 1.0f, 0.0f, 0.0f);
+	nearestDepth = 1.0f;
+
+	[unroll]
+	for (uint i = 0; i < 8; ++i)
+	{
+		const float3 corner = center + ((i & 1) ? axisX : -axisX) + ((i & 2) ? axisY : -axisY) + ((i & 4) ? axisZ : -axisZ);
+		const float4 clip = mul(float4(corner, 1.0f), ubo.viewProjMat);
+		if (clip.w <= 0.0f)
+			return false;
+
+		const float3 ndc = clip.xyz / clip.w;
+		const float2 uv = ndc.xy * 0.5f + 0.5f;
+		uvRect.xy = min(uvRect.xy, uv);
+		uvRect.zw = max(uvRect.zw, uv);
+		nearestDepth = min(nearestDepth, ndc.z);
+	}
+
+	return true;
+}
+
+bool IsOccluded(float4 uvRect, float nearestDepth)
+{
+	uint width, height, levelCount;
+	depthPyramid.GetDimensions(0, width, height, levelCount);
+
+	// Level where the rectangle is at most one texel wide, so it overlaps at most 2x2 texels
+	const float2 size = (saturate(uvRect.zw) - saturate(uvRect.xy)) * float2(width, height);
+	const uint level = min(uint(ceil(log2(max(max(size.x, size.y), 1.0f)))), levelCount - 1);
+	const uint2 levelSize = max(uint2(width, height) >> level, 1);
+
+	const uint2 texelMin = min(uint2(saturate(uvRect.xy) * levelSize), levelSize - 1);
+	const uint2 texelMax = min(uint2(saturate(uvRect.zw) * levelSize), levelSize - 1);
+
+	const float farthest = max(
+		max(depthPyramid.Load(int3(texelMin.x, texelMin.y, level)), depthPyramid.Load(int3(texelMax.x, texelMin.y, level))),
+		max(depthPyramid.Load(int3(texelMin.x, texelMax.y, level)), depthPyramid.Load(int3(texelMax.x, texelMax.y, level))));
+
+	return nearestDepth > farthest;
+}
+
+// STAGES
+[numthreads(64, 1, 1)]
+void CSMain(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint objectIndex = dispatchThreadID.x;
+	if (push.phase == 0)
+	{
+		if (objectIndex >= push.objectCount)
+			return;
+	}
+	else
+	{
+		// The second phase only walks the objects the first one found occluded
+		if (objectIndex >= drawCounts[LATE_OBJECT_COUNT])
+			return;
+
+		objectIndex = lateObjects[objectIndex];
+	}
+
+	const ObjectData object = objects[objectIndex];
+	const float4x4 modelMat = instances[objectIndex].modelMat;
+
+	// Oriented box test, the half extents along each transformed axis project onto the plane normal
+	const float3 center = mul(float4(object.boundsCenter.xyz, 1.0f), modelMat).xyz;
+	const float3 axisX = modelMat[0].xyz * object.boundsExtent.x;
+	const float3 axisY = modelMat[1].xyz * object.boundsExtent.y;
+	const float3 axisZ = modelMat[2].xyz * object.boundsExtent.z;
+
+	if (push.phase == 0)
+	{
+		[unroll]
+		for (uint i = 0; i < 6; ++i)
+		{
+			const float4 plane = push.frustumPlanes[i];
+			const float radius = abs(dot(plane.xyz, axisX)) + abs(dot(plane.xyz, axisY)) + abs(dot(plane.xyz, axisZ));
+			if (dot(plane.xyz, center) + plane.w < -radius)
+				return;
+		}
+	}
+
+	// Last frame's pyramid can be wrong about anything that moved, rejected objects get a second chance once this frame's depth exists
+	float4 uvRect;
+	float nearestDepth;
+	if (push.occlusionCulling != 0 && ProjectBox(center, axisX, axisY, axisZ, uvRect, nearestDepth) && IsOccluded(uvRect, nearestDepth))
+	{
+		if (push.phase == 0)
+		{
+			uint lateSlot;
+			InterlockedAdd(drawCounts[LATE_OBJECT_COUNT], 1, lateSlot);
+			lateObjects[lateSlot] = objectIndex;
+		}
+		return;
+	}
+
+	const uint section = push.phase * VERTEX_FORMAT_COUNT + object.vertexFormat;
+
+	uint slot;
+	InterlockedAdd(drawCounts[section], 1, slot);
+
+	DrawIndexedIndirectCommand command;
+	command.indexCount = object.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = object.firstIndex;
+	command.vertexOffset = object.vertexOffset;
+	command.firstInstance = objectIndex;
+	drawCommands[section * push.maxDrawsPerFormat + slot] = command;
+}
\ No newline at end of file
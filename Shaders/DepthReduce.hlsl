@@ -0,0 +1,44 @@
+/* @metadata
+{
+	"shader_model": "6_0",
+	"entry_points": ["CSMain"]
+}
+*/
+
+// STRUCTS
+struct PushConstants
+{
+	uint2 sourceSize;
+	uint2 destinationSize;
+};
+#if defined(_VK)
+[[vk::push_constant]]
+#else //DX12
+[[rootconstant(0)]]
+#endif
+PushConstants push;
+
+Texture2D<float> source : register(t0);
+RWTexture2D<float> destination : register(u1);
+
+// STAGES
+[numthreads(8, 8, 1)]
+void CSMain(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	if (any(dispatchThreadID.xy >= push.destinationSize))
+		return;
+
+	// Every source texel the destination texel overlaps, up to three per axis when the source is not exactly twice as large
+	const uint2 first = dispatchThreadID.xy * push.sourceSize / push.destinationSize;
+	const uint2 last = min(((dispatchThreadID.xy + 1) * push.sourceSize + push.destinationSize - 1) / push.destinationSize, push.sourceSize) - 1;
+
+	// Farthest depth, a box behind it is hidden everywhere in the texel
+	float farthest = 0.0f;
+	for (uint y = first.y; y <= last.y; ++y)
+	{
+		for (uint x = first.x; x <= last.x; ++x)
+			farthest = max(farthest, source.Load(int3(x, y, 0)));
+	}
+
+	destination[dispatchThreadID.xy] = farthest;
+}
\ No newline at end of file
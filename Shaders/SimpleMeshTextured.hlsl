@@ -48,7 +48,8 @@ cbuffer ubo : register(b0, space0) { PerFrameUBO ubo; }
 
 struct PushConstants
 {
-    row_major float4x4 modelMat;
+	float4 positionOffset; // Packed vertices store positions normalized to the mesh bounds
+	float4 positionScale;
 };
 #if defined(_VK)
 [[vk::push_constant]]
@@ -60,12 +61,24 @@ PushConstants push;
 Texture2D texture : register(t1);
 SamplerState samplerState : register(s1);
 
+struct InstanceData
+{
+	row_major float4x4 modelMat;
+};
+StructuredBuffer<InstanceData> instances : register(t2);
+
 // STAGES
-VSOutput VSMain(VSInput input)
+// Vulkan only: DXC maps SV_InstanceID to InstanceIndex, which already includes the draw's first instance, so it indexes the
+// instance buffer directly for both direct and indirect draws. D3D12's SV_InstanceID excludes StartInstanceLocation, the DX12
+// backend will have to add it
+VSOutput VSMain(VSInput input, uint instanceID : SV_InstanceID)
 {
 	VSOutput output = (VSOutput)0;
 
-	output.positionCS = mul(mul(float4(input.positionOS, 1.0f), push.modelMat), ubo.viewProjMat);
+	const InstanceData instance = instances[instanceID];
+
+	const float3 positionOS = push.positionOffset.xyz + input.positionOS * push.positionScale.xyz;
+	output.positionCS = mul(mul(float4(positionOS, 1.0f), instance.modelMat), ubo.viewProjMat);
 	output.color = input.color;
 	output.texcoord = input.texcoord;
 